@@ -0,0 +1,169 @@
+// Program: DIP
+// FileName:main.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午1:05
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+#include <parallel.h>
+#include "pipeline.h"
+#include "scheduler.h"
+#include "stream.h"
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+double Ms(Clock::time_point bg, Clock::time_point ed) {
+    return std::chrono::duration<double, std::milli>(ed - bg).count();
+}
+
+void Usage() {
+    std::cout << "Usage: DIPBatch pipeline.yml [-o outdir] [-s suffix] [-j volumes] [-t threads]\n"
+              << "                [-S static|steal|stream] [-m memoryMB] [inputs...]\n"
+              << "       DIPBatch --list\n"
+              << "Inputs may be files, glob patterns (\"data/*.mhd\") or @list.txt\n";
+}
+
+// 逐个体数据以读/算/写三级流水线处理 返回失败个数
+size_t RunStreamMode(const PipelineConfig &config, const std::vector<std::string> &files) {
+    bool stream = CanStream(config);
+    std::cout << files.size() << " volumes, ";
+    if (stream)
+        std::cout << "streaming slices through " << GetThreadNum() << " compute threads\n";
+    else
+        std::cout << "pipeline needs whole volumes, streaming disabled\n";
+
+    size_t failed = 0;
+    Clock::time_point t_bg = Clock::now();
+    for (const auto &file : files) {
+        std::string failed_step;
+        Clock::time_point t0 = Clock::now();
+        bool ok = false;
+        if (stream) {
+            StreamTiming timing;
+            ok = RunStreamed(config, file, 0, timing, failed_step);
+            std::cout << file << "\t" << timing.width << "x" << timing.height << "x" << timing.slices
+                      << "\tread " << timing.read << " ms\tcompute " << timing.compute << " ms x "
+                      << timing.threads << " threads\twrite " << timing.write << " ms\ttotal " << Ms(t0, Clock::now()) << " ms";
+        } else {
+            Volume volume;
+            ok = volume.Load(file, NeedsStats(config)) && RunPipeline(volume, config, failed_step) &&
+                 volume.Save(OutputName(config, file));
+            std::cout << file << "\t" << volume.width << "x" << volume.height << "x" << volume.slice
+                      << "\ttotal " << Ms(t0, Clock::now()) << " ms";
+        }
+        if (!ok) {
+            ++failed;
+            std::cout << "\tFAILED" << (failed_step.empty() ? "" : " at " + failed_step);
+        }
+        std::cout << "\n";
+    }
+    double total = Ms(t_bg, Clock::now());
+    std::cout << "Processed " << files.size() - failed << "/" << files.size()
+              << " volumes in " << total << " ms ("
+              << (total > 0 ? files.size() * 3600.0 * 1000.0 / total : 0.0) << " volumes/hour)\n";
+    return failed;
+}
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--list") == 0) {
+        PrintOperators();
+        return 0;
+    }
+    if (argc < 2) {
+        Usage();
+        return 1;
+    }
+    PipelineConfig config;
+    if (!LoadPipeline(argv[1], config)) return 1;
+
+    // 命令行参数覆盖描述文件
+    std::vector<std::string> inputs;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-o" || arg == "-s" || arg == "-j" || arg == "-t" ||
+             arg == "-S" || arg == "-m") && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (arg == "-o") config.output = value;
+            else if (arg == "-s") config.suffix = value;
+            else if (arg == "-j") config.volumes = std::atoi(value.c_str());
+            else if (arg == "-S") config.schedule = value;
+            else if (arg == "-m") config.memory = std::atoi(value.c_str());
+            else config.threads = std::atoi(value.c_str());
+        } else if (!arg.empty() && arg[0] == '-') {
+            Usage();
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (!inputs.empty()) config.inputs = inputs;
+    if (!ValidatePipeline(config)) return 1;
+
+    std::vector<std::string> files = ExpandInputs(config.inputs);
+    if (files.empty()) {
+        std::cout << "No input volumes\n";
+        return 1;
+    }
+    mkdir(config.output.c_str(), 0755);
+    if (config.schedule == "steal")
+        return RunScheduled(config, files) ? 2 : 0;
+    SetThreadNum(config.threads);
+    if (config.schedule == "stream")
+        return RunStreamMode(config, files) ? 2 : 0;
+
+    if (!config.volumes) config.volumes = 1;
+    if (config.volumes > files.size()) config.volumes = files.size();
+    std::cout << files.size() << " volumes, " << config.volumes << " concurrent, "
+              << GetThreadNum() << " threads per volume\n";
+
+    std::atomic<size_t> next(0), failed(0);
+    std::mutex out_mutex;
+    auto worker = [&]() {
+        for (size_t n = next++; n < files.size(); n = next++) {
+            const std::string &file = files[n];
+            Volume volume;
+            Clock::time_point t0 = Clock::now();
+            bool ok = volume.Load(file, NeedsStats(config));
+            Clock::time_point t1 = Clock::now();
+            std::string failed_step;
+            if (ok) ok = RunPipeline(volume, config, failed_step);
+            Clock::time_point t2 = Clock::now();
+            if (ok) ok = volume.Save(OutputName(config, file));
+            Clock::time_point t3 = Clock::now();
+            if (!ok) ++failed;
+
+            std::lock_guard<std::mutex> lock(out_mutex);
+            std::cout << file << "\t" << volume.width << "x" << volume.height << "x" << volume.slice
+                      << "\tread " << Ms(t0, t1) << " ms\tcompute " << Ms(t1, t2)
+                      << " ms\twrite " << Ms(t2, t3) << " ms\ttotal " << Ms(t0, t3) << " ms";
+            if (!ok) std::cout << "\tFAILED" << (failed_step.empty() ? "" : " at " + failed_step);
+            std::cout << "\n";
+        }
+    };
+
+    Clock::time_point t_bg = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < config.volumes; ++i)
+        workers.push_back(std::thread(worker));
+    worker();
+    for (auto &w : workers)
+        w.join();
+    double total = Ms(t_bg, Clock::now());
+
+    std::cout << "Processed " << files.size() - failed << "/" << files.size()
+              << " volumes in " << total << " ms ("
+              << (total > 0 ? files.size() * 3600.0 * 1000.0 / total : 0.0) << " volumes/hour)\n";
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,754 @@
+// Program: DIP
+// FileName:pipeline.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午1:05
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include "pipeline.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <glob.h>
+
+#include <mhd_reader.h>
+#include <utiles.h>
+#include <point_trans.h>
+#include <clahe.h>
+#include <auto_threshold.h>
+#include <geometry_trans.h>
+#include <template_trans.h>
+#include <recursive_gaussian.h>
+#include <filter3d.h>
+#include <bilateral_filter.h>
+#include <nonlocal_means.h>
+#include <guided_filter.h>
+#include <ortho_trans.h>
+#include <morphology_trans.h>
+#include <bit_mask.h>
+#include <segmentation.h>
+#include <canny.h>
+
+Volume::~Volume() {
+    delete reader;
+    delete[] owned;
+}
+
+bool Volume::Load(const std::string &file, bool computeStats) {
+    delete reader;
+    delete[] owned;
+    owned = nullptr;
+    name = file;
+    stats.Invalidate();
+    reader = new MHDReader(file.c_str(), computeStats);
+    data = reader->GetImData();
+    if (!data || reader->GetDataType() != "MET_UCHAR") {
+        std::cout << "Read input failed: " << file << "\n";
+        data = nullptr;
+        return false;
+    }
+    width = reader->GetImWidth();
+    height = reader->GetImHeight();
+    slice = reader->GetImSlice();
+    spacing[0] = reader->GetSpacingX();
+    spacing[1] = reader->GetSpacingY();
+    spacing[2] = reader->GetSpacingZ();
+    if (computeStats) std::swap(stats, *reader->GetStats());
+    return true;
+}
+
+bool Volume::Save(const std::string &file) const {
+    if (!data) return false;
+    size_t dims[3] = {width, height, slice};
+    double sp[3] = {spacing[0], spacing[1], spacing[2]};
+    WriteMHD(file.c_str(), data, dims, sp);
+    return true;
+}
+
+void Volume::Replace(unsigned char *im, size_t w, size_t h) {
+    delete[] owned;
+    owned = im;
+    data = im;
+    width = w;
+    height = h;
+    stats.Invalidate();
+}
+
+namespace {
+
+typedef bool (*StepFunc)(Volume &v, const PipelineStep &step);
+
+// 算子表: 名称 参数(以空格分隔 带?为可选) 执行函数 是否需要整个体数据 是否使用统计量缓存
+struct OperatorEntry {
+    const char *name;
+    const char *params;
+    StepFunc func;
+    bool volumeWide;
+    bool usesStats;
+};
+
+double ParamDouble(const PipelineStep &step, const char *key, double def) {
+    auto it = step.params.find(key);
+    return it == step.params.end() ? def : std::atof(it->second.c_str());
+}
+
+int ParamInt(const PipelineStep &step, const char *key, int def) {
+    auto it = step.params.find(key);
+    return it == step.params.end() ? def : std::atoi(it->second.c_str());
+}
+
+std::string ParamString(const PipelineStep &step, const char *key, const char *def) {
+    auto it = step.params.find(key);
+    return it == step.params.end() ? def : it->second;
+}
+
+// 阈值参数为otsu triangle entropy时自动选取
+bool AutoThresholdMethod(const PipelineStep &step, ThresholdMethod &method) {
+    std::string th = ParamString(step, "threshold", "");
+    if (th == "otsu") method = THRESHOLD_OTSU;
+    else if (th == "triangle") method = THRESHOLD_TRIANGLE;
+    else if (th == "entropy") method = THRESHOLD_MAX_ENTROPY;
+    else return false;
+    return true;
+}
+
+bool RunThreshold(Volume &v, const PipelineStep &step) {
+    ThresholdMethod method = THRESHOLD_OTSU;
+    if (!AutoThresholdMethod(step, method))
+        return ThresholdTrans(v.data, v.width, v.height, v.slice, ParamInt(step, "threshold", 0));
+    return AutoThresholdTrans(v.data, v.width, v.height, v.slice, method, ParamInt(step, "classes", 2),
+                              ParamInt(step, "perslice", 0) != 0, &v.stats);
+}
+
+// 边缘扩展方式 border: constant replicate reflect wrap 未给出时为def
+bool BorderParam(const PipelineStep &step, BorderMode def, BorderMode &border) {
+    std::string mode = ParamString(step, "border", "");
+    if (mode.empty()) border = def;
+    else if (mode == "constant") border = BORDER_CONSTANT;
+    else if (mode == "replicate") border = BORDER_REPLICATE;
+    else if (mode == "reflect") border = BORDER_REFLECT;
+    else if (mode == "wrap") border = BORDER_WRAP;
+    else {
+        std::cout << "Unknown border mode: " << mode << "\n";
+        return false;
+    }
+    return true;
+}
+
+// 梯度模长的范数 norm: max l1 l2
+bool NormParam(const PipelineStep &step, GradientNorm &norm) {
+    std::string name = ParamString(step, "norm", "max");
+    if (name == "max") norm = GRADIENT_MAX;
+    else if (name == "l1") norm = GRADIENT_L1;
+    else if (name == "l2") norm = GRADIENT_L2;
+    else {
+        std::cout << "Unknown gradient norm: " << name << "\n";
+        return false;
+    }
+    return true;
+}
+
+// 常数扩展(背景)时按位计算 结构元素为size长的水平线、垂直线或size*size的矩形、十字
+bool RunBitMorphology(Volume &v, const std::string &mode, size_t r, int which) {
+    BitMask mask;
+    if (!ImageToBitMask(v.data, v.width, v.height, v.slice, mask)) return false;
+    const size_t rx = mode == "vertical" ? 0 : r, ry = mode == "horizontal" ? 0 : r;
+    auto apply = [&](bool erode) {
+        return mode == "cross" ? BitMaskCross(mask, rx, ry, erode) : BitMaskMorphology(mask, rx, ry, erode);
+    };
+    bool ok;
+    switch (which) {
+        case 0:
+            ok = apply(true);
+            break;
+        case 1:
+            ok = apply(false);
+            break;
+        case 2:
+            ok = apply(true) && apply(false);
+            break;
+        default:
+            ok = apply(false) && apply(true);
+    }
+    return ok && BitMaskToImage(mask, v.data);
+}
+
+// 形态学结构元素 mode: horizontal vertical cross square, size: 结构元素大小 奇数
+bool RunMorphology(Volume &v, const PipelineStep &step, int which) {
+    std::string mode = ParamString(step, "mode", "cross");
+    bool s1[3] = {0, 1, 0}, s2[3] = {1, 1, 1}, s3[3] = {0, 1, 0};
+    bool q1[3] = {1, 1, 1}, q2[3] = {1, 1, 1}, q3[3] = {1, 1, 1};
+    bool *cross[3] = {s1, s2, s3};
+    bool *square[3] = {q1, q2, q3};
+    int m = 2;
+    bool **structure = cross;
+    if (mode == "horizontal") m = 0;
+    else if (mode == "vertical") m = 1;
+    else if (mode == "square") structure = square;
+    else if (mode != "cross") {
+        std::cout << "Unknown morphology mode: " << mode << "\n";
+        return false;
+    }
+    const int size = ParamInt(step, "size", 3);
+    if (size < 1 || !(size % 2)) {
+        std::cout << "Morphology size must be odd: " << size << "\n";
+        return false;
+    }
+    BorderMode border = BORDER_CONSTANT;
+    if (!BorderParam(step, BORDER_CONSTANT, border)) return false;
+    if (border == BORDER_CONSTANT) return RunBitMorphology(v, mode, size_t(size / 2), which);
+    if (size != 3) {
+        std::cout << "Morphology size other than 3 needs border: constant\n";
+        return false;
+    }
+    switch (which) {
+        case 0:
+            return Erosion(v.data, v.width, v.height, v.slice, m, structure, 3, border);
+        case 1:
+            return Dilation(v.data, v.width, v.height, v.slice, m, structure, 3, border);
+        case 2:
+            return Open(v.data, v.width, v.height, v.slice, m, structure, 3, border);
+        default:
+            return Close(v.data, v.width, v.height, v.slice, m, structure, 3, border);
+    }
+}
+
+bool RunTemplate(Volume &v, const PipelineStep &step) {
+    std::vector<double> kernel;
+    std::istringstream record(ParamString(step, "kernel", ""));
+    double value = 0.0, sum = 0.0;
+    while (record >> value) {
+        kernel.push_back(value);
+        sum += value;
+    }
+    size_t w = ParamInt(step, "width", 3);
+    size_t h = ParamInt(step, "height", 3);
+    if (kernel.size() != w * h) {
+        std::cout << "Template kernel needs width*height coefficients\n";
+        return false;
+    }
+    double coeff = ParamDouble(step, "coeff", sum != 0.0 ? 1.0 / sum : 1.0);
+    BorderMode border = BORDER_REPLICATE;
+    if (!BorderParam(step, BORDER_REPLICATE, border)) return false;
+    return Template(v.data, v.width, v.height, v.slice, w, h,
+                    ParamInt(step, "cx", w / 2), ParamInt(step, "cy", h / 2),
+                    kernel.data(), coeff, border);
+}
+
+bool RunZoom(Volume &v, const PipelineStep &step) {
+    float rx = ParamDouble(step, "x", 1.0), ry = ParamDouble(step, "y", 1.0);
+    unsigned char *im = Zoom(v.data, v.width, v.height, v.slice, rx, ry);
+    if (!im) return false;
+    v.Replace(im, size_t(v.width * rx + 0.5), size_t(v.height * ry + 0.5));
+    return true;
+}
+
+bool RunRotate(Volume &v, const PipelineStep &step) {
+    size_t w = 0, h = 0;
+    int angle = ParamInt(step, "angle", 0);
+    unsigned char *im = ParamInt(step, "method", 1)
+                        ? Rotate2(v.data, v.width, v.height, v.slice, angle, w, h)
+                        : Rotate(v.data, v.width, v.height, v.slice, angle, w, h);
+    if (!im) return false;
+    v.Replace(im, w, h);
+    return true;
+}
+
+const OperatorEntry kOperators[] = {
+        // PointTrans
+        {"ThresholdTrans", "threshold classes? perslice?", RunThreshold, false, true},
+        {"WindowTrans", "low up", [](Volume &v, const PipelineStep &s) {
+            return WindowTrans(v.data, v.width, v.height, v.slice,
+                               ParamInt(s, "low", 0), ParamInt(s, "up", 255));
+        }, false, false},
+        {"GrayStretch", "x1 y1 x2 y2", [](Volume &v, const PipelineStep &s) {
+            return GrayStretch(v.data, v.width, v.height, v.slice,
+                               ParamInt(s, "x1", 0), ParamInt(s, "y1", 0),
+                               ParamInt(s, "x2", 255), ParamInt(s, "y2", 255), &v.stats);
+        }, false, true},
+        {"HisEqualize", "", [](Volume &v, const PipelineStep &) {
+            return HisEqualize(v.data, v.width, v.height, v.slice, &v.stats);
+        }, true, true},
+        {"CLAHE", "tiles? clip? radius?", [](Volume &v, const PipelineStep &s) {
+            // radius>0时用精确的逐像素滑动窗口
+            double clip = ParamDouble(s, "clip", 2.0);
+            if (ParamInt(s, "radius", 0) > 0)
+                return CLAHESliding(v.data, v.width, v.height, v.slice, ParamInt(s, "radius", 0),
+                                    clip, &v.stats);
+            size_t tiles = ParamInt(s, "tiles", 8);
+            return CLAHE(v.data, v.width, v.height, v.slice, tiles, tiles, clip, &v.stats);
+        }, true, true},
+        // GeometryTrans
+        {"Translation", "x y method?", [](Volume &v, const PipelineStep &s) {
+            if (ParamInt(s, "method", 1))
+                return Translation2(v.data, v.width, v.height, v.slice,
+                                    ParamInt(s, "x", 0), ParamInt(s, "y", 0));
+            return Translation(v.data, v.width, v.height, v.slice,
+                               ParamInt(s, "x", 0), ParamInt(s, "y", 0));
+        }, false, false},
+        {"Mirror", "direction method?", [](Volume &v, const PipelineStep &s) {
+            bool drt = ParamInt(s, "direction", 0) != 0;
+            if (ParamInt(s, "method", 1))
+                return Mirror2(v.data, v.width, v.height, v.slice, drt);
+            return Mirror(v.data, v.width, v.height, v.slice, drt);
+        }, false, false},
+        {"Transpose", "", [](Volume &v, const PipelineStep &) {
+            if (!Transpose(v.data, v.width, v.height, v.slice)) return false;
+            std::swap(v.width, v.height);
+            std::swap(v.spacing[0], v.spacing[1]);
+            return true;
+        }, false, false},
+        {"Zoom", "x y", RunZoom, false, false},
+        {"Rotate", "angle method?", RunRotate, false, false},
+        // TemplateTrans
+        {"Template", "kernel width? height? cx? cy? coeff? border?", RunTemplate, false, false},
+        {"MeanSmooth", "border?", [](Volume &v, const PipelineStep &s) {
+            double para[9] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return Template(v.data, v.width, v.height, v.slice, 3, 3, 1, 1, para, 1.0 / 9, border);
+        }, false, false},
+        {"GaussSmooth", "size? sigma? border?", [](Volume &v, const PipelineStep &s) {
+            size_t size = ParamInt(s, "size", 3);
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            if (size == 3 && !s.params.count("sigma")) {
+                double para[9] = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+                return Template(v.data, v.width, v.height, v.slice, 3, 3, 1, 1, para, 1.0 / 16, border);
+            }
+            std::vector<double> kernel;
+            GaussianKernel(size, ParamDouble(s, "sigma", 0.0), kernel);
+            return SeparableTemplate(v.data, v.width, v.height, v.slice, size, size, size / 2, size / 2,
+                                     kernel.data(), kernel.data(), 1.0, border);
+        }, false, false},
+        {"RecursiveGauss", "sigma volume?", [](Volume &v, const PipelineStep &s) {
+            // sigma以物理单位计 按体素间距换算到各方向
+            return RecursiveGaussianSmooth(v.data, v.width, v.height, v.slice, ParamDouble(s, "sigma", 1.0),
+                                           v.spacing, ParamInt(s, "volume", 1) != 0);
+        }, false, false},
+        {"BoxMean", "rx ry? rz?", [](Volume &v, const PipelineStep &s) {
+            int rx = ParamInt(s, "rx", 1);
+            return BoxMean(v.data, v.width, v.height, v.slice, rx, ParamInt(s, "ry", rx),
+                           ParamInt(s, "rz", 0));
+        }, false, false},
+        {"FilterMedian", "width? height? radius? depth? border?", [](Volume &v, const PipelineStep &s) {
+            size_t d = ParamInt(s, "depth", 1);
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            if (ParamInt(s, "radius", 0) > 0 && d <= 1)
+                return MedianFilter(v.data, v.width, v.height, v.slice, ParamInt(s, "radius", 0), border);
+            size_t w = ParamInt(s, "width", 3), h = ParamInt(s, "height", 3);
+            if (d > 1)
+                return FilterMedian3D(v.data, v.width, v.height, v.slice, w, h, d, w / 2, h / 2, d / 2, border);
+            return FilterMedian(v.data, v.width, v.height, v.slice, w, h, w / 2, h / 2, border);
+        }, false, false},
+        {"Median3D", "radius border?", [](Volume &v, const PipelineStep &s) {
+            // 半径以物理单位计 按体素间距换算到各方向
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return MedianFilter3D(v.data, v.width, v.height, v.slice, ParamDouble(s, "radius", 1.0), v.spacing,
+                                  border);
+        }, true, false},
+        {"Bilateral", "sigmas sigmar brute?", [](Volume &v, const PipelineStep &s) {
+            double ss = ParamDouble(s, "sigmas", 8.0), sr = ParamDouble(s, "sigmar", 20.0);
+            if (ParamInt(s, "brute", 0))
+                return BilateralFilter(v.data, v.width, v.height, v.slice, ss, sr);
+            return BilateralGrid(v.data, v.width, v.height, v.slice, ss, sr);
+        }, false, false},
+        {"NLMeans", "h patch? search? volume?", [](Volume &v, const PipelineStep &s) {
+            return NonLocalMeans(v.data, v.width, v.height, v.slice, ParamDouble(s, "h", 10.0),
+                                 ParamInt(s, "patch", 1), ParamInt(s, "search", 5),
+                                 ParamInt(s, "volume", 0) != 0, v.spacing);
+        }, false, false},
+        {"GuidedFilter", "r eps rz?", [](Volume &v, const PipelineStep &s) {
+            return GuidedFilter(v.data, v.width, v.height, v.slice, ParamInt(s, "r", 4),
+                                ParamDouble(s, "eps", 100.0), ParamInt(s, "rz", 0));
+        }, false, false},
+        {"LaplaceSharpen", "", [](Volume &v, const PipelineStep &) {
+            return LaplaceSharpen(v.data, v.width, v.height, v.slice);
+        }, false, false},
+        {"GradSharp", "threshold border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return GradSharp(v.data, v.width, v.height, v.slice, ParamInt(s, "threshold", 0), border);
+        }, false, false},
+        // OrthogonalTrans
+        {"Fourier", "", [](Volume &v, const PipelineStep &) {
+            return Fourier(v.data, v.width, v.height, v.slice);
+        }, false, false},
+        {"DiscretCosin", "", [](Volume &v, const PipelineStep &) {
+            return DiscretCosin(v.data, v.width, v.height, v.slice);
+        }, false, false},
+        // MorphologyTrans
+        {"Erosion", "mode? size? border?", [](Volume &v, const PipelineStep &s) {
+            return RunMorphology(v, s, 0);
+        }, false, false},
+        {"Dilation", "mode? size? border?", [](Volume &v, const PipelineStep &s) {
+            return RunMorphology(v, s, 1);
+        }, false, false},
+        {"Open", "mode? size? border?", [](Volume &v, const PipelineStep &s) {
+            return RunMorphology(v, s, 2);
+        }, false, false},
+        {"Close", "mode? size? border?", [](Volume &v, const PipelineStep &s) {
+            return RunMorphology(v, s, 3);
+        }, false, false},
+        {"Thining", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_CONSTANT;
+            if (!BorderParam(s, BORDER_CONSTANT, border)) return false;
+            return Thining(v.data, v.width, v.height, v.slice, border);
+        }, false, false},
+        // EdgeContour
+        {"RobertOperator", "", [](Volume &v, const PipelineStep &) {
+            return RobertOperator(v.data, v.width, v.height, v.slice);
+        }, false, false},
+        {"SobelOperator", "norm? border?", [](Volume &v, const PipelineStep &s) {
+            GradientNorm norm = GRADIENT_MAX;
+            BorderMode border = BORDER_REPLICATE;
+            if (!NormParam(s, norm) || !BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return SobelOperator(v.data, v.width, v.height, v.slice, norm, border);
+        }, false, false},
+        {"PrewittOperator", "norm? border?", [](Volume &v, const PipelineStep &s) {
+            GradientNorm norm = GRADIENT_MAX;
+            BorderMode border = BORDER_REPLICATE;
+            if (!NormParam(s, norm) || !BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return PrewittOperator(v.data, v.width, v.height, v.slice, norm, border);
+        }, false, false},
+        {"KrischOperator", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return KrischOperator(v.data, v.width, v.height, v.slice, border);
+        }, false, false},
+        {"RobinsonOperator", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return RobinsonOperator(v.data, v.width, v.height, v.slice, border);
+        }, false, false},
+        {"FreiChenOperator", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return FreiChenOperator(v.data, v.width, v.height, v.slice, border);
+        }, false, false},
+        {"GaussLaplaceOperator", "sigma?", [](Volume &v, const PipelineStep &s) {
+            if (s.params.count("sigma"))
+                return GaussLaplaceOperator(v.data, v.width, v.height, v.slice, ParamDouble(s, "sigma", 1.0));
+            return GaussLaplaceOperator(v.data, v.width, v.height, v.slice);
+        }, false, false},
+        {"SobelOperator3D", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return SobelOperator3D(v.data, v.width, v.height, v.slice, v.spacing, border);
+        }, true, false},
+        {"PrewittOperator3D", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return PrewittOperator3D(v.data, v.width, v.height, v.slice, v.spacing, border);
+        }, true, false},
+        {"GaussLaplaceOperator3D", "sigma border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_REPLICATE;
+            if (!BorderParam(s, BORDER_REPLICATE, border)) return false;
+            return GaussLaplaceOperator3D(v.data, v.width, v.height, v.slice, ParamDouble(s, "sigma", 1.0), v.spacing,
+                                          border);
+        }, true, false},
+        {"Contour", "border?", [](Volume &v, const PipelineStep &s) {
+            BorderMode border = BORDER_CONSTANT;
+            if (!BorderParam(s, BORDER_CONSTANT, border)) return false;
+            if (border != BORDER_CONSTANT) return Contour(v.data, v.width, v.height, v.slice, border);
+            BitMask mask;
+            return ImageToBitMask(v.data, v.width, v.height, v.slice, mask, false) && BitMaskContour(mask, mask) &&
+                   BitMaskToImage(mask, v.data);
+        }, false, false},
+        {"Trace", "", [](Volume &v, const PipelineStep &) {
+            return Trace(v.data, v.width, v.height, v.slice);
+        }, false, false},
+        {"Fill", "x? y?", [](Volume &v, const PipelineStep &s) {
+            return Fill(v.data, v.width, v.height, v.slice,
+                        ParamInt(s, "x", v.width / 2), ParamInt(s, "y", v.height / 2));
+        }, false, false},
+        {"Fill2", "x? y?", [](Volume &v, const PipelineStep &s) {
+            return Fill2(v.data, v.width, v.height, v.slice,
+                         ParamInt(s, "x", v.width / 2), ParamInt(s, "y", v.height / 2));
+        }, false, false},
+        // Segmentation
+        {"RobertsSeg", "threshold perslice?", [](Volume &v, const PipelineStep &s) {
+            ThresholdMethod m = THRESHOLD_OTSU;
+            if (AutoThresholdMethod(s, m))
+                return RobertsSeg(v.data, v.width, v.height, v.slice, m, ParamInt(s, "perslice", 0) != 0);
+            return RobertsSeg(v.data, v.width, v.height, v.slice, ParamInt(s, "threshold", 0));
+        }, false, false},
+        {"SobelSeg", "threshold perslice?", [](Volume &v, const PipelineStep &s) {
+            ThresholdMethod m = THRESHOLD_OTSU;
+            if (AutoThresholdMethod(s, m))
+                return SobelSeg(v.data, v.width, v.height, v.slice, m, ParamInt(s, "perslice", 0) != 0);
+            return SobelSeg(v.data, v.width, v.height, v.slice, ParamInt(s, "threshold", 0));
+        }, false, false},
+        {"PrewittSeg", "threshold perslice?", [](Volume &v, const PipelineStep &s) {
+            ThresholdMethod m = THRESHOLD_OTSU;
+            if (AutoThresholdMethod(s, m))
+                return PrewittSeg(v.data, v.width, v.height, v.slice, m, ParamInt(s, "perslice", 0) != 0);
+            return PrewittSeg(v.data, v.width, v.height, v.slice, ParamInt(s, "threshold", 0));
+        }, false, false},
+        {"LaplacianSeg", "threshold perslice?", [](Volume &v, const PipelineStep &s) {
+            ThresholdMethod m = THRESHOLD_OTSU;
+            if (AutoThresholdMethod(s, m))
+                return LaplacianSeg(v.data, v.width, v.height, v.slice, m, ParamInt(s, "perslice", 0) != 0);
+            return LaplacianSeg(v.data, v.width, v.height, v.slice, ParamInt(s, "threshold", 0));
+        }, false, false},
+        {"EdgeTrack", "threshold", [](Volume &v, const PipelineStep &s) {
+            return EdgeTrack(v.data, v.width, v.height, v.slice, ParamInt(s, "threshold", 0));
+        }, false, false},
+        {"RegionAdaptiveSeg", "count", [](Volume &v, const PipelineStep &s) {
+            return RegionAdaptiveSeg(v.data, v.width, v.height, v.slice, ParamInt(s, "count", 4),
+                                     &v.stats);
+        }, false, true},
+        {"AdaptiveThreshold", "radius offset?", [](Volume &v, const PipelineStep &s) {
+            return AdaptiveThreshold(v.data, v.width, v.height, v.slice, ParamInt(s, "radius", 7),
+                                     ParamDouble(s, "offset", 0.0), &v.stats);
+        }, false, false},
+        {"RegionGrow", "x y threshold", [](Volume &v, const PipelineStep &s) {
+            return RegionGrow(v.data, v.width, v.height, v.slice,
+                              ParamInt(s, "x", 0), ParamInt(s, "y", 0), ParamInt(s, "threshold", 0));
+        }, false, false},
+        {"Canny", "sigma? low? high?", [](Volume &v, const PipelineStep &s) {
+            return Canny(v.data, v.width, v.height, v.slice, ParamDouble(s, "sigma", 1.0),
+                         ParamDouble(s, "low", 0.0), ParamDouble(s, "high", 0.0));
+        }, false, false},
+        {"Canny3D", "sigma? low? high?", [](Volume &v, const PipelineStep &s) {
+            return Canny(v.data, v.width, v.height, v.slice, ParamDouble(s, "sigma", 1.0),
+                         ParamDouble(s, "low", 0.0), ParamDouble(s, "high", 0.0), true, v.spacing);
+        }, true, false},
+};
+
+const OperatorEntry *FindOperator(const std::string &name) {
+    for (const auto &entry : kOperators) {
+        if (name == entry.name) return &entry;
+    }
+    return nullptr;
+}
+
+std::string Trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    std::string t = s.substr(b, e - b + 1);
+    // 去掉引号
+    if (t.size() >= 2 && (t[0] == '"' || t[0] == '\'') && t[t.size() - 1] == t[0])
+        t = t.substr(1, t.size() - 2);
+    return t;
+}
+
+// 去掉注释(#在行首或前面是空白)
+std::string StripComment(const std::string &line) {
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '#' && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t'))
+            return line.substr(0, i);
+    }
+    return line;
+}
+
+bool SplitKeyValue(const std::string &s, std::string &key, std::string &value) {
+    size_t pos = s.find(':');
+    if (pos == std::string::npos) return false;
+    key = Trim(s.substr(0, pos));
+    value = Trim(s.substr(pos + 1));
+    return !key.empty();
+}
+}
+
+bool LoadPipeline(const char *name, PipelineConfig &config) {
+    std::ifstream in(name);
+    if (!in) {
+        std::cout << "Error! Can't Open File " << name << std::endl;
+        return false;
+    }
+    std::string line, section, key, value;
+    int line_no = 0;
+    PipelineStep *step = nullptr;
+    while (std::getline(in, line)) {
+        ++line_no;
+        line = StripComment(line);
+        std::string text = Trim(line);
+        if (text.empty()) continue;
+        bool indented = line[0] == ' ' || line[0] == '\t';
+
+        // 顶层键值
+        if (!indented && text[0] != '-') {
+            if (!SplitKeyValue(text, key, value)) {
+                std::cout << name << ":" << line_no << ": expected 'key: value'\n";
+                return false;
+            }
+            section.clear();
+            step = nullptr;
+            if (value.empty()) section = key;
+            else if (key == "volumes") config.volumes = std::atoi(value.c_str());
+            else if (key == "threads") config.threads = std::atoi(value.c_str());
+            else if (key == "output") config.output = value;
+            else if (key == "suffix") config.suffix = value;
+            else if (key == "schedule") config.schedule = value;
+            else if (key == "memory") config.memory = std::atoi(value.c_str());
+            else if (key == "inputs") config.inputs.push_back(value);
+            else {
+                std::cout << name << ":" << line_no << ": unknown key '" << key << "'\n";
+                return false;
+            }
+            continue;
+        }
+
+        // 列表项
+        if (text[0] == '-') {
+            text = Trim(text.substr(1));
+            if (section == "inputs") {
+                config.inputs.push_back(text);
+                continue;
+            }
+            if (section != "pipeline") {
+                std::cout << name << ":" << line_no << ": list item outside 'inputs' or 'pipeline'\n";
+                return false;
+            }
+            config.steps.push_back(PipelineStep());
+            step = &config.steps.back();
+            // "- ThresholdTrans" 简写
+            if (text.find(':') == std::string::npos) {
+                step->op = text;
+                continue;
+            }
+        }
+
+        // 算子参数
+        if (!step || !SplitKeyValue(text, key, value)) {
+            std::cout << name << ":" << line_no << ": expected operator parameter\n";
+            return false;
+        }
+        if (key == "op") step->op = value;
+        else step->params[key] = value;
+    }
+    return true;
+}
+
+bool ValidatePipeline(const PipelineConfig &config) {
+    if (config.schedule != "static" && config.schedule != "steal" && config.schedule != "stream") {
+        std::cout << "Unknown schedule: " << config.schedule << "\n";
+        return false;
+    }
+    if (config.steps.empty()) {
+        std::cout << "Pipeline has no steps\n";
+        return false;
+    }
+    for (const auto &step : config.steps) {
+        const OperatorEntry *entry = FindOperator(step.op);
+        if (!entry) {
+            std::cout << "Unknown operator: " << step.op << "\n";
+            return false;
+        }
+        std::istringstream params(entry->params);
+        std::string p;
+        std::vector<std::string> known;
+        while (params >> p) {
+            bool optional = p[p.size() - 1] == '?';
+            if (optional) p.erase(p.size() - 1);
+            known.push_back(p);
+            if (!optional && !step.params.count(p)) {
+                std::cout << step.op << ": missing parameter '" << p << "'\n";
+                return false;
+            }
+        }
+        for (const auto &kv : step.params) {
+            bool found = false;
+            for (const auto &k : known) found = found || k == kv.first;
+            if (!found) {
+                std::cout << step.op << ": unknown parameter '" << kv.first << "'\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool RunStep(Volume &volume, const PipelineStep &step) {
+    const OperatorEntry *entry = FindOperator(step.op);
+    if (!entry || !volume.data) return false;
+    bool ok = entry->func(volume, step);
+    // 算子一般会修改数据
+    volume.stats.Invalidate();
+    return ok;
+}
+
+bool RunPipeline(Volume &volume, const PipelineConfig &config, std::string &failed_step) {
+    for (const auto &step : config.steps) {
+        if (!RunStep(volume, step)) {
+            failed_step = step.op;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NeedsStats(const PipelineConfig &config) {
+    if (config.steps.empty()) return false;
+    const OperatorEntry *entry = FindOperator(config.steps[0].op);
+    return entry && entry->usesStats;
+}
+
+bool CanStream(const PipelineConfig &config) {
+    for (const auto &step : config.steps) {
+        const OperatorEntry *entry = FindOperator(step.op);
+        if (!entry || entry->volumeWide) return false;
+        // 全局自动阈值需要整个体数据的直方图
+        ThresholdMethod method = THRESHOLD_OTSU;
+        if (AutoThresholdMethod(step, method) && !ParamInt(step, "perslice", 0)) return false;
+        // 三维窗口跨切片
+        if (step.op == "BoxMean" && ParamInt(step, "rz", 0) > 0) return false;
+        if (step.op == "FilterMedian" && ParamInt(step, "depth", 1) > 1) return false;
+        if (step.op == "RecursiveGauss" && ParamInt(step, "volume", 1)) return false;
+        if (step.op == "NLMeans" && ParamInt(step, "volume", 0)) return false;
+        if (step.op == "GuidedFilter" && ParamInt(step, "rz", 0) > 0) return false;
+    }
+    return true;
+}
+
+std::string OutputName(const PipelineConfig &config, const std::string &input) {
+    std::string base = input;
+    size_t pos = base.find_last_of("/\\");
+    if (pos != std::string::npos) base.erase(0, pos + 1);
+    pos = base.find_last_of(".");
+    if (pos != std::string::npos) base.erase(pos);
+    return config.output + "/" + base + config.suffix;
+}
+
+std::vector<std::string> ExpandInputs(const std::vector<std::string> &patterns) {
+    std::vector<std::string> files;
+    for (const auto &pattern : patterns) {
+        // @list.txt 每行一个文件名或通配符
+        if (!pattern.empty() && pattern[0] == '@') {
+            std::ifstream in(pattern.substr(1));
+            if (!in) {
+                std::cout << "Error! Can't Open File " << pattern.substr(1) << std::endl;
+                continue;
+            }
+            std::vector<std::string> listed;
+            std::string line;
+            while (std::getline(in, line)) {
+                line = Trim(StripComment(line));
+                if (!line.empty()) listed.push_back(line);
+            }
+            std::vector<std::string> sub = ExpandInputs(listed);
+            files.insert(files.end(), sub.begin(), sub.end());
+            continue;
+        }
+        glob_t result;
+        if (glob(pattern.c_str(), 0, nullptr, &result) == 0) {
+            for (size_t i = 0; i < result.gl_pathc; ++i)
+                files.push_back(result.gl_pathv[i]);
+        } else {
+            std::cout << "No input matches " << pattern << "\n";
+        }
+        globfree(&result);
+    }
+    return files;
+}
+
+void PrintOperators() {
+    std::cout << "Operators:\n";
+    for (const auto &entry : kOperators)
+        std::cout << "  " << entry.name << "  " << entry.params << "\n";
+}
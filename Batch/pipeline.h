@@ -0,0 +1,126 @@
+// Program: DIP
+// FileName:pipeline.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午1:05
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_PIPELINE_H
+#define DIP_PIPELINE_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <volume_stats.h>
+
+class MHDReader;
+
+// 流水线中的一步: 算子名及其参数
+struct PipelineStep {
+    std::string op;
+    std::map<std::string, std::string> params;
+};
+
+// 批处理配置 由流水线描述文件读入 命令行可覆盖
+struct PipelineConfig {
+    std::vector<PipelineStep> steps;
+    std::vector<std::string> inputs;    // 输入文件 支持通配符和@列表文件
+    std::string output = ".";           // 输出目录
+    std::string suffix = "_out";        // 输出文件名后缀
+    size_t volumes = 1;                 // 同时处理的体数据个数
+    size_t threads = 0;                 // 每个体数据的线程数 0为硬件线程数
+                                        // (steal调度时为线程总数)
+    std::string schedule = "static";    // static: 固定并发体数据数; steal: 工作窃取调度;
+                                        // stream: 逐切片读/算/写三级流水线
+    size_t memory = 0;                  // steal调度的内存预算(MB) 0为不限
+};
+
+// 批处理中的一个体数据 尺寸可能被几何变换改变
+struct Volume {
+    std::string name;
+    size_t width = 0, height = 0, slice = 0;
+    double spacing[3] = {1.0, 1.0, 1.0};
+    unsigned char *data = nullptr;      // 指向reader的数据或owned
+    VolumeStats stats;                  // 统计量缓存 每一步之后失效
+
+    Volume() {}
+
+    ~Volume();
+
+    // computeStats: 读入时同时计算统计量
+    bool Load(const std::string &file, bool computeStats = false);
+
+    bool Save(const std::string &file) const;
+
+    // 用新分配(new[])的数据替换当前数据
+    void Replace(unsigned char *im, size_t w, size_t h);
+
+private:
+    Volume(const Volume &);
+
+    Volume &operator=(const Volume &);
+
+    MHDReader *reader = nullptr;
+    unsigned char *owned = nullptr;
+};
+
+/**
+ * @brief 读入流水线描述文件(YAML子集)
+ * @note 格式:
+ *   volumes: 2
+ *   threads: 4
+ *   schedule: steal
+ *   memory: 8192
+ *   output: out
+ *   inputs:
+ *     - data/ct_*.mhd
+ *   pipeline:
+ *     - op: ThresholdTrans
+ *       threshold: 128
+ * @param name 文件名
+ * @param config 输出的配置
+ * @return 是否读入成功
+ */
+bool LoadPipeline(const char *name, PipelineConfig &config);
+
+/**
+ * @brief 检查流水线中的算子名和参数 在处理任何数据前发现错误
+ */
+bool ValidatePipeline(const PipelineConfig &config);
+
+/**
+ * @brief 对体数据执行流水线中的一步
+ */
+bool RunStep(Volume &volume, const PipelineStep &step);
+
+/**
+ * @brief 对体数据依次执行流水线的所有步骤
+ * @param failed_step 失败时输出失败的算子名
+ */
+bool RunPipeline(Volume &volume, const PipelineConfig &config, std::string &failed_step);
+
+/**
+ * @brief 流水线的所有算子是否都逐切片独立处理 可以流式处理
+ * @note 需要整个体数据的算子(如全局直方图均衡)不能流式处理
+ */
+bool CanStream(const PipelineConfig &config);
+
+/**
+ * @brief 第一步算子是否使用统计量缓存 是则读入时顺便计算统计量
+ */
+bool NeedsStats(const PipelineConfig &config);
+
+/**
+ * @brief 输出文件名(无后缀): 输出目录/输入文件名+后缀
+ */
+std::string OutputName(const PipelineConfig &config, const std::string &input);
+
+/**
+ * @brief 展开输入: 通配符(glob)和@列表文件(每行一个文件名)
+ */
+std::vector<std::string> ExpandInputs(const std::vector<std::string> &patterns);
+
+void PrintOperators();
+
+#endif //DIP_PIPELINE_H
@@ -0,0 +1,120 @@
+// Program: DIP
+// FileName:scheduler.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午3:10
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include "scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <mhd_reader.h>
+#include <parallel.h>
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+// 数据本身之外 算子的切片缓冲和尺寸变换的新图按同样大小估计
+const size_t kWorkingSetFactor = 2;
+
+double Ms(Clock::time_point bg, Clock::time_point ed) {
+    return std::chrono::duration<double, std::milli>(ed - bg).count();
+}
+}
+
+size_t MemoryBudget::Acquire(size_t bytes) {
+    if (!_limit) return 0;
+    if (bytes > _limit) bytes = _limit;
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait(lock, [&] { return _used + bytes <= _limit; });
+    _used += bytes;
+    return bytes;
+}
+
+void MemoryBudget::Release(size_t bytes) {
+    if (!_limit || !bytes) return;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _used -= bytes;
+    }
+    _cond.notify_all();
+}
+
+size_t EstimateVolumeBytes(const std::string &file) {
+    MHDReader reader;
+    if (!reader.ReadInfo(file.c_str())) return 0;
+    return reader.GetImWidth() * reader.GetImHeight() * reader.GetImSlice() *
+           reader.GetElementSize() * kWorkingSetFactor;
+}
+
+size_t RunScheduled(const PipelineConfig &config, const std::vector<std::string> &files) {
+    WorkStealingPool pool(config.threads);
+    MemoryBudget budget(config.memory * 1024 * 1024);
+    std::atomic<size_t> failed(0);
+    std::mutex out_mutex;
+    std::cout << files.size() << " volumes, work stealing on " << pool.Size() << " threads";
+    if (config.memory) std::cout << ", memory budget " << config.memory << " MB";
+    std::cout << "\n";
+
+    // 已载入但尚未开始处理的体数据数 限制预取深度
+    size_t queued = 0;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cond;
+    const size_t max_queued = pool.Size() * 2;
+
+    Clock::time_point t_bg = Clock::now();
+    // I/O线程: 按顺序预取 超出预算或排队过多时阻塞
+    for (const auto &file : files) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cond.wait(lock, [&] { return queued < max_queued; });
+        }
+        size_t bytes = budget.Acquire(EstimateVolumeBytes(file));
+        std::shared_ptr<Volume> volume(new Volume);
+        Clock::time_point t0 = Clock::now();
+        bool loaded = volume->Load(file, NeedsStats(config));
+        Clock::time_point t1 = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            ++queued;
+        }
+
+        pool.Submit([&, volume, bytes, loaded, file, t0, t1]() mutable {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                --queued;
+            }
+            queue_cond.notify_one();
+            Clock::time_point t2 = Clock::now();
+            std::string failed_step;
+            bool ok = loaded && RunPipeline(*volume, config, failed_step);
+            Clock::time_point t3 = Clock::now();
+            if (ok) ok = volume->Save(OutputName(config, file));
+            Clock::time_point t4 = Clock::now();
+            std::string dims = std::to_string(volume->width) + "x" + std::to_string(volume->height) +
+                               "x" + std::to_string(volume->slice);
+            // 处理完立即释放数据和预算
+            volume.reset();
+            budget.Release(bytes);
+            if (!ok) ++failed;
+
+            std::lock_guard<std::mutex> lock(out_mutex);
+            std::cout << file << "\t" << dims << "\tread " << Ms(t0, t1) << " ms\tqueued "
+                      << Ms(t1, t2) << " ms\tcompute " << Ms(t2, t3) << " ms\twrite "
+                      << Ms(t3, t4) << " ms";
+            if (!ok) std::cout << "\tFAILED" << (failed_step.empty() ? "" : " at " + failed_step);
+            std::cout << "\n";
+        });
+    }
+    pool.Wait();
+    double total = Ms(t_bg, Clock::now());
+
+    std::cout << "Processed " << files.size() - failed << "/" << files.size()
+              << " volumes in " << total << " ms ("
+              << (total > 0 ? files.size() * 3600.0 * 1000.0 / total : 0.0) << " volumes/hour)\n";
+    return failed;
+}
@@ -0,0 +1,53 @@
+// Program: DIP
+// FileName:scheduler.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午3:10
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_SCHEDULER_H
+#define DIP_SCHEDULER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "pipeline.h"
+
+/**
+ * @brief 内存预算 超出预算时阻塞 单个超过预算的体数据独占全部预算
+ */
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit) : _limit(limit), _used(0) {}
+
+    // 申请内存 返回实际记账的字节数(释放时使用)
+    size_t Acquire(size_t bytes);
+
+    void Release(size_t bytes);
+
+private:
+    size_t _limit;  // 0表示不限
+    size_t _used;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+};
+
+/**
+ * @brief 估计处理一个体数据需要的内存(数据本身加上算子的临时缓冲)
+ * @param file mhd文件名
+ * @return 字节数 读头文件失败返回0
+ */
+size_t EstimateVolumeBytes(const std::string &file);
+
+/**
+ * @brief 工作窃取批处理调度
+ * @note I/O线程按预算预取排队的体数据; 工作线程池逐个处理体数据, 体数据内部的
+ * ParallelFor分块被空闲线程窃取, 小体数据多时体数据间并行, 大体数据时体数据内并行
+ * @param config 流水线配置 threads为线程总数 memory为内存预算(MB)
+ * @param files 输入文件
+ * @return 失败的体数据个数
+ */
+size_t RunScheduled(const PipelineConfig &config, const std::vector<std::string> &files);
+
+#endif //DIP_SCHEDULER_H
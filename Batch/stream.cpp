@@ -0,0 +1,150 @@
+// Program: DIP
+// FileName:stream.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午4:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include "stream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <mhd_reader.h>
+#include <mhd_writer.h>
+#include <parallel.h>
+#include <spsc_queue.h>
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+// 每个计算线程输入/输出队列的深度(切片数)
+const size_t kQueueDepth = 2;
+
+double Ms(Clock::time_point bg, Clock::time_point ed) {
+    return std::chrono::duration<double, std::milli>(ed - bg).count();
+}
+
+// 在各级之间传递的一张切片 nullptr表示结束
+struct SliceTask {
+    Volume volume;
+    bool ok = true;
+    std::string failed_step;
+};
+
+typedef SPSCQueue<SliceTask *> SliceQueue;
+}
+
+bool RunStreamed(const PipelineConfig &config, const std::string &file, size_t workers,
+                 StreamTiming &timing, std::string &failed_step) {
+    MHDReader reader;
+    if (!reader.OpenSlices(file.c_str())) return false;
+    if (reader.GetDataType() != "MET_UCHAR") {
+        std::cout << "Streaming supports MET_UCHAR only: " << file << "\n";
+        return false;
+    }
+    double spacing[3] = {reader.GetSpacingX(), reader.GetSpacingY(), reader.GetSpacingZ()};
+    MHDWriter writer;
+    if (!writer.OpenSlices((OutputName(config, file) + ".mhd").c_str(), spacing)) return false;
+
+    const size_t width = reader.GetImWidth(), height = reader.GetImHeight();
+    const size_t slices = reader.GetImSlice();
+    if (!workers) workers = GetThreadNum();
+    if (workers > slices) workers = slices;
+    if (!workers) workers = 1;
+
+    std::vector<std::unique_ptr<SliceQueue>> in, out;
+    for (size_t i = 0; i < workers; ++i) {
+        in.push_back(std::unique_ptr<SliceQueue>(new SliceQueue(kQueueDepth)));
+        out.push_back(std::unique_ptr<SliceQueue>(new SliceQueue(kQueueDepth)));
+    }
+    std::atomic<bool> stop(false);
+    std::vector<double> compute_ms(workers, 0.0);
+    double read_ms = 0.0, write_ms = 0.0;
+
+    // 读: 第k张切片交给第k%workers个计算线程
+    std::thread read_thread([&]() {
+        for (size_t k = 0; k < slices && !stop; ++k) {
+            Clock::time_point t0 = Clock::now();
+            SliceTask *task = new SliceTask;
+            task->volume.Replace(new unsigned char[width * height], width, height);
+            task->volume.slice = 1;
+            task->volume.name = file;
+            // 以物理单位计的参数(如RecursiveGauss的sigma)按体素间距换算 与整体处理一致
+            std::copy(spacing, spacing + 3, task->volume.spacing);
+            bool ok = reader.ReadSlice(task->volume.data);
+            read_ms += Ms(t0, Clock::now());
+            if (!ok) {
+                std::cout << "Read slice " << k << " failed: " << file << "\n";
+                delete task;
+                stop = true;
+                break;
+            }
+            in[k % workers]->Push(task);
+        }
+        for (size_t i = 0; i < workers; ++i)
+            in[i]->Push(nullptr);
+    });
+
+    // 算: 每张切片按顺序执行流水线的所有步骤 workers个线程已占满线程数, 算子内部的ParallelFor串行执行
+    std::vector<std::thread> compute_threads;
+    for (size_t i = 0; i < workers; ++i) {
+        compute_threads.push_back(std::thread([&, i]() {
+            SerialScope serial;
+            for (SliceTask *task = in[i]->Pop(); task; task = in[i]->Pop()) {
+                Clock::time_point t0 = Clock::now();
+                task->ok = !stop && RunPipeline(task->volume, config, task->failed_step);
+                compute_ms[i] += Ms(t0, Clock::now());
+                out[i]->Push(task);
+            }
+            out[i]->Push(nullptr);
+        }));
+    }
+
+    // 写: 按读入顺序取回 出错后继续取空队列使其它线程能结束
+    bool ok = true;
+    for (size_t k = 0;; ++k) {
+        SliceTask *task = out[k % workers]->Pop();
+        if (!task) break;
+        if (ok && !task->ok) {
+            failed_step = task->failed_step;
+            ok = false;
+            stop = true;
+        }
+        if (ok) {
+            Clock::time_point t0 = Clock::now();
+            ok = writer.WriteSlice(task->volume.data, task->volume.width, task->volume.height);
+            write_ms += Ms(t0, Clock::now());
+            if (!ok) stop = true;
+        }
+        delete task;
+    }
+    read_thread.join();
+    for (auto &t : compute_threads)
+        t.join();
+    // 读线程提前结束时各输出队列还剩结束标记
+    for (size_t i = 0; i < workers; ++i) {
+        SliceTask *task = nullptr;
+        while (out[i]->TryPop(task))
+            delete task;
+    }
+
+    Clock::time_point t0 = Clock::now();
+    ok = ok && !stop && writer.CloseSlices();
+    write_ms += Ms(t0, Clock::now());
+
+    timing.read = read_ms;
+    timing.write = write_ms;
+    timing.compute = 0.0;
+    timing.threads = workers;
+    for (double ms : compute_ms)
+        timing.compute = std::max(timing.compute, ms);
+    timing.width = writer.GetImWidth();
+    timing.height = writer.GetImHeight();
+    timing.slices = writer.GetImSlice();
+    return ok;
+}
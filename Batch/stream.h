@@ -0,0 +1,38 @@
+// Program: DIP
+// FileName:stream.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午4:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_STREAM_H
+#define DIP_STREAM_H
+
+#include <cstddef>
+#include <string>
+#include "pipeline.h"
+
+// 流式处理各阶段的忙碌时间(ms) 不含在队列上的等待 compute为各计算线程中最长的
+struct StreamTiming {
+    double read = 0.0, compute = 0.0, write = 0.0;
+    size_t threads = 0;                         // 计算线程数
+    size_t width = 0, height = 0, slices = 0;   // 输出尺寸
+};
+
+/**
+ * @brief 三级流水线逐切片处理一个体数据: 读线程 -> 计算线程 -> 写线程
+ * @note 读线程按轮转把第k张切片放入第k%n个计算线程的输入队列, 写线程按同样顺序
+ * 从各计算线程的输出队列取回, 每个队列都是单生产者单消费者的有界无锁队列,
+ * 切片顺序不变且内存只占几张切片. 总时间接近max(读, 算, 写)而不是三者之和.
+ * 计算线程内算子的ParallelFor串行执行(SerialScope), 总线程数为workers+2.
+ * 只适用于CanStream的流水线.
+ * @param config 流水线配置
+ * @param file 输入mhd文件
+ * @param workers 计算线程数 0为GetThreadNum()
+ * @param timing 输出各阶段时间
+ * @param failed_step 失败时输出失败的算子名
+ * @return 是否全部切片处理并写出成功
+ */
+bool RunStreamed(const PipelineConfig &config, const std::string &file, size_t workers,
+                 StreamTiming &timing, std::string &failed_step);
+
+#endif //DIP_STREAM_H
@@ -0,0 +1,150 @@
+// Program: DIP
+// FileName:compass.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午8:00
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_COMPASS_H
+#define DIP_COMPASS_H
+
+#include <cstddef>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <line_buffer.h>
+#include <template_trans.h>
+
+/**
+ * @brief 3x3方向(罗盘)模版组 8个方向的模版由同一组环形权重旋转45°得到
+ * @note 8邻域按顺时针排成环: 0左上 1上 2右上 3右 4右下 5下 6左下 7左.
+ * 第k个方向的模版把环形权重从第k个邻域开始放置, 中心为0.
+ */
+enum CompassKernel {
+    COMPASS_KIRSCH = 0,     // 5 5 5 -3 -3 -3 -3 -3
+    COMPASS_ROBINSON = 1,   // 1 2 1 0 -1 -2 -1 0 (Sobel旋转)
+    COMPASS_FREI_CHEN = 2   // 1 √2 1 0 -1 -√2 -1 0 (各向同性梯度旋转)
+};
+
+/**
+ * @brief 一行的方向模版最大响应及其方向 每个邻域只读一次, 8个响应由环上的部分和递推
+ * @note Kirsch: 第k个响应为 8*S_k - 3*R, R为环的和, S_k为从第k个起连续3个邻域的和,
+ * S_{k+1} = S_k + a_{k+3} - a_k, 最大响应即最大的S_k. Robinson/Frei-Chen: 第k个响应为
+ * T_k - T_{k+4}, T_k = a_k + w*a_{k+1} + a_{k+2}. 方向取第一个最大响应的序号(与依次比较
+ * 8个模版相同). 每个像素的计算无分支, 8个方向展开后由编译器按向量指令组合.
+ * @param rows 扩展后的上、中、下三行 指向图像第0列 可访问第-1 ~ width列
+ * @param width 图像宽度
+ * @param kernel 方向模版组
+ * @param response 输出 最大响应 width个
+ * @param direction 输出 最大响应的方向(0 ~ 7) width个 可为空
+ */
+template<class T>
+inline void CompassRow(const T *const *rows, size_t width, CompassKernel kernel,
+                       float *response, unsigned char *direction) {
+    const T *u = rows[0] - 1, *c = rows[1] - 1, *d = rows[2] - 1;
+    if (kernel == COMPASS_KIRSCH) {
+        for (size_t x = 0; x < width; ++x) {
+            const float a[8] = {float(u[x]), float(u[x + 1]), float(u[x + 2]), float(c[x + 2]),
+                                float(d[x + 2]), float(d[x + 1]), float(d[x]), float(c[x])};
+            float s = a[0] + a[1] + a[2], best = s;
+            const float ring = s + a[3] + a[4] + a[5] + a[6] + a[7];
+            unsigned char dir = 0;
+            for (unsigned char k = 1; k < 8; ++k) {
+                s += a[(k + 2) & 7] - a[k - 1];
+                dir = s > best ? k : dir;
+                best = s > best ? s : best;
+            }
+            response[x] = 8.0f * best - 3.0f * ring;
+            if (direction) direction[x] = dir;
+        }
+        return;
+    }
+    const float w = kernel == COMPASS_FREI_CHEN ? 1.41421356f : 2.0f;
+    for (size_t x = 0; x < width; ++x) {
+        const float a[8] = {float(u[x]), float(u[x + 1]), float(u[x + 2]), float(c[x + 2]),
+                            float(d[x + 2]), float(d[x + 1]), float(d[x]), float(c[x])};
+        float t[8];
+        for (size_t k = 0; k < 8; ++k)
+            t[k] = a[k] + w * a[(k + 1) & 7] + a[(k + 2) & 7];
+        float best = t[0] - t[4];
+        unsigned char dir = 0;
+        for (unsigned char k = 1; k < 8; ++k) {
+            const float r = t[k] - t[(k + 4) & 7];
+            dir = r > best ? k : dir;
+            best = r > best ? r : best;
+        }
+        response[x] = best;
+        if (direction) direction[x] = dir;
+    }
+}
+
+/**
+ * @brief 单遍方向模版边缘检测 输出最大响应与方向
+ * @note 由LineBufferScan按行扫描, 每个线程只保存3个按border扩展的行, 源图像不被修改.
+ * 响应与Template以coeff=1计算该方向模版的结果相同.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param kernel 方向模版组
+ * @param response 输出 最大响应 width*height*slice个 可为空
+ * @param direction 输出 最大响应的方向(0 ~ 7) width*height*slice个 可为空
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<class T>
+bool Compass(const T *im, size_t width, size_t height, size_t slice, CompassKernel kernel,
+             float *response, unsigned char *direction, BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pixels = width * height;
+    std::vector<float> work;
+    try {
+        if (!response) work.resize(LineBufferChunkNum(height, slice) * width);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferScan(im, width, height, slice, 1, 1, 1, 1, border, T(0),
+                          [&](size_t k, size_t y, const T *const *rows, size_t chunk) {
+        const size_t p = k * pixels + y * width;
+        CompassRow(rows, width, kernel, response ? response + p : &work[chunk * width],
+                   direction ? direction + p : (unsigned char *) nullptr);
+    });
+}
+
+/**
+ * @brief 原地方向模版边缘检测 输出最大响应 按模版运算取整(超过最大值时为最大值)
+ * @note 8个响应之和为0, 最大响应不小于0.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针 原地输出
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param kernel 方向模版组
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<class T>
+bool CompassOperator(T *im, size_t width, size_t height, size_t slice, CompassKernel kernel,
+                     BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice) return false;
+    std::vector<float> work;
+    try {
+        work.resize(LineBufferChunkNum(height, slice) * width);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferFilter(im, width, height, slice, 1, 1, 1, 1, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        float *response = &work[chunk * width];
+        CompassRow(rows, width, kernel, response, (unsigned char *) nullptr);
+        for (size_t x = 0; x < width; ++x)
+            dst[x] = TemplateValue<T>(response[x]);
+    });
+}
+
+#endif //DIP_COMPASS_H
@@ -8,11 +8,21 @@
 #define DIP_EDGECONTOUR_DETECT_H
 
 #include <cstddef>
+#include <cstring>
+#include <limits>
 #include <new>
 #include <iostream>
 #include <cmath>
+#include <line_buffer.h>
+#include "compass.h"
+#include "gradient.h"
 #include <template_trans.h>
+#include <filter3d.h>
+#include <fft_conv.h>
+#include <volume_stats.h>
+#include <memory>
 #include <stack>
+#include <vector>
 
 /**
  * @brief 用Robert边缘检测算子对图像进行边缘检测。目标图像为灰度图像。
@@ -22,16 +32,21 @@
  * @param width 源图像宽度(像素)
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
+ * @param stats 非空时输出结果图像的统计量 每张切片写回后趁在缓存中统计
  * @return 操作是否成功
  */
 template<typename T>
-bool RobertOperator(T *im, size_t width, size_t height, size_t slice) {
+bool RobertOperator(T *im, size_t width, size_t height, size_t slice,
+                    VolumeStats *stats = nullptr) {
     if (!im) return false;
     T *new_im = nullptr;
+    std::unique_ptr<VolumeStatsBuilder<T> > builder;
     try {
         new_im = new T[width * height];
+        if (stats) builder.reset(new VolumeStatsBuilder<T>(width * height, slice, 1));
     }
     catch (std::bad_alloc) {
+        delete[] new_im;
         std::cout << "Failed to alloc memory!\n";
         return false;
     }
@@ -56,7 +71,9 @@ bool RobertOperator(T *im, size_t width, size_t height, size_t slice) {
             }
         }
         memcpy(im + p0, new_im, sizeof(T) * width * height);
+        if (builder) builder->AddSlices(im + p0, k, k + 1, 0);
     }
+    if (builder) builder->Finish(*stats);
     delete[] new_im;
     return true;
 }
@@ -67,64 +84,20 @@ bool RobertOperator(T *im, size_t width, size_t height, size_t slice) {
  * 垂直方向 -1 -2 -1        水平方向 -1 0 1
  *         0  0  0                -2 0 2
  *         1  2  1                -1 0 1
+ * @note 两个方向由GradientMagnitude单遍同时计算, 取响应绝对值的范数(默认最大值).
  * @tparam T 源图像数据类型
  * @param im 源图像指针
  * @param width 源图像宽度(像素)
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
+ * @param norm 两个方向响应的组合方式
+ * @param border 边缘扩展方式
  * @return 操作是否成功
  */
 template<typename T>
-bool SobelOperator(T *im, size_t width, size_t height, size_t slice) {
-    if (!im) return false;
-    T *new_im1 = nullptr;
-    T *new_im2 = nullptr;
-    try {
-        new_im1 = new T[width * height];
-        new_im2 = new T[width * height];
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to alloc memory!\n";
-        return false;
-    }
-
-    // Sobel模板高度 宽度 中心元素x坐标 y坐标
-    int filterH = 3, filterW = 3, filterCX = 1, filterCY = 1;
-    // 模板系数
-    double coeff = 1.0;
-    // 垂直方向模板数组
-    double tempV[9] = {-1.0, -2.0, -1.0,
-                       0.0, 0.0, 0.0,
-                       1.0, 2.0, 1.0};
-    // 水平方向模板数组
-    double tempH[9] = {-1.0, 0.0, 1.0,
-                       -2.0, 0.0, 2.0,
-                       -1.0, 0.0, 1.0};
-
-    size_t p0 = 0, p1 = 0;
-    for (size_t k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-        memcpy(new_im1, im + p0, sizeof(T) * width * height);
-        memcpy(new_im2, im + p0, sizeof(T) * width * height);
-        if (!Template(new_im1, width, height, 1,
-                      filterW, filterH, filterCX, filterCY, tempV, coeff))
-            return false;
-
-        if (!Template(new_im2, width, height, 1,
-                      filterW, filterH, filterCX, filterCY, tempH, coeff))
-            return false;
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j) {
-                p1 = i * width + j;
-                if (new_im1[p1] < new_im2[p1]) new_im1[p1] = new_im2[p1];
-            }
-        }
-        memcpy(im + p0, new_im1, sizeof(T) * width * height);
-    }
-    delete[] new_im2;
-    delete[] new_im1;
-    return true;
-
+bool SobelOperator(T *im, size_t width, size_t height, size_t slice,
+                   GradientNorm norm = GRADIENT_MAX, BorderMode border = BORDER_REPLICATE) {
+    return GradientMagnitude(im, width, height, slice, GRADIENT_SOBEL, norm, border);
 }
 
 /**
@@ -133,159 +106,67 @@ bool SobelOperator(T *im, size_t width, size_t height, size_t slice) {
  * 垂直方向 -1 -1 -1        水平方向  1 0 -1
  *         0  0  0                 1 0 -1
  *         1  1  1                 1 0 -1
+ * @note 两个方向由GradientMagnitude单遍同时计算, 取响应绝对值的范数(默认最大值).
  * @tparam T 源图像数据类型
  * @param im 源图像指针
  * @param width 源图像宽度(像素)
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
+ * @param norm 两个方向响应的组合方式
+ * @param border 边缘扩展方式
  * @return 操作是否成功
  */
 template<typename T>
-bool PrewittOperator(T *im, size_t width, size_t height, size_t slice) {
-    if (!im) return false;
-    T *new_im1 = nullptr;
-    T *new_im2 = nullptr;
-    try {
-        new_im1 = new T[width * height];
-        new_im2 = new T[width * height];
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to alloc memory!\n";
-        return false;
-    }
-
-    // Sobel模板高度 宽度 中心元素x坐标 y坐标
-    int filterH = 3, filterW = 3, filterCX = 1, filterCY = 1;
-    // 模板系数
-    double coeff = 1.0;
-    // 垂直方向模板数组
-    double tempV[9] = {-1.0, -1.0, -1.0,
-                       0.0, 0.0, 0.0,
-                       1.0, 1.0, 1.0};
-    // 水平方向模板数组
-    double tempH[9] = {1.0, 0.0, -1.0,
-                       1.0, 0.0, -1.0,
-                       1.0, 0.0, -1.0};
-
-    size_t p0 = 0, p1 = 0;
-    for (size_t k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-        memcpy(new_im1, im + p0, sizeof(T) * width * height);
-        memcpy(new_im2, im + p0, sizeof(T) * width * height);
-        if (!Template(new_im1, width, height, 1,
-                      filterW, filterH, filterCX, filterCY, tempV, coeff))
-            return false;
-
-        if (!Template(new_im2, width, height, 1,
-                      filterW, filterH, filterCX, filterCY, tempH, coeff))
-            return false;
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j) {
-                p1 = i * width + j;
-                if (new_im1[p1] < new_im2[p1]) new_im1[p1] = new_im2[p1];
-            }
-        }
-        memcpy(im + p0, new_im1, sizeof(T) * width * height);
-    }
-    delete[] new_im2;
-    delete[] new_im1;
-    return true;
-
+bool PrewittOperator(T *im, size_t width, size_t height, size_t slice,
+                     GradientNorm norm = GRADIENT_MAX, BorderMode border = BORDER_REPLICATE) {
+    return GradientMagnitude(im, width, height, slice, GRADIENT_PREWITT, norm, border);
 }
 
 /**
  * @brief Krisch算子边缘检测 目标图像为灰度图
  * 源图中点用8个方向核做卷积,最大值为输出值
+ * @note 由CompassOperator单遍计算, 每个3x3邻域只读一次, 8个响应由环上的部分和递推.
  * @tparam T 源图像数据类型
  * @param im 源图像指针
  * @param width 源图像宽度(像素)
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
+ * @param border 边缘扩展方式
  * @return 操作是否成功
  */
 template<typename T>
-bool KrischOperator(T *im, size_t width, size_t height, size_t slice) {
-    if (!im) return false;
-    T *new_im1 = nullptr;
-    T *new_im2 = nullptr;
-    try {
-        new_im1 = new T[width * height];
-        new_im2 = new T[width * height];
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to alloc memory!\n";
-        return false;
-    }
-
-    // Sobel模板高度 宽度 中心元素x坐标 y坐标
-    int filterH = 3, filterW = 3, filterCX = 1, filterCY = 1;
-    // 模板系数
-    double coeff = 1.0;
-    // 1方向模板数组
-    double temp1[9] = {5.0, 5.0, 5.0,
-                       -3.0, 0.0, -3.0,
-                       -3.0, -3.0, -3.0};
-    // 2方向模板数组
-    double temp2[9] = {-3.0, 5.0, 5.0,
-                       -3.0, 0.0, 5.0,
-                       -3.0, -3.0, -3.0};
-    // 3方向模板数组
-    double temp3[9] = {-3.0, -3.0, 5.0,
-                       -3.0, 0.0, 5.0,
-                       -3.0, -3.0, 5.0};
-    // 4方向模板数组
-    double temp4[9] = {-3.0, -3.0, -3.0,
-                       -3.0, 0.0, 5.0,
-                       -3.0, 5.0, 5.0};
-    // 5方向模板数组
-    double temp5[9] = {-3.0, -3.0, -3.0,
-                       -3.0, 0.0, -3.0,
-                       5.0, 5.0, 5.0};
-    // 6方向模板数组
-    double temp6[9] = {-3.0, -3.0, -3.0,
-                       5.0, 0.0, -3.0,
-                       5.0, 5.0, -3.0};
-    // 7方向模板数组
-    double temp7[9] = {5.0, -3.0, -3.0,
-                       5.0, 0.0, -3.0,
-                       5.0, -3.0, -3.0};
-    // 8方向模板数组
-    double temp8[9] = {5.0, 5.0, -3.0,
-                       5.0, 0.0, -3.0,
-                       -3.0, -3.0, -3.0};
-    double *temps[8] = {temp1, temp2, temp3, temp4, temp5, temp6, temp7, temp8};
-
-    const int N = 8;    //8个方向的模板数组
-    size_t p0 = 0, p1 = 0;
-    for (size_t k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-
-        // 源图与第1个模板进行卷积运算
-        memcpy(new_im1, im + p0, sizeof(T) * width * height);
-        if (!Template(new_im1, width, height, 1,
-                      filterW, filterH, filterCX, filterCY, temps[0], coeff))
-            return false;
-
-        // 再与7个模板进行卷积运算，将最大的值放入第1个模板的运算结果中
-        for (int i = 1; i < N; ++i) {
-            memcpy(new_im2, im + p0, sizeof(T) * width * height);
-            if (!Template(new_im2, width, height, 1,
-                          filterW, filterH, filterCX, filterCY, temps[i], coeff))
-                return false;
-            for (int i = 0; i < height; ++i) {
-                for (int j = 0; j < width; ++j) {
-                    p1 = i * width + j;
-                    if (new_im1[p1] < new_im2[p1]) new_im1[p1] = new_im2[p1];
-                }
-            }
-        }
-        memcpy(im + p0, new_im1, sizeof(T) * width * height);
+bool KrischOperator(T *im, size_t width, size_t height, size_t slice, BorderMode border = BORDER_REPLICATE) {
+    return CompassOperator(im, width, height, slice, COMPASS_KIRSCH, border);
+}
 
-    }
-    delete[] new_im2;
-    delete[] new_im1;
-    return true;
+/**
+ * @brief Robinson方向算子边缘检测 Sobel模版旋转得到的8个方向核 最大值为输出值
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<typename T>
+bool RobinsonOperator(T *im, size_t width, size_t height, size_t slice, BorderMode border = BORDER_REPLICATE) {
+    return CompassOperator(im, width, height, slice, COMPASS_ROBINSON, border);
+}
 
+/**
+ * @brief Frei-Chen方向算子边缘检测 各向同性梯度模版(权重√2)旋转得到的8个方向核 最大值为输出值
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<typename T>
+bool FreiChenOperator(T *im, size_t width, size_t height, size_t slice, BorderMode border = BORDER_REPLICATE) {
+    return CompassOperator(im, width, height, slice, COMPASS_FREI_CHEN, border);
 }
 
 /**
@@ -300,93 +181,250 @@ bool KrischOperator(T *im, size_t width, size_t height, size_t slice) {
  */
 template<typename T>
 bool GaussLaplaceOperator(T *im, size_t width, size_t height, size_t slice) {
-
     if (!im) return false;
-    T *new_im = nullptr;
-    try {
-        new_im = new T[width * height];
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to alloc memory!\n";
-        return false;
-    }
-
-    // Sobel模板高度 宽度 中心元素x坐标 y坐标
-    int filterH = 5, filterW = 5, filterCX = 2, filterCY = 2;
-    // 模板系数
+    // 模版系数
     double coeff = 1.0;
-    // 模板数组
+    // 模版数组
     double temp[25] = {-2.0, -4.0, -4.0, -4.0, -2.0,
                        -4.0, 0.0, 8.0, 0.0, -4.0,
                        -4.0, 8.0, 24.0, 8.0, -4.0,
                        -4.0, 0.0, 8.0, 0.0, -4.0,
                        -2.0, -4.0, -4.0, -4.0, -2.0};
-    size_t p0 = 0;
-    for (size_t k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-        memcpy(new_im, im + p0, sizeof(T) * width * height);
-        if (!Template(new_im, width, height, 1,
-                      filterW, filterH, filterCX, filterCY, temp, coeff))
-            return false;
-        memcpy(im + p0, new_im, sizeof(T) * width * height);
+    return Convolve(im, width, height, slice, 5, 5, 2, 2, temp, coeff);
+}
+
+/**
+ * @brief 高斯拉普拉斯模版(取负 中心为正) 边长2*ceil(4*sigma)+1
+ * @note 减去均值使系数和为0(平坦区域响应为0), 再缩放使正系数之和与5*5模版相同(56),
+ * 不同sigma的响应幅度相近.
+ * @param sigma 高斯标准差(像素)
+ * @param kernel 输出的模版 size*size
+ * @return 模版边长size
+ */
+inline size_t GaussLaplaceKernel(double sigma, std::vector<double> &kernel) {
+    if (sigma <= 0.0) sigma = 1.0;
+    const long r = long(std::ceil(4.0 * sigma));
+    const size_t size = size_t(2 * r + 1);
+    kernel.assign(size * size, 0.0);
+    double mean = 0.0;
+    for (long y = -r; y <= r; ++y) {
+        for (long x = -r; x <= r; ++x) {
+            double q = (x * x + y * y) / (2.0 * sigma * sigma);
+            double v = (1.0 - q) * std::exp(-q);
+            kernel[(y + r) * size + x + r] = v;
+            mean += v;
+        }
     }
-    delete[] new_im;
-    return true;
+    mean /= double(size * size);
+    double positive = 0.0;
+    for (size_t i = 0; i < kernel.size(); ++i) {
+        kernel[i] -= mean;
+        if (kernel[i] > 0.0) positive += kernel[i];
+    }
+    for (size_t i = 0; i < kernel.size(); ++i)
+        kernel[i] *= 56.0 / positive;
+    return size;
 }
 
 /**
- * @brief 轮廓提取运算 根据8领域 效率较低
+ * @brief 任意尺度的高斯拉普拉斯边缘检测
+ * @note 大sigma的模版很大且不可分离, 由Convolve按代价模型自动改用频域(重叠保留法)卷积.
  * @tparam T 源图像数据类型
  * @param im 源图像指针
  * @param width 源图像宽度(像素)
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
+ * @param sigma 高斯标准差(像素)
+ * @param domain 卷积方式 默认自动选择
  * @return 操作是否成功
  */
 template<typename T>
-bool Contour(T *im, size_t width, size_t height, size_t slice) {
+bool GaussLaplaceOperator(T *im, size_t width, size_t height, size_t slice, double sigma,
+                          ConvolutionDomain domain = CONV_AUTO) {
     if (!im) return false;
-    T *new_im = nullptr;
-    try {
-        new_im = new T[width * height];
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to alloc memory!\n";
-        return false;
+    std::vector<double> kernel;
+    size_t size = GaussLaplaceKernel(sigma, kernel);
+    return Convolve(im, width, height, slice, size, size, size / 2, size / 2, kernel.data(), 1.0, domain);
+}
+
+/**
+ * @brief 三维梯度算子 各方向分量为该方向差分[-1 0 1]与另两方向平滑模版的乘积
+ * @note 分量除以平滑模版系数和, z方向不变的图像x、y分量与二维算子相同; 再乘以spacing[0]/spacing[a]
+ * 换算为每x方向体素间距的灰度变化, 层厚较大时z方向差分相应缩小. 输出为梯度模长.
+ * 三个分量由SeparableFilter3D一次滑动窗口同时计算, 边缘体素按border扩展后同样处理.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param smooth 平滑模版 3个系数
+ * @param spacing x、y、z方向的体素间距 为空时均为1
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<typename T>
+bool GradientOperator3D(T *im, size_t width, size_t height, size_t slice, const double *smooth,
+                        const double *spacing = nullptr, BorderMode border = BORDER_REPLICATE) {
+    if (!im || !smooth) return false;
+    const double sum = smooth[0] + smooth[1] + smooth[2];
+    std::vector<double> s(smooth, smooth + 3), d(3);
+    std::vector<SeparableTerm3D> terms(3);
+    for (size_t a = 0; a < 3; ++a) {
+        const double scale = spacing && spacing[a] > 0.0 && spacing[0] > 0.0 ? spacing[0] / spacing[a] : 1.0;
+        d[0] = -scale / sum, d[1] = 0.0, d[2] = scale / sum;
+        terms[a].kx = a == 0 ? d : s;
+        terms[a].ky = a == 1 ? d : s;
+        terms[a].kz = a == 2 ? d : s;
     }
+    // gy与gz的x方向模版相同 放在相邻位置共用x方向滤波
+    return SeparableFilter3D(im, width, height, slice, 3, 3, 3, 1, 1, 1, terms, [](const double *v) {
+        return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }, border);
+}
 
-    // 八个方向
-    T n, s, w, e, nw, ne, sw, se;
-    size_t p = 0, t = 0;
-    T max = std::numeric_limits<T>::max();
-    for (size_t k = 0; k < slice; ++k) {
-        // 初始化全为白色
-        memset(new_im, max, sizeof(T) * width * height);
-        p = k * width * height;
-        for (size_t i = 1; i < height - 1; ++i) {
-            for (size_t j = 1; j < width - 1; ++j) {
-                t = p + i * width + j;
-                // 若当前点为黑 统计当前点的八个方向
-                if (im[t] == 0) {
-                    n = im[t - width];
-                    nw = im[t - width - 1];
-                    ne = im[t - width + 1];
-                    s = im[t + width];
-                    sw = im[t + width - 1];
-                    se = im[t + width + 1];
-                    w = im[t - 1];
-                    e = im[t + 1];
-                    // 若不全为黑(边界 非内部点) 则设黑
-                    // 否则全黑(非边界 内部点) 仍然是初始值白
-                    if (n || nw || ne || s || sw || se || w || e)
-                        new_im[i * width + j] = 0;
-                }
-            }
+/**
+ * @brief 三维Sobel边缘检测 平滑模版[1 2 1] 输出梯度模长
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param spacing x、y、z方向的体素间距 为空时均为1
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<typename T>
+bool SobelOperator3D(T *im, size_t width, size_t height, size_t slice, const double *spacing = nullptr,
+                     BorderMode border = BORDER_REPLICATE) {
+    const double smooth[3] = {1.0, 2.0, 1.0};
+    return GradientOperator3D(im, width, height, slice, smooth, spacing, border);
+}
+
+/**
+ * @brief 三维Prewitt边缘检测 平滑模版[1 1 1] 输出梯度模长
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param spacing x、y、z方向的体素间距 为空时均为1
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<typename T>
+bool PrewittOperator3D(T *im, size_t width, size_t height, size_t slice, const double *spacing = nullptr,
+                       BorderMode border = BORDER_REPLICATE) {
+    const double smooth[3] = {1.0, 1.0, 1.0};
+    return GradientOperator3D(im, width, height, slice, smooth, spacing, border);
+}
+
+/**
+ * @brief 三维高斯拉普拉斯模版 以三个可分离项之和表示(取负 中心为正)
+ * @note -(Gxx*Gy*Gz + Gx*Gyy*Gz + Gx*Gy*Gzz), sigma以毫米计, 各方向按体素间距换算为
+ * sigma/spacing个体素, 半径ceil(4*sigma/spacing). 二阶导数按物理坐标求, 层厚不同时仍是各向同性的
+ * 拉普拉斯. 一维高斯归一化为和1, 二阶导数减去高斯的倍数使和为0(平坦区域响应为0), 最后与二维模版
+ * 相同缩放使三维模版正系数之和为56.
+ * @param sigma 高斯标准差(毫米)
+ * @param spacing x、y、z方向的体素间距 为空时均为1
+ * @param terms 输出的三个模版项
+ */
+inline void GaussLaplaceKernel3D(double sigma, const double *spacing, std::vector<SeparableTerm3D> &terms) {
+    if (sigma <= 0.0) sigma = 1.0;
+    std::vector<double> g[3], g2[3];
+    for (size_t a = 0; a < 3; ++a) {
+        const double sp = spacing && spacing[a] > 0.0 ? spacing[a] : 1.0;
+        const double s = sigma / sp;
+        const long r = long(std::ceil(4.0 * s));
+        g[a].resize(2 * r + 1);
+        g2[a].resize(2 * r + 1);
+        double sum = 0.0, sum2 = 0.0;
+        for (long i = -r; i <= r; ++i) {
+            const double q = i * i / (2.0 * s * s);
+            g[a][i + r] = std::exp(-q);
+            g2[a][i + r] = (i * i / (s * s) - 1.0) / (s * s) * std::exp(-q) / (sp * sp);
+            sum += g[a][i + r];
         }
-        memcpy(im + p, new_im, sizeof(T) * width * height);
+        for (size_t i = 0; i < g[a].size(); ++i) {
+            g[a][i] /= sum;
+            g2[a][i] /= sum;
+            sum2 += g2[a][i];
+        }
+        for (size_t i = 0; i < g[a].size(); ++i)
+            g2[a][i] -= sum2 * g[a][i];
     }
-    delete[] new_im;
-    return true;
+    double positive = 0.0;
+    for (size_t n = 0; n < g[2].size(); ++n)
+        for (size_t l = 0; l < g[1].size(); ++l)
+            for (size_t m = 0; m < g[0].size(); ++m) {
+                const double v = -(g2[0][m] * g[1][l] * g[2][n] + g[0][m] * g2[1][l] * g[2][n] +
+                                   g[0][m] * g[1][l] * g2[2][n]);
+                if (v > 0.0) positive += v;
+            }
+    const double scale = -56.0 / positive;
+    terms.resize(3);
+    for (size_t a = 0; a < 3; ++a) {
+        terms[a].kx = a == 0 ? g2[0] : g[0];
+        terms[a].ky = a == 1 ? g2[1] : g[1];
+        terms[a].kz = a == 2 ? g2[2] : g[2];
+    }
+    for (size_t a = 0; a < 3; ++a)
+        for (size_t i = 0; i < terms[a].kz.size(); ++i)
+            terms[a].kz[i] *= scale;
+}
+
+/**
+ * @brief 三维高斯拉普拉斯边缘检测 sigma以毫米计
+ * @note 模版为三个可分离项之和, 由SeparableFilter3D在一次滑动窗口中同时计算, 每体素约
+ * 2*(fw+fh+fd)+fw次乘加(后两项共用x方向滤波), 与整块三维模版的fw*fh*fd次相比与尺度近似线性.
+ * 边缘体素按border扩展后同样处理.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param sigma 高斯标准差(毫米)
+ * @param spacing x、y、z方向的体素间距 为空时均为1
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<typename T>
+bool GaussLaplaceOperator3D(T *im, size_t width, size_t height, size_t slice, double sigma,
+                            const double *spacing = nullptr, BorderMode border = BORDER_REPLICATE) {
+    if (!im) return false;
+    std::vector<SeparableTerm3D> terms;
+    GaussLaplaceKernel3D(sigma, spacing, terms);
+    const size_t fw = terms[0].kx.size(), fh = terms[0].ky.size(), fd = terms[0].kz.size();
+    return SeparableFilter3D(im, width, height, slice, fw, fh, fd, fw / 2, fh / 2, fd / 2, terms,
+                             [](const double *v) { return v[0] + v[1] + v[2]; }, border);
+}
+
+/**
+ * @brief 轮廓提取运算 根据8领域
+ * @note 黑色点的八邻域不全为黑时为轮廓点(黑), 其余为白. 由LineBufferFilter按行原地处理, 只保存
+ * 3个按border扩展的行(常数扩展为白色背景, 贴着图像边缘的目标在边缘处也有轮廓), 所有像素用同一个
+ * 无分支的内层循环计算.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param border 边缘扩展方式 常数扩展时补白色
+ * @return 操作是否成功
+ */
+template<typename T>
+bool Contour(T *im, size_t width, size_t height, size_t slice, BorderMode border = BORDER_CONSTANT) {
+    const T max = std::numeric_limits<T>::max();
+    return LineBufferFilter(im, width, height, slice, 1, 1, 1, 1, border, max,
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t) {
+        // 上、中、下三行 从第-1列起
+        const T *u = rows[0] - 1, *c = rows[1] - 1, *d = rows[2] - 1;
+        for (size_t j = 0; j < width; ++j) {
+            // 八个方向中有白色点(非内部点)
+            const bool edge = (u[j] != 0) | (u[j + 1] != 0) | (u[j + 2] != 0) | (c[j] != 0) |
+                              (c[j + 2] != 0) | (d[j] != 0) | (d[j + 1] != 0) | (d[j + 2] != 0);
+            dst[j] = c[j + 1] == 0 && edge ? T(0) : max;
+        }
+    });
 }
 
 
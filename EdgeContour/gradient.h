@@ -0,0 +1,195 @@
+// Program: DIP
+// FileName:gradient.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午7:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_GRADIENT_H
+#define DIP_GRADIENT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <line_buffer.h>
+#include <template_trans.h>
+
+/**
+ * @brief 3x3梯度算子 差分方向为[-1 0 1], 垂直方向平滑模版为[1 w 1]
+ */
+enum GradientKernel {
+    GRADIENT_SOBEL = 0,     // w = 2
+    GRADIENT_PREWITT = 1    // w = 1
+};
+
+/**
+ * @brief 梯度模长的范数
+ */
+enum GradientNorm {
+    GRADIENT_L1 = 0,        // |gx| + |gy|
+    GRADIENT_L2 = 1,        // sqrt(gx^2 + gy^2)
+    GRADIENT_MAX = 2        // max(|gx|, |gy|)
+};
+
+/**
+ * @brief Gradient的输出缓冲 每个非空时为width*height*slice个 由调用者分配
+ * @note gx为向右(x增大)的变化, gy为向下(y增大)的变化. angle = atan2(gy, gx) 弧度, (-pi, pi].
+ * sector为量化到4个方向的梯度方向(非极大值抑制用): 0水平 比较(x-1,y)与(x+1,y);
+ * 1 比较(x-1,y-1)与(x+1,y+1); 2垂直 比较(x,y-1)与(x,y+1); 3 比较(x+1,y-1)与(x-1,y+1).
+ */
+struct GradientOutput {
+    float *gx = nullptr;
+    float *gy = nullptr;
+    float *magnitude = nullptr;
+    float *angle = nullptr;
+    unsigned char *sector = nullptr;
+};
+
+inline float GradientWeight(GradientKernel kernel) {
+    return kernel == GRADIENT_PREWITT ? 1.0f : 2.0f;
+}
+
+/**
+ * @brief 一行的梯度分量 先按列求平滑与差分(width+2列), 再沿行组合, 内层循环均可向量化
+ * @param rows 扩展后的上、中、下三行 指向图像第0列 可访问第-1 ~ width列
+ * @param width 图像宽度
+ * @param weight 平滑模版中心权重
+ * @param work 工作缓冲 2*(width+2)个
+ * @param gx 输出 width个
+ * @param gy 输出 width个
+ */
+template<class T>
+inline void GradientRow(const T *const *rows, size_t width, float weight, float *work, float *gx, float *gy) {
+    const T *u = rows[0] - 1, *c = rows[1] - 1, *d = rows[2] - 1;
+    float *smooth = work, *diff = work + width + 2;
+    for (size_t j = 0; j < width + 2; ++j) {
+        smooth[j] = float(u[j]) + weight * float(c[j]) + float(d[j]);
+        diff[j] = float(d[j]) - float(u[j]);
+    }
+    for (size_t x = 0; x < width; ++x) {
+        gx[x] = smooth[x + 2] - smooth[x];
+        gy[x] = diff[x] + weight * diff[x + 1] + diff[x + 2];
+    }
+}
+
+/**
+ * @brief 一行的梯度模长
+ */
+inline void GradientNormRow(const float *gx, const float *gy, size_t width, GradientNorm norm, float *magnitude) {
+    switch (norm) {
+        case GRADIENT_L1:
+            for (size_t x = 0; x < width; ++x)
+                magnitude[x] = std::fabs(gx[x]) + std::fabs(gy[x]);
+            break;
+        case GRADIENT_MAX:
+            for (size_t x = 0; x < width; ++x)
+                magnitude[x] = std::max(std::fabs(gx[x]), std::fabs(gy[x]));
+            break;
+        default:
+            for (size_t x = 0; x < width; ++x)
+                magnitude[x] = std::sqrt(gx[x] * gx[x] + gy[x] * gy[x]);
+    }
+}
+
+/**
+ * @brief 梯度方向量化为4个方向 不求反正切 以tan(22.5°)比较两个分量
+ */
+inline unsigned char GradientSector(float gx, float gy) {
+    const float ax = std::fabs(gx), ay = std::fabs(gy), t = 0.41421356f;
+    if (ay <= t * ax) return 0;
+    if (ax <= t * ay) return 2;
+    return (gx > 0.0f) == (gy > 0.0f) ? 1 : 3;
+}
+
+/**
+ * @brief 单遍Sobel/Prewitt梯度 同时计算gx、gy 按需输出分量、模长与方向
+ * @note 由LineBufferScan按行扫描, 每个线程只保存3个按border扩展的行, 源图像只读一遍且不被修改,
+ * 结果直接写入out中非空的缓冲. 分量不除以模版系数和, 与Template以coeff=1计算的结果相同.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param out 输出缓冲
+ * @param kernel 梯度算子
+ * @param norm 模长的范数
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<class T>
+bool Gradient(const T *im, size_t width, size_t height, size_t slice, const GradientOutput &out,
+              GradientKernel kernel = GRADIENT_SOBEL, GradientNorm norm = GRADIENT_L2,
+              BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pixels = width * height, row = 2 * (width + 2) + 2 * width;
+    const float weight = GradientWeight(kernel);
+    std::vector<float> work;
+    try {
+        work.resize(LineBufferChunkNum(height, slice) * row);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferScan(im, width, height, slice, 1, 1, 1, 1, border, T(0),
+                          [&](size_t k, size_t y, const T *const *rows, size_t chunk) {
+        const size_t p = k * pixels + y * width;
+        float *w = &work[chunk * row], *tmp = w + 2 * (width + 2);
+        // 需要输出分量时直接写入输出缓冲
+        float *gx = out.gx ? out.gx + p : tmp;
+        float *gy = out.gy ? out.gy + p : tmp + width;
+        GradientRow(rows, width, weight, w, gx, gy);
+        if (out.magnitude) GradientNormRow(gx, gy, width, norm, out.magnitude + p);
+        if (out.angle) {
+            for (size_t x = 0; x < width; ++x)
+                out.angle[p + x] = std::atan2(gy[x], gx[x]);
+        }
+        if (out.sector) {
+            for (size_t x = 0; x < width; ++x)
+                out.sector[p + x] = GradientSector(gx[x], gy[x]);
+        }
+    });
+}
+
+/**
+ * @brief 原地计算梯度模长 结果按模版运算取整(超过最大值时为最大值)
+ * @note 与Gradient共用行计算, 由LineBufferFilter按行原地写回, 不需要整张切片的副本.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针 原地输出
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param kernel 梯度算子
+ * @param norm 模长的范数
+ * @param border 边缘扩展方式
+ * @return 操作是否成功
+ */
+template<class T>
+bool GradientMagnitude(T *im, size_t width, size_t height, size_t slice,
+                       GradientKernel kernel = GRADIENT_SOBEL, GradientNorm norm = GRADIENT_L2,
+                       BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t row = 2 * (width + 2) + 3 * width;
+    const float weight = GradientWeight(kernel);
+    std::vector<float> work;
+    try {
+        work.resize(LineBufferChunkNum(height, slice) * row);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferFilter(im, width, height, slice, 1, 1, 1, 1, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        float *w = &work[chunk * row], *gx = w + 2 * (width + 2), *gy = gx + width, *magnitude = gy + width;
+        GradientRow(rows, width, weight, w, gx, gy);
+        GradientNormRow(gx, gy, width, norm, magnitude);
+        for (size_t x = 0; x < width; ++x)
+            dst[x] = TemplateValue<T>(magnitude[x]);
+    });
+}
+
+#endif //DIP_GRADIENT_H
@@ -55,6 +55,37 @@ int TestEdgeDetection(const char *inname, const char *outname, size_t index) {
             flag = ::Fill2(reader->GetImData(), reader->GetImWidth(), reader->GetImHeight(), reader->GetImSlice(),
                            reader->GetImWidth() / 2, reader->GetImHeight() / 2);
             break;
+        case 9: {
+            // 大尺度LoG 模版大时自动用频域卷积
+            double sigma = 3.0;
+            std::cout << "Enter the sigma:\t";
+            std::cin >> sigma;
+            t_bg = clock();
+            flag = ::GaussLaplaceOperator(reader->GetImData(), reader->GetImWidth(),
+                                          reader->GetImHeight(), reader->GetImSlice(), sigma);
+            break;
+        }
+        case 10:
+        case 11:
+        case 12: {
+            // 三维算子 按体素间距换算
+            double spacing[3] = {reader->GetSpacingX(), reader->GetSpacingY(), reader->GetSpacingZ()};
+            if (index == 10) {
+                flag = ::SobelOperator3D(reader->GetImData(), reader->GetImWidth(),
+                                         reader->GetImHeight(), reader->GetImSlice(), spacing);
+            } else if (index == 11) {
+                flag = ::PrewittOperator3D(reader->GetImData(), reader->GetImWidth(),
+                                           reader->GetImHeight(), reader->GetImSlice(), spacing);
+            } else {
+                double sigma = 1.0;
+                std::cout << "Enter the sigma (mm):\t";
+                std::cin >> sigma;
+                t_bg = clock();
+                flag = ::GaussLaplaceOperator3D(reader->GetImData(), reader->GetImWidth(),
+                                                reader->GetImHeight(), reader->GetImSlice(), sigma, spacing);
+            }
+            break;
+        }
         default:
             break;
     }
@@ -85,7 +116,11 @@ int main(int argc, char *argv[]) {
               << "5: Contour\n"
               << "6: Trace Contour\n"
               << "7: Seed fill\n"
-              << "8: Seed fill 2\n";
+              << "8: Seed fill 2\n"
+              << "9: Gaussian Laplace Edge Detection (any sigma)\n"
+              << "10: SobelOperator Edge Detection 3D\n"
+              << "11: PrewittOperator Edge Detection 3D\n"
+              << "12: Gaussian Laplace Edge Detection 3D (sigma in mm)\n";
     size_t index = 0;
     std::cin >> index;
     return TestEdgeDetection(argv[1], argv[2], index);
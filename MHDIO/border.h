@@ -0,0 +1,107 @@
+// Program: DIP
+// FileName:border.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午5:00
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_BORDER_H
+#define DIP_BORDER_H
+
+#include <cstddef>
+#include <cstring>
+
+/**
+ * @brief 邻域运算的边缘扩展方式 (以abcd为一行)
+ */
+enum BorderMode {
+    BORDER_CONSTANT = 0,    // 常数         vv|abcd|vv
+    BORDER_REPLICATE = 1,   // 复制边缘     aa|abcd|dd
+    BORDER_REFLECT = 2,     // 镜像 不重复边缘 cb|abcd|cb
+    BORDER_WRAP = 3         // 周期         cd|abcd|ab
+};
+
+/**
+ * @brief 越界坐标按扩展方式映射回[0, n)
+ * @param i 坐标 可为负或不小于n
+ * @param n 该方向的长度
+ * @param mode 扩展方式
+ * @return 映射后的坐标 常数扩展越界时为-1
+ */
+inline long BorderIndex(long i, long n, BorderMode mode) {
+    if (i >= 0 && i < n) return i;
+    switch (mode) {
+        case BORDER_REPLICATE:
+            return i < 0 ? 0 : n - 1;
+        case BORDER_REFLECT: {
+            if (n == 1) return 0;
+            const long period = 2 * (n - 1);
+            i %= period;
+            if (i < 0) i += period;
+            return i < n ? i : period - i;
+        }
+        case BORDER_WRAP:
+            i %= n;
+            return i < 0 ? i + n : i;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief 扩展一行 左右各补left、right个像素
+ * @tparam T 图像数据类型
+ * @param src 源行 width个像素 为空时整行(常数扩展时越界的行)填value
+ * @param width 图像宽度
+ * @param left 左侧扩展像素数
+ * @param right 右侧扩展像素数
+ * @param mode 扩展方式
+ * @param value 常数扩展的值
+ * @param dst 输出 left+width+right个像素
+ */
+template<class T>
+void PadRow(const T *src, size_t width, size_t left, size_t right, BorderMode mode, T value, T *dst) {
+    const size_t pw = left + width + right;
+    if (!src) {
+        for (size_t x = 0; x < pw; ++x)
+            dst[x] = value;
+        return;
+    }
+    memcpy(dst + left, src, width * sizeof(T));
+    for (size_t x = 0; x < left; ++x) {
+        const long i = BorderIndex(long(x) - long(left), long(width), mode);
+        dst[x] = i < 0 ? value : src[i];
+    }
+    for (size_t x = 0; x < right; ++x) {
+        const long i = BorderIndex(long(width + x), long(width), mode);
+        dst[left + width + x] = i < 0 ? value : src[i];
+    }
+}
+
+/**
+ * @brief 建立一张切片中[y0, y1)行(可越出图像)的扩展缓冲 内层循环可对所有像素无分支地访问邻域
+ * @note 缓冲第r行为图像第y0+r行(越界时按mode映射), 行长left+width+right, 图像第x列位于第left+x列.
+ * 整张切片取 y0 = -top, y1 = height + bottom; 分块处理时取块的行范围加上下半径.
+ * @tparam T 图像数据类型
+ * @param src 切片数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param y0 起始行
+ * @param y1 结束行(不含)
+ * @param left 左侧扩展像素数
+ * @param right 右侧扩展像素数
+ * @param mode 扩展方式
+ * @param value 常数扩展的值
+ * @param dst 输出 (y1-y0)*(left+width+right)个像素
+ */
+template<class T>
+void PadRows(const T *src, size_t width, size_t height, long y0, long y1,
+             size_t left, size_t right, BorderMode mode, T value, T *dst) {
+    const size_t pw = left + width + right;
+    for (long y = y0; y < y1; ++y) {
+        const long i = BorderIndex(y, long(height), mode);
+        PadRow(i < 0 ? (const T *) nullptr : src + i * width, width, left, right, mode, value,
+               dst + (y - y0) * pw);
+    }
+}
+
+#endif //DIP_BORDER_H
@@ -0,0 +1,206 @@
+// Program: DIP
+// FileName:line_buffer.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午6:10
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_LINE_BUFFER_H
+#define DIP_LINE_BUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include "border.h"
+#include "parallel.h"
+
+/**
+ * @brief LineBufferFilter每张切片划分的行带数 切片数不少于分块数时为1
+ */
+inline size_t LineBufferBands(size_t height, size_t slice, size_t grain) {
+    const size_t chunks = ParallelChunkNum(0, height, grain);
+    return slice >= chunks ? 1 : (chunks + slice - 1) / slice;
+}
+
+/**
+ * @brief LineBufferFilter的分块数 用于预先分配各分块私有的工作缓冲
+ */
+inline size_t LineBufferChunkNum(size_t height, size_t slice, size_t grain = 8) {
+    return ParallelChunkNum(0, slice * LineBufferBands(height, slice, grain));
+}
+
+/**
+ * @brief 行环形缓冲的原地二维邻域运算框架 每个线程只保存top+bottom+1个扩展行
+ * @note 输出第y行需要原图第y-top ~ y+bottom行. 按行递增处理, 每行只把第y+bottom行按mode扩展后
+ * 放入环形缓冲, 输出直接写回原图第y行(此后只从缓冲读取该行原值), 不需要整张切片的副本和写回.
+ * 切片数不少于分块数时切片间并行; 否则每张切片再分为行带, 各行带上下的halo行在任何行带写回之前
+ * 先统一保存. 越出图像的行(复制、镜像、周期扩展可能映射到已写回的行)也预先保存, 因此各种扩展方式
+ * 的结果都与先复制整张切片再计算相同.
+ * func(k, y, rows, dst, chunk): 计算第k张切片第y行写入dst(width个像素). rows[l]为扩展后的
+ * 第y-top+l行, 指向图像第0列, 可访问[-left, width+right)列; func只能从rows读取原值.
+ * chunk为分块序号(0 ~ LineBufferChunkNum(height, slice, grain)-1), 可用于索引各分块的工作缓冲.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param left 左侧扩展像素数
+ * @param right 右侧扩展像素数
+ * @param top 上方需要的行数
+ * @param bottom 下方需要的行数
+ * @param mode 边缘扩展方式
+ * @param value 常数扩展的值
+ * @param func 单行的计算函数
+ * @param grain 每个行带最少的行数
+ * @return 是否操作成功
+ */
+template<class T, class F>
+bool LineBufferFilter(T *im, size_t width, size_t height, size_t slice,
+                      size_t left, size_t right, size_t top, size_t bottom,
+                      BorderMode mode, T value, F func, size_t grain = 8) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pw = left + width + right, rows = top + bottom + 1, halo = top + bottom;
+    const size_t pixels = width * height;
+    const size_t bands = LineBufferBands(height, slice, grain), units = slice * bands;
+    // 第u个单元为第u/bands张切片的第u%bands个行带
+    auto band = [&](size_t u, size_t &y0, size_t &y1) {
+        y0 = height * (u % bands) / bands;
+        y1 = height * (u % bands + 1) / bands;
+    };
+    // 保存单元的halo行(已扩展): 前top行为y0-top ~ y0-1, 后bottom行为y1 ~ y1+bottom-1
+    auto save = [&](size_t u, T *dst) {
+        size_t y0, y1;
+        band(u, y0, y1);
+        const T *src = im + (u / bands) * pixels;
+        for (size_t i = 0; i < halo; ++i) {
+            const long y = i < top ? long(y0) - long(top - i) : long(y1 + i - top);
+            const long r = BorderIndex(y, long(height), mode);
+            PadRow(r < 0 ? (const T *) nullptr : src + r * width, width, left, right, mode, value,
+                   dst + i * pw);
+        }
+    };
+    std::vector<T> saved;
+    try {
+        if (bands > 1) saved.resize(units * halo * pw);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    if (bands > 1 && halo) {
+        ParallelFor(0, units, [&](size_t b, size_t e, size_t) {
+            for (size_t u = b; u < e; ++u)
+                save(u, saved.data() + u * halo * pw);
+        }, 1);
+    }
+    bool ok = true;
+    ParallelFor(0, units, [&](size_t b, size_t e, size_t chunk) {
+        std::vector<T> ring, own;
+        std::vector<const T *> ptr;
+        try {
+            ring.resize(rows * pw);
+            ptr.resize(rows);
+            if (bands == 1) own.resize(halo * pw);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            ok = false;
+            return;
+        }
+        for (size_t u = b; u < e; ++u) {
+            size_t y0, y1;
+            band(u, y0, y1);
+            T *src = im + (u / bands) * pixels;
+            // 整张切片由本分块处理时 开始前保存即可
+            if (bands == 1) save(u, own.data());
+            const T *h = bands == 1 ? own.data() : saved.data() + u * halo * pw;
+            // 扩展后的第y行放入环形缓冲第(y-y0+top)%rows行
+            auto load = [&](long y) {
+                T *dst = &ring[size_t(y - long(y0) + long(top)) % rows * pw];
+                if (y < long(y0))
+                    memcpy(dst, h + size_t(y - long(y0) + long(top)) * pw, pw * sizeof(T));
+                else if (y >= long(y1))
+                    memcpy(dst, h + (top + size_t(y - long(y1))) * pw, pw * sizeof(T));
+                else
+                    PadRow(src + y * width, width, left, right, mode, value, dst);
+            };
+            for (long y = long(y0) - long(top); y < long(y0 + bottom); ++y)
+                load(y);
+            for (size_t y = y0; y < y1; ++y) {
+                load(long(y + bottom));
+                for (size_t l = 0; l < rows; ++l)
+                    ptr[l] = &ring[(y - y0 + l) % rows * pw + left];
+                func(u / bands, y, ptr.data(), src + y * width, chunk);
+            }
+        }
+    }, 1);
+    return ok;
+}
+
+/**
+ * @brief 行环形缓冲的只读二维邻域扫描 结果由func写入调用者的缓冲
+ * @note 与LineBufferFilter相同按(切片, 行带)分块并行, 每个线程只保存top+bottom+1个扩展行;
+ * 源图像不被修改, 不需要保存halo行.
+ * func(k, y, rows, chunk): rows[l]为第k张切片扩展后的第y-top+l行, 指向图像第0列,
+ * 可访问[-left, width+right)列. chunk为分块序号(0 ~ LineBufferChunkNum(height, slice, grain)-1).
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param left 左侧扩展像素数
+ * @param right 右侧扩展像素数
+ * @param top 上方需要的行数
+ * @param bottom 下方需要的行数
+ * @param mode 边缘扩展方式
+ * @param value 常数扩展的值
+ * @param func 单行的计算函数
+ * @param grain 每个行带最少的行数
+ * @return 是否操作成功
+ */
+template<class T, class F>
+bool LineBufferScan(const T *im, size_t width, size_t height, size_t slice,
+                    size_t left, size_t right, size_t top, size_t bottom,
+                    BorderMode mode, T value, F func, size_t grain = 8) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pw = left + width + right, rows = top + bottom + 1;
+    const size_t pixels = width * height;
+    const size_t bands = LineBufferBands(height, slice, grain), units = slice * bands;
+    bool ok = true;
+    ParallelFor(0, units, [&](size_t b, size_t e, size_t chunk) {
+        std::vector<T> ring;
+        std::vector<const T *> ptr;
+        try {
+            ring.resize(rows * pw);
+            ptr.resize(rows);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            ok = false;
+            return;
+        }
+        for (size_t u = b; u < e; ++u) {
+            const size_t k = u / bands;
+            const size_t y0 = height * (u % bands) / bands, y1 = height * (u % bands + 1) / bands;
+            const T *src = im + k * pixels;
+            auto load = [&](long y) {
+                const long r = BorderIndex(y, long(height), mode);
+                PadRow(r < 0 ? (const T *) nullptr : src + r * width, width, left, right, mode, value,
+                       &ring[size_t(y - long(y0) + long(top)) % rows * pw]);
+            };
+            for (long y = long(y0) - long(top); y < long(y0 + bottom); ++y)
+                load(y);
+            for (size_t y = y0; y < y1; ++y) {
+                load(long(y + bottom));
+                for (size_t l = 0; l < rows; ++l)
+                    ptr[l] = &ring[(y - y0 + l) % rows * pw + left];
+                func(k, y, ptr.data(), chunk);
+            }
+        }
+    }, 1);
+    return ok;
+}
+
+#endif //DIP_LINE_BUFFER_H
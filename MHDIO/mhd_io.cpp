@@ -5,16 +5,39 @@
 // Copyright (c) 2017 Lichun Zhang. All rights reserved.
 
 #include "mhd_io.h"
+#include "volume_memory.h"
 
-MHD_IO::MHD_IO(const char *name) : _fileName(name),
+MHD_IO::MHD_IO(const char *name) : _fileName(name ? name : ""),
                                    _dimX(0), _dimY(0), _dimZ(0),
                                    _spacingX(1.0), _spacingY(1.0), _spacingZ(1.0),
                                    _dataType("MET_UCHAR"),
-                                   _imData(nullptr) {
+                                   _imData(nullptr), _imBytes(0) {
 
 }
 
 
 MHD_IO::~MHD_IO() {
-    if (_imData) delete[] _imData;
+    FreeImData();
+}
+
+std::size_t MHD_IO::GetElementSize() const {
+    if (_dataType == "MET_UCHAR" || _dataType == "MET_CHAR") return 1;
+    if (_dataType == "MET_USHORT" || _dataType == "MET_SHORT") return 2;
+    return 0;
+}
+
+bool MHD_IO::AllocImData(std::size_t bytes) {
+    FreeImData();
+    _stats.Invalidate();
+    std::size_t mapped = bytes;
+    _imData = static_cast<unsigned char *>(AllocVolume(mapped, GetMemoryPolicy()));
+    if (!_imData) return false;
+    _imBytes = mapped;
+    return true;
+}
+
+void MHD_IO::FreeImData() {
+    if (_imData) FreeVolume(_imData, _imBytes);
+    _imData = nullptr;
+    _imBytes = 0;
 }
@@ -8,7 +8,9 @@
 #define DIP_MHD_IO_H
 
 
+#include <cstddef>
 #include <string>
+#include "volume_stats.h"
 
 class MHD_IO {
 public:
@@ -32,17 +34,42 @@ public:
 
     const std::string GetDataType() const { return _dataType; }
 
-    //TODO: Return various type data
+    // 每个体素的字节数 支持MET_UCHAR/MET_CHAR/MET_USHORT/MET_SHORT 其它类型返回0
+    std::size_t GetElementSize() const;
+
     unsigned char *GetImData() {
         return _dataType.empty() ? nullptr : _imData;
     }
 
+    /**
+     * @brief 缓存的统计量 (MHDReader开启SetComputeStats时在读入时计算)
+     * @note 通过GetImData修改数据后须调用Invalidate 或把它传给会自行失效的算子
+     */
+    VolumeStats *GetStats() { return &_stats; }
+
+    // 按实际类型访问图像数据 如MET_USHORT用GetImDataAs<unsigned short>()
+    template<typename T>
+    T *GetImDataAs() {
+        return reinterpret_cast<T *>(GetImData());
+    }
+
 protected:
+    /**
+     * @brief 按当前内存策略(GetMemoryPolicy)分配图像数据 释放原有数据
+     * @param bytes 图像数据字节数
+     * @return 是否分配成功
+     */
+    bool AllocImData(std::size_t bytes);
+
+    void FreeImData();
+
     std::string _fileName;
     std::size_t _dimX, _dimY, _dimZ;
     double _spacingX, _spacingY, _spacingZ;
     std::string _dataType;
     unsigned char *_imData;
+    std::size_t _imBytes;   // 实际映射的字节数
+    VolumeStats _stats;
 };
 
 
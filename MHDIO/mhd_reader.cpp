@@ -5,19 +5,32 @@
 // Copyright (c) 2017 Lichun Zhang. All rights reserved.
 
 #include "mhd_reader.h"
+#include "mhd_writer.h"
+#include "parallel.h"
 #include "utiles.h"
+#include "volume_memory.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <sstream>
 
-MHDReader::MHDReader(const char *name)
-		: MHD_IO(name),_raw_name("") {
+#ifdef __linux__
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+MHDReader::MHDReader(const char *name, bool computeStats)
+		: MHD_IO(name),_raw_name(""),_sliceFile(nullptr),_sliceNext(0),_computeStats(computeStats) {
 	if (name)
 		ReadFile(name);
 }
 
 MHDReader::~MHDReader() {
+	CloseSlices();
 }
 
 void MHDReader::ReadFile(const char *name) {
@@ -26,6 +39,11 @@ void MHDReader::ReadFile(const char *name) {
 	ReadRaw(_raw_name.c_str());
 }
 
+bool MHDReader::ReadInfo(const char *name) {
+	ReadHeader(name);
+	return !_raw_name.empty() && _dimX && _dimY && _dimZ && GetElementSize();
+}
+
 // Get the mhd DimSize, Type, DataFile(raw)
 void MHDReader::ReadHeader(const char *name) {
 	// Ordinary format (*.mhd)
@@ -89,7 +107,6 @@ void MHDReader::ReadRaw(const char *name) {
 	FILE *fp = fopen(name, "rb");
 	if (!fp) {
 		std::cout << "Error! Can't Open File " << name << std::endl;
-		fclose(fp);
 		return;
 	}
 	ConstructData(_dataType, fp);
@@ -100,16 +117,129 @@ void MHDReader::ConstructData(std::string type, FILE *fp) {
 	if (!_dimX || !_dimY || !_dimZ
 		|| type.empty() || !fp)
 		return;
-	if (type == "MET_UCHAR") {
-		if (_imData) delete[] _imData;
-		_imData = new unsigned char[_dimX * _dimY * _dimZ];
-		fread(_imData, sizeof(unsigned char), _dimX * _dimY * _dimZ, fp);
+	size_t elem = GetElementSize();
+	if (!elem) {
+		std::cout << "Unsupported ElementType " << type << std::endl;
+		return;
+	}
+	if (!AllocImData(_dimX * _dimY * _dimZ * elem)) {
+		std::cout << "Failed to alloc memory!\n";
+		return;
 	}
+	// 读入不完整时释放数据 GetImData返回空
+	if (!ReadSlices(fp, _dimX * _dimY * elem)) {
+		std::cout << "Error! Failed to read raw data\n";
+		FreeImData();
+	}
+}
+
+bool MHDReader::ReadSlices(FILE *fp, size_t sliceBytes) {
+	if (_dataType == "MET_USHORT") return ReadSlicesAs<unsigned short>(fp, sliceBytes);
+	else if (_dataType == "MET_SHORT") return ReadSlicesAs<short>(fp, sliceBytes);
+	else if (_dataType == "MET_CHAR") return ReadSlicesAs<signed char>(fp, sliceBytes);
+	else return ReadSlicesAs<unsigned char>(fp, sliceBytes);
+}
+
+// 首次访问策略下由各工作线程读入各自的切片 使页面落在工作线程所在的NUMA节点
+// 需要统计量时每读入一块立即统计 数据还在缓存中
+// 返回是否读入了全部数据
+template<typename T>
+bool MHDReader::ReadSlicesAs(FILE *fp, size_t sliceBytes) {
+	std::unique_ptr<VolumeStatsBuilder<T> > builder;
+	if (_computeStats) {
+		try {
+			builder.reset(new VolumeStatsBuilder<T>(_dimX * _dimY, _dimZ, ParallelChunkNum(0, _dimZ)));
+		}
+		catch (std::bad_alloc) {
+			std::cout << "Failed to alloc memory!\n";
+		}
+	}
+#ifdef __linux__
+	if (GetMemoryPolicy().numa == NUMA_FIRST_TOUCH) {
+		int fd = fileno(fp);
+		off_t offset = ftell(fp);
+		std::atomic<bool> ok(true);
+		ParallelFor(0, _dimZ, [&](size_t b, size_t e, size_t c) {
+			for (size_t k = b; k < e && ok; ++k) {
+				unsigned char *dst = _imData + k * sliceBytes;
+				size_t left = sliceBytes;
+				off_t pos = offset + off_t(k * sliceBytes);
+				while (left > 0) {
+					ssize_t n = pread(fd, dst, left, pos);
+					if (n < 0 && errno == EINTR) continue;
+					// 出错或文件提前结束
+					if (n <= 0) {
+						ok = false;
+						return;
+					}
+					dst += n;
+					pos += n;
+					left -= n;
+				}
+				if (builder)
+					builder->AddSlices(reinterpret_cast<const T *>(_imData + k * sliceBytes), k, k + 1, c);
+			}
+		});
+		if (!ok) return false;
+		if (builder) builder->Finish(_stats);
+		return true;
+	}
+#endif
+	if (!builder)
+		return fread(_imData, 1, sliceBytes * _dimZ, fp) == sliceBytes * _dimZ;
+	// 每次读入约1MB
+	size_t block = sliceBytes < (1 << 20) ? (1 << 20) / sliceBytes : 1;
+	for (size_t k = 0; k < _dimZ; k += block) {
+		size_t e = std::min(size_t(_dimZ), k + block);
+		if (fread(_imData + k * sliceBytes, 1, (e - k) * sliceBytes, fp) != (e - k) * sliceBytes)
+			return false;
+		builder->AddSlices(reinterpret_cast<const T *>(_imData + k * sliceBytes), k, e, 0);
+	}
+	builder->Finish(_stats);
+	return true;
+}
+
+bool MHDReader::OpenSlices(const char *name) {
+	CloseSlices();
+	if (!ReadInfo(name)) {
+		std::cout << "Read input failed: " << (name ? name : "") << std::endl;
+		return false;
+	}
+	_sliceFile = fopen(_raw_name.c_str(), "rb");
+	if (!_sliceFile) {
+		std::cout << "Error! Can't Open File " << _raw_name << std::endl;
+		return false;
+	}
+	_sliceNext = 0;
+	return true;
+}
+
+bool MHDReader::ReadSlice(void *dst) {
+	if (!_sliceFile || !dst || _sliceNext >= _dimZ) return false;
+	size_t bytes = _dimX * _dimY * GetElementSize();
+	if (fread(dst, 1, bytes, _sliceFile) != bytes) return false;
+	++_sliceNext;
+	return true;
+}
+
+void MHDReader::CloseSlices() {
+	if (_sliceFile) fclose(_sliceFile);
+	_sliceFile = nullptr;
 }
 
 // name without suffix
 void MHDReader::SaveAs(const char *name) {
 	size_t dims[] = {_dimX,_dimY,_dimZ};
 	double spacing[] = {_spacingX,_spacingY,_spacingZ};
-	WriteMHD(name, _imData, dims, spacing);
+	if (GetElementSize() == 1) {
+		WriteMHD(name, _imData, dims, spacing);
+		return;
+	}
+	// 16位数据
+	MHDWriter writer;
+	if (_dataType == "MET_SHORT")
+		writer.SetImgData(GetImDataAs<short>(), dims, spacing);
+	else
+		writer.SetImgData(GetImDataAs<unsigned short>(), dims, spacing);
+	writer.WriteFile((std::string(name) + ".mhd").c_str());
 }
@@ -8,23 +8,48 @@
 #define DIP_MHD_READER_H
 
 
+#include <cstdio>
 #include <string>
 #include "mhd_io.h"
 
 class MHDReader :public MHD_IO{
 public:
-    MHDReader(const char *name = nullptr);
+    /**
+     * @param name mhd文件名 非空时立即读入
+     * @param computeStats 读入时是否同时计算统计量(GetStats)
+     */
+    MHDReader(const char *name = nullptr, bool computeStats = false);
 
     virtual ~MHDReader();
 
     void ReadFile(const char* name);
+    // 只读取头文件信息(尺寸 间距 类型) 不读入数据
+    bool ReadInfo(const char *name);
     void SaveAs(const char *name);
+    // 之后的ReadFile在读入数据的同一遍中计算统计量 数据还在缓存中时统计
+    void SetComputeStats(bool compute) { _computeStats = compute; }
+
+    /**
+     * @brief 打开文件逐切片读取 只读头文件 不分配整个体数据
+     * @param name mhd文件名
+     * @return 是否打开成功
+     */
+    bool OpenSlices(const char *name);
+    // 按顺序读入下一张切片 dst至少能容纳宽*高*GetElementSize()字节
+    bool ReadSlice(void *dst);
+    void CloseSlices();
 
 private:
     std::string _raw_name;
+    FILE *_sliceFile;
+    size_t _sliceNext;  // 下一张要读的切片
+    bool _computeStats;
     void ReadHeader(const char *name);
     void ReadRaw(const char* name);
     void ConstructData(std::string type, FILE *fp);
+    bool ReadSlices(FILE *fp, size_t sliceBytes);
+    template<typename T>
+    bool ReadSlicesAs(FILE *fp, size_t sliceBytes);
 };
 
 
@@ -11,7 +11,21 @@
 
 MHDWriter::MHDWriter(const char *name/* = nullptr*/) : MHD_IO(name) {}
 
-MHDWriter::~MHDWriter() {}
+// 未CloseSlices的逐切片写出不完整 不写头文件
+MHDWriter::~MHDWriter() {
+    if (_sliceFile) std::fclose(_sliceFile);
+}
+
+namespace {
+// 把文件名后缀换成ext(不含点) 没有后缀则添加 目录名中的点不算后缀
+std::string ReplaceSuffix(const std::string &name, const char *ext) {
+    auto index = name.find_last_of(".");
+    auto slash = name.find_last_of("/\\");
+    if (index == std::string::npos || (slash != std::string::npos && index < slash))
+        return name + "." + ext;
+    return name.substr(0, index + 1) + ext;
+}
+}
 
 
 /**
@@ -34,19 +48,51 @@ void MHDWriter::WriteFile(const char *name) {
 //    ElementType = MET_UCHAR
 //    ElementDataFile = abell5mm_reorder.raw
     if (!name) return;
-    std::string name_str = name;
-    auto index = name_str.find_last_of(".");
-    if(index == std::string::npos)
-        name_str += ".mhd";
-    else
-        name_str = name_str.substr(0,index+1)+"mhd";
-    _fileName = name_str;
+    _fileName = ReplaceSuffix(name, "mhd");
     if (!_imData || _dataType.empty() || !_dimY || !_dimY || !_dimZ)
         return;
     WriteHeader(_fileName.c_str());
-    std::string str_raw_name = _fileName.substr(0, _fileName.find_last_of(".") + 1);
-    str_raw_name += "raw";
-    WriteRaw(str_raw_name.c_str());
+    WriteRaw(ReplaceSuffix(_fileName, "raw").c_str());
+}
+
+bool MHDWriter::OpenSlices(const char *name, const double *spacing /* = nullptr*/) {
+    if (!name) return false;
+    CloseSlices();
+    _fileName = ReplaceSuffix(name, "mhd");
+    std::string raw_name = ReplaceSuffix(_fileName, "raw");
+    _sliceFile = std::fopen(raw_name.c_str(), "wb");
+    if (!_sliceFile) {
+        std::cout << "Error! Can't Save File " << raw_name << std::endl;
+        return false;
+    }
+    SetImgSpacing(spacing);
+    _dataType = "MET_UCHAR";
+    _dimX = _dimY = _dimZ = 0;
+    return true;
+}
+
+bool MHDWriter::WriteSlice(const unsigned char *data, size_t width, size_t height) {
+    if (!_sliceFile || !data) return false;
+    if (!_dimZ) {
+        _dimX = width;
+        _dimY = height;
+    } else if (width != _dimX || height != _dimY) {
+        std::cout << "Slice size mismatch in " << _fileName << std::endl;
+        return false;
+    }
+    if (fwrite(data, sizeof(unsigned char), width * height, _sliceFile) != width * height)
+        return false;
+    ++_dimZ;
+    return true;
+}
+
+bool MHDWriter::CloseSlices() {
+    if (!_sliceFile) return false;
+    std::fclose(_sliceFile);
+    _sliceFile = nullptr;
+    if (!_dimZ) return false;
+    WriteHeader(_fileName.c_str());
+    return true;
 }
 
 void MHDWriter::WriteHeader(const char *headerName, const char *rawName /* = nullptr*/) {
@@ -75,6 +121,9 @@ void MHDWriter::WriteHeader(const char *headerName, const char *rawName /* = nul
         str_raw_name = _fileName.substr(0, _fileName.find_last_of(".") + 1);
         str_raw_name += "raw";
     }
+    // 只写文件名 读取时相对mhd所在目录
+    size_t pos = str_raw_name.find_last_of("/\\");
+    if (pos != std::string::npos) str_raw_name.erase(0, pos + 1);
     out << str_raw_name << "\n";
     out.close();
 }
@@ -82,8 +131,11 @@ void MHDWriter::WriteHeader(const char *headerName, const char *rawName /* = nul
 void MHDWriter::WriteRaw(const char *name) {
     if (!name || !_imData) return;
     std::FILE *fn = std::fopen(name, "wb");
-    fwrite(_imData, sizeof(unsigned char), _dimX * _dimY * _dimZ, fn);
-    fclose(fn);
+    if (!fn) {
+        std::cout << "Error! Can't Save File " << name << std::endl;
+        return;
+    }
+    fwrite(_imData, GetElementSize(), _dimX * _dimY * _dimZ, fn);
     std::fclose(fn);
 }
 
@@ -8,8 +8,11 @@
 #define DIP_MHD_WRITER_H
 
 
+#include <cstdio>
 #include <string>
+#include <type_traits>
 #include "mhd_io.h"
+#include "volume_memory.h"
 
 class MHDWriter : public MHD_IO {
 public:
@@ -19,6 +22,20 @@ public:
 
     void WriteFile(const char *name);
 
+    /**
+     * @brief 开始逐切片写出 先写raw文件 尺寸在CloseSlices时写入头文件
+     * @param name 输出文件名 后缀同WriteFile
+     * @param spacing 体素间距
+     * @return 是否打开成功
+     */
+    bool OpenSlices(const char *name, const double *spacing = nullptr);
+
+    // 写出下一张切片(MET_UCHAR) 各切片尺寸须相同
+    bool WriteSlice(const unsigned char *data, size_t width, size_t height);
+
+    // 结束写出 写头文件 切片数为已写出的切片数
+    bool CloseSlices();
+
     template<typename T>
     void SetImgData(const T *data, const size_t *dims, const double *spacing = nullptr,
                     const std::string type = "") {
@@ -26,16 +43,17 @@ public:
 
         //Set image info
         SetImgDims(dims);
-        if (!spacing) SetImgSpacing(spacing);
+        if (spacing) SetImgSpacing(spacing);
         if (!type.empty()) SetImgType(type);
         if (std::is_same<T, unsigned char>::value)
             _dataType = "MET_UCHAR";
-//    else if(std::is_same<T,unsigned short>::value)
-//        _dataType="MET_USHORT";
+        else if (std::is_same<T, unsigned short>::value)
+            _dataType = "MET_USHORT";
+        else if (std::is_same<T, short>::value)
+            _dataType = "MET_SHORT";
         //Set image data
-        if (_imData) delete[] _imData;
-        _imData = new T[_dimX * _dimY * _dimZ];
-        memcpy(_imData, data, sizeof(T) * _dimX * _dimY * _dimZ);
+        if (!AllocImData(sizeof(T) * _dimX * _dimY * _dimZ)) return;
+        CopyVolume(_imData, data, sizeof(T) * _dimX * _dimY, _dimZ);
     }
 
 private:
@@ -62,6 +80,8 @@ private:
     void WriteHeader(const char *headerName, const char *rawName = nullptr);
 
     void WriteRaw(const char *name);
+
+    FILE *_sliceFile = nullptr;
 };
 
 
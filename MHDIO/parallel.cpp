@@ -0,0 +1,227 @@
+// Program: DIP
+// FileName:parallel.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 上午10:12
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include "parallel.h"
+#include "volume_memory.h"
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+size_t g_threadNum = 0;
+// -1表示未设置 跟随内存策略(首次访问策略时绑定)
+int g_threadAffinity = -1;
+// 当前线程是否已处于并行区域内 嵌套调用时串行执行
+thread_local bool t_inParallel = false;
+// 当前工作线程所属的线程池及其序号
+thread_local WorkStealingPool *t_pool = nullptr;
+thread_local size_t t_poolIndex = 0;
+
+void PinCurrentThread(size_t chunk, size_t chunks) {
+#ifdef __linux__
+    size_t cpus = std::thread::hardware_concurrency();
+    if (!cpus || !chunks) return;
+    // 分块按顺序铺满所有CPU 相邻分块落在相邻CPU(同一NUMA节点)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(chunk * cpus / chunks, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+}
+
+void SetThreadNum(size_t num) {
+    g_threadNum = num;
+}
+
+size_t GetThreadNum() {
+    if (g_threadNum) return g_threadNum;
+    const char *env = std::getenv("DIP_THREADS");
+    if (env && std::atoi(env) > 0) return std::atoi(env);
+    size_t hw = std::thread::hardware_concurrency();
+    return hw ? hw : 1;
+}
+
+void SetThreadAffinity(bool pin) {
+    g_threadAffinity = pin ? 1 : 0;
+}
+
+bool GetThreadAffinity() {
+    if (g_threadAffinity < 0)
+        return GetMemoryPolicy().numa == NUMA_FIRST_TOUCH;
+    return g_threadAffinity != 0;
+}
+
+size_t ParallelChunkNum(size_t begin, size_t end, size_t grain) {
+    if (end <= begin || t_inParallel) return 1;
+    if (!grain) grain = 1;
+    size_t chunks = (end - begin + grain - 1) / grain;
+    // 线程池中多划分几块 便于空闲线程窃取
+    size_t threads = t_pool ? t_pool->Size() * 4 : GetThreadNum();
+    return chunks < threads ? chunks : threads;
+}
+
+void ParallelRun(size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t, size_t)> &func) {
+    if (end <= begin) return;
+    size_t chunks = ParallelChunkNum(begin, end, grain);
+    if (chunks <= 1) {
+        func(begin, end, 0);
+        return;
+    }
+    size_t count = end - begin;
+    if (t_pool) {
+        t_pool->RunChunks(chunks, [&](size_t c) {
+            func(begin + count * c / chunks, begin + count * (c + 1) / chunks, c);
+        });
+        return;
+    }
+    bool pin = GetThreadAffinity();
+    auto run = [&](size_t c) {
+        t_inParallel = true;
+        if (pin) PinCurrentThread(c, chunks);
+        func(begin + count * c / chunks, begin + count * (c + 1) / chunks, c);
+        t_inParallel = false;
+    };
+    // 绑定CPU时所有分块都交给工作线程 避免改变调用线程的亲和性
+    size_t first = pin ? 0 : 1;
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - first);
+    for (size_t c = first; c < chunks; ++c)
+        workers.push_back(std::thread(run, c));
+    if (first) run(0);
+    for (auto &w : workers)
+        w.join();
+}
+
+SerialScope::SerialScope() : _nested(t_inParallel) {
+    t_inParallel = true;
+}
+
+SerialScope::~SerialScope() {
+    t_inParallel = _nested;
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+        : _chunkCount(0), _pending(0), _stop(false) {
+    if (!threads) threads = GetThreadNum();
+    for (size_t i = 0; i < threads; ++i)
+        _queues.push_back(std::unique_ptr<ChunkQueue>(new ChunkQueue));
+    for (size_t i = 0; i < threads; ++i)
+        _workers.push_back(std::thread(&WorkStealingPool::WorkerLoop, this, i));
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cond.notify_all();
+    for (auto &w : _workers)
+        w.join();
+}
+
+void WorkStealingPool::Submit(const std::function<void()> &task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(task);
+        ++_pending;
+    }
+    _cond.notify_one();
+}
+
+void WorkStealingPool::Wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCond.wait(lock, [this] { return _pending == 0; });
+}
+
+WorkStealingPool *WorkStealingPool::Current() {
+    return t_pool;
+}
+
+void WorkStealingPool::RunChunks(size_t chunks, const std::function<void(size_t)> &func) {
+    std::atomic<size_t> left(chunks);
+    auto run = [&func, &left](size_t c) {
+        bool nested = t_inParallel;
+        t_inParallel = true;
+        func(c);
+        t_inParallel = nested;
+        --left;
+    };
+    ChunkQueue &own = *_queues[t_poolIndex];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        for (size_t c = chunks - 1; c > 0; --c)
+            own.tasks.push_back(std::bind(run, c));
+    }
+    {
+        // 在_mutex下修改计数 避免工作线程错过唤醒
+        std::lock_guard<std::mutex> lock(_mutex);
+        _chunkCount += chunks - 1;
+    }
+    _cond.notify_all();
+    run(0);
+    // 等待其它分块完成 期间协助执行
+    while (left > 0) {
+        if (!RunOneChunk(t_poolIndex))
+            std::this_thread::yield();
+    }
+}
+
+bool WorkStealingPool::RunOneChunk(size_t self) {
+    std::function<void()> task;
+    {
+        ChunkQueue &own = *_queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t i = 1; !task && i < _queues.size(); ++i) {
+        ChunkQueue &other = *_queues[(self + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = other.tasks.front();
+            other.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+    --_chunkCount;
+    task();
+    return true;
+}
+
+void WorkStealingPool::WorkerLoop(size_t index) {
+    t_pool = this;
+    t_poolIndex = index;
+    while (true) {
+        // 优先完成进行中体数据的分块 减少驻留内存
+        if (RunOneChunk(index)) continue;
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this] { return _stop || !_tasks.empty() || _chunkCount > 0; });
+            if (!_tasks.empty() && _chunkCount == 0) {
+                task = _tasks.front();
+                _tasks.pop_front();
+            } else if (_stop && _tasks.empty() && _chunkCount == 0) {
+                return;
+            }
+        }
+        if (!task) continue;
+        task();
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_pending == 0) _doneCond.notify_all();
+    }
+}
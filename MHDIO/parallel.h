@@ -0,0 +1,132 @@
+// Program: DIP
+// FileName:parallel.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 上午10:12
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_PARALLEL_H
+#define DIP_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 设置并行线程数
+ * @param num 线程数 0表示使用环境变量DIP_THREADS或硬件线程数
+ */
+void SetThreadNum(size_t num);
+
+/**
+ * @brief 获取当前并行线程数
+ */
+size_t GetThreadNum();
+
+/**
+ * @brief 设置是否将第c个分块的线程绑定到固定CPU
+ * @note 与首次访问(first-touch)内存策略配合 保证同一分块总落在同一NUMA节点
+ * 未设置时 内存策略为NUMA_FIRST_TOUCH则默认绑定
+ */
+void SetThreadAffinity(bool pin);
+
+bool GetThreadAffinity();
+
+/**
+ * @brief [begin, end)区间将被划分的分块数 可用于预先分配每个分块私有的缓冲区
+ * @note 在并行区域内部调用(嵌套)时返回1
+ */
+size_t ParallelChunkNum(size_t begin, size_t end, size_t grain = 1);
+
+void ParallelRun(size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t, size_t)> &func);
+
+/**
+ * @brief 静态分块并行循环 [begin, end)均分为ParallelChunkNum块连续区间
+ * @tparam F 可调用对象 形式为 func(chunkBegin, chunkEnd, chunkIndex)
+ * @param begin 起始下标
+ * @param end 结束下标(不含)
+ * @param func 每个分块执行的函数
+ * @param grain 每个分块最少的元素个数
+ */
+template<typename F>
+void ParallelFor(size_t begin, size_t end, F func, size_t grain = 1) {
+    ParallelRun(begin, end, grain, std::function<void(size_t, size_t, size_t)>(func));
+}
+
+/**
+ * @brief 作用域内把当前线程标记为已在并行区域中 其中调用的ParallelFor串行执行
+ * @note 供自行创建线程的调用者使用(如流式处理的计算线程各处理一张切片): 线程数已占满时
+ * 算子内部不再另起GetThreadNum()个线程. 可嵌套 析构时恢复原状态.
+ */
+class SerialScope {
+public:
+    SerialScope();
+
+    ~SerialScope();
+
+private:
+    SerialScope(const SerialScope &);
+
+    SerialScope &operator=(const SerialScope &);
+
+    bool _nested;
+};
+
+/**
+ * @brief 工作窃取线程池 用于多体数据批处理
+ * @note 顶层任务(如一个体数据)先进先出; 工作线程中调用ParallelFor时 分块压入本线程的双端队列,
+ * 空闲线程从其它队列头部窃取分块 从而在体数据之间和体数据内部之间自动平衡
+ */
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threads);
+
+    ~WorkStealingPool();
+
+    // 提交顶层任务
+    void Submit(const std::function<void()> &task);
+
+    // 等待所有已提交的顶层任务完成
+    void Wait();
+
+    size_t Size() const { return _workers.size(); }
+
+    // 调用线程所属的线程池 非工作线程返回nullptr
+    static WorkStealingPool *Current();
+
+    // 执行chunks个分块 调用线程在等待期间协助执行其它分块(由ParallelRun调用)
+    void RunChunks(size_t chunks, const std::function<void(size_t)> &func);
+
+private:
+    WorkStealingPool(const WorkStealingPool &);
+
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    struct ChunkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    void WorkerLoop(size_t index);
+
+    // 先取本线程队列尾部 再窃取其它队列头部
+    bool RunOneChunk(size_t self);
+
+    std::vector<std::thread> _workers;
+    std::vector<std::unique_ptr<ChunkQueue> > _queues;
+    std::deque<std::function<void()> > _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cond;      // 有新任务或分块
+    std::condition_variable _doneCond;  // 顶层任务全部完成
+    std::atomic<size_t> _chunkCount;    // 排队中的分块数
+    size_t _pending;                    // 未完成的顶层任务数
+    bool _stop;
+};
+
+#endif //DIP_PARALLEL_H
@@ -0,0 +1,81 @@
+// Program: DIP
+// FileName:spsc_queue.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午4:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_SPSC_QUEUE_H
+#define DIP_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 有界无锁队列 单生产者单消费者
+ * @note 生产者只写_tail 消费者只写_head 两者分处不同缓存行;
+ * 容量取不小于capacity的2的幂 下标用位与取模
+ * @tparam T 元素类型 (通常为指针)
+ */
+template<typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity) : _head(0), _tail(0) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        _buffer.resize(n);
+        _mask = n - 1;
+    }
+
+    /**
+     * @brief 入队 只能由生产者线程调用
+     * @return 队列满时返回false
+     */
+    bool TryPush(const T &value) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) > _mask) return false;
+        _buffer[tail & _mask] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 出队 只能由消费者线程调用
+     * @return 队列空时返回false
+     */
+    bool TryPop(T &value) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) return false;
+        value = _buffer[head & _mask];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 阻塞版本 队列满/空时让出CPU后重试
+    void Push(const T &value) {
+        while (!TryPush(value))
+            std::this_thread::yield();
+    }
+
+    T Pop() {
+        T value;
+        while (!TryPop(value))
+            std::this_thread::yield();
+        return value;
+    }
+
+    size_t Capacity() const { return _mask + 1; }
+
+private:
+    SPSCQueue(const SPSCQueue &);
+
+    SPSCQueue &operator=(const SPSCQueue &);
+
+    std::vector<T> _buffer;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _head;  // 消费者读位置
+    alignas(64) std::atomic<size_t> _tail;  // 生产者写位置
+};
+
+#endif //DIP_SPSC_QUEUE_H
@@ -15,6 +15,9 @@ void WriteMHDHeader(const std::string &name,
     std::ofstream out(name);
     std::string raw_name = name.substr(0, name.find_last_of(".") + 1);
     raw_name += "raw";
+    // 只写文件名 读取时相对mhd所在目录
+    size_t pos = raw_name.find_last_of("/\\");
+    if (pos != std::string::npos) raw_name.erase(0, pos + 1);
     out << "ObjectType = Image\n" << "NDims = 3\n"
         << "BinaryData = True\n" << "BinaryDataByteOrderMSB = False\n"
         << "TransformMatrix = 1 0 0 0 1 0 0 0 1\n"
@@ -35,8 +38,11 @@ void WriteMHDRaw(const std::string &name, const unsigned char *data,
         return;
     }
     std::FILE *fn = std::fopen(name.c_str(), "wb");
+    if (!fn) {
+        std::cout << "Error! Can't Save File " << name << std::endl;
+        return;
+    }
     fwrite(data, sizeof(unsigned char), x * y * z, fn);
-    fclose(fn);
     std::fclose(fn);
 }
 
@@ -0,0 +1,175 @@
+// Program: DIP
+// FileName:volume_memory.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 上午10:40
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include "volume_memory.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+bool g_policySet = false;
+MemoryPolicy g_policy;
+
+MemoryPolicy PolicyFromEnv() {
+    MemoryPolicy policy;
+    const char *numa = std::getenv("DIP_NUMA");
+    if (numa) {
+        std::string s = numa;
+        if (s == "interleave") policy.numa = NUMA_INTERLEAVE;
+        else if (s == "firsttouch") policy.numa = NUMA_FIRST_TOUCH;
+    }
+    const char *huge = std::getenv("DIP_HUGEPAGE");
+    if (huge) {
+        std::string s = huge;
+        if (s == "thp") policy.hugePage = HUGEPAGE_TRANSPARENT;
+        else if (s == "explicit") policy.hugePage = HUGEPAGE_EXPLICIT;
+    }
+    return policy;
+}
+
+size_t RoundUp(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+#ifdef __linux__
+const int kMpolInterleave = 3;  // linux/mempolicy.h MPOL_INTERLEAVE
+
+// 读取在线节点掩码 如"0-1"或"0,2-3"
+unsigned long OnlineNodeMask() {
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string line;
+    if (!in || !std::getline(in, line)) return 1;
+    unsigned long mask = 0;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t next = line.find(',', pos);
+        if (next == std::string::npos) next = line.size();
+        std::string range = line.substr(pos, next - pos);
+        size_t dash = range.find('-');
+        int lo = std::atoi(range.c_str());
+        int hi = dash == std::string::npos ? lo : std::atoi(range.c_str() + dash + 1);
+        for (int n = lo; n <= hi && n < 64; ++n)
+            mask |= 1UL << n;
+        pos = next + 1;
+    }
+    return mask ? mask : 1;
+}
+
+void BindInterleave(void *p, size_t len) {
+    unsigned long mask = OnlineNodeMask();
+    // 单节点机器无需交错
+    if (!(mask & (mask - 1))) return;
+    if (syscall(SYS_mbind, p, len, kMpolInterleave, &mask, sizeof(mask) * 8, 0) != 0)
+        std::cout << "Warning: mbind(MPOL_INTERLEAVE) failed, use default placement\n";
+}
+
+// 映射len字节并按2MB对齐 以便透明大页生效
+void *MapAligned(size_t len) {
+    size_t mapped = len + kHugePageSize;
+    void *raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = RoundUp(start, kHugePageSize);
+    // 去掉头尾多余部分
+    if (aligned > start)
+        munmap(raw, aligned - start);
+    size_t tail = start + mapped - (aligned + len);
+    if (tail)
+        munmap(reinterpret_cast<void *>(aligned + len), tail);
+    return reinterpret_cast<void *>(aligned);
+}
+#endif
+}
+
+void SetMemoryPolicy(const MemoryPolicy &policy) {
+    g_policy = policy;
+    g_policySet = true;
+}
+
+MemoryPolicy GetMemoryPolicy() {
+    if (g_policySet) return g_policy;
+    static const MemoryPolicy env_policy = PolicyFromEnv();
+    return env_policy;
+}
+
+void *AllocVolume(size_t &bytes, const MemoryPolicy &policy) {
+    if (!bytes) return nullptr;
+#ifdef __linux__
+    void *p = nullptr;
+    size_t len = RoundUp(bytes, policy.hugePage == HUGEPAGE_NONE
+                                ? size_t(sysconf(_SC_PAGESIZE)) : kHugePageSize);
+    if (policy.hugePage == HUGEPAGE_EXPLICIT) {
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            p = nullptr;
+            // 可能由多个工作线程同时分配 只提示一次
+            static std::atomic<bool> warned(false);
+            if (!warned.exchange(true))
+                std::cout << "Warning: explicit huge pages unavailable, use transparent huge pages\n";
+        }
+    }
+    if (!p) {
+        if (policy.hugePage == HUGEPAGE_NONE) {
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) p = nullptr;
+        } else {
+            p = MapAligned(len);
+#ifdef MADV_HUGEPAGE
+            if (p) madvise(p, len, MADV_HUGEPAGE);
+#endif
+        }
+    }
+    if (!p) return nullptr;
+    if (policy.numa == NUMA_INTERLEAVE)
+        BindInterleave(p, len);
+    bytes = len;
+    return p;
+#else
+    (void) policy;
+    return new(std::nothrow) unsigned char[bytes];
+#endif
+}
+
+void FreeVolume(void *p, size_t bytes) {
+    if (!p) return;
+#ifdef __linux__
+    munmap(p, bytes);
+#else
+    (void) bytes;
+    delete[] static_cast<unsigned char *>(p);
+#endif
+}
+
+void CopyVolume(void *dst, const void *src, size_t sliceBytes, size_t slice) {
+    if (!dst || !src) return;
+    if (GetMemoryPolicy().numa != NUMA_FIRST_TOUCH) {
+        memcpy(dst, src, sliceBytes * slice);
+        return;
+    }
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        memcpy(static_cast<unsigned char *>(dst) + b * sliceBytes,
+               static_cast<const unsigned char *>(src) + b * sliceBytes,
+               (e - b) * sliceBytes);
+    });
+}
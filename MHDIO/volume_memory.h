@@ -0,0 +1,64 @@
+// Program: DIP
+// FileName:volume_memory.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 上午10:40
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_VOLUME_MEMORY_H
+#define DIP_VOLUME_MEMORY_H
+
+#include <cstddef>
+
+// NUMA内存放置策略
+enum NumaPolicy {
+    NUMA_DEFAULT = 0,       // 系统默认(由首次访问的线程决定 通常为主线程所在节点)
+    NUMA_INTERLEAVE = 1,    // 页面在所有节点间轮流分配
+    NUMA_FIRST_TOUCH = 2    // 由按切片划分的工作线程首次写入 页面落在工作线程所在节点
+};
+
+// 大页策略
+enum HugePagePolicy {
+    HUGEPAGE_NONE = 0,
+    HUGEPAGE_TRANSPARENT = 1,   // madvise(MADV_HUGEPAGE) 透明大页
+    HUGEPAGE_EXPLICIT = 2       // MAP_HUGETLB 2MB大页 失败时退回透明大页
+};
+
+struct MemoryPolicy {
+    NumaPolicy numa = NUMA_DEFAULT;
+    HugePagePolicy hugePage = HUGEPAGE_NONE;
+};
+
+/**
+ * @brief 设置本次运行的体数据内存策略
+ * @note 未设置时从环境变量读取 DIP_NUMA=default|interleave|firsttouch
+ * DIP_HUGEPAGE=none|thp|explicit
+ */
+void SetMemoryPolicy(const MemoryPolicy &policy);
+
+MemoryPolicy GetMemoryPolicy();
+
+/**
+ * @brief 按策略分配体数据内存 不做初始化(不触碰页面)
+ * @param bytes 输入需要的字节数 输出实际映射的字节数(释放时使用)
+ * @param policy 内存策略
+ * @return 内存指针 失败为nullptr
+ */
+void *AllocVolume(size_t &bytes, const MemoryPolicy &policy);
+
+/**
+ * @brief 释放AllocVolume分配的内存
+ * @param p 内存指针
+ * @param bytes AllocVolume返回的实际字节数
+ */
+void FreeVolume(void *p, size_t bytes);
+
+/**
+ * @brief 按切片并行拷贝体数据 使目标页面由对应工作线程首次写入
+ * @param dst 目标指针
+ * @param src 源指针
+ * @param sliceBytes 每个切片的字节数
+ * @param slice 切片数
+ */
+void CopyVolume(void *dst, const void *src, size_t sliceBytes, size_t slice);
+
+#endif //DIP_VOLUME_MEMORY_H
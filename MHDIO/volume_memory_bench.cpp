@@ -0,0 +1,81 @@
+// Program: DIP
+// FileName:volume_memory_bench.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/18 上午11:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+// 比较不同NUMA/大页策略下 按切片并行处理体数据的带宽
+// 默认策略模拟主线程fread(页面全落在主线程节点) 首次访问策略由工作线程写入
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "parallel.h"
+#include "volume_memory.h"
+
+namespace {
+const char *kNumaNames[] = {"default", "interleave", "firsttouch"};
+const char *kHugeNames[] = {"none", "thp", "explicit"};
+
+double BenchPolicy(const MemoryPolicy &policy, size_t width, size_t height,
+                   size_t slice, int repeat) {
+    SetMemoryPolicy(policy);
+    size_t sliceBytes = width * height;
+    size_t bytes = sliceBytes * slice;
+    unsigned char *im = static_cast<unsigned char *>(AllocVolume(bytes, policy));
+    if (!im) {
+        std::cout << "Failed to alloc memory!\n";
+        return 0.0;
+    }
+    // 载入: 默认和交错策略由主线程写入 首次访问策略由工作线程按切片写入
+    if (policy.numa == NUMA_FIRST_TOUCH) {
+        ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+            memset(im + b * sliceBytes, 1, (e - b) * sliceBytes);
+        });
+    } else {
+        memset(im, 1, sliceBytes * slice);
+    }
+
+    // 按切片并行的读-改-写处理
+    auto t_bg = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) {
+        ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+            for (size_t k = b; k < e; ++k) {
+                unsigned char *p = im + k * sliceBytes;
+                for (size_t i = 0; i < sliceBytes; ++i)
+                    p[i] = (unsigned char) (p[i] * 3 + 1);
+            }
+        });
+    }
+    auto t_ed = std::chrono::steady_clock::now();
+    FreeVolume(im, bytes);
+    double seconds = std::chrono::duration<double>(t_ed - t_bg).count();
+    return seconds > 0 ? 2.0 * sliceBytes * slice * repeat / seconds / 1e9 : 0.0;
+}
+}
+
+int main(int argc, char *argv[]) {
+    size_t sizeMB = argc > 1 ? std::atoi(argv[1]) : 1024;
+    if (argc > 2) SetThreadNum(std::atoi(argv[2]));
+    int repeat = argc > 3 ? std::atoi(argv[3]) : 5;
+    if (!sizeMB || repeat <= 0) {
+        std::cout << "Usage: VolumeMemoryBench [sizeMB] [threads] [repeat]\n";
+        return 1;
+    }
+    size_t width = 512, height = 512;
+    size_t slice = sizeMB * 1024 * 1024 / (width * height);
+    std::cout << "Volume: " << width << "x" << height << "x" << slice
+              << ", threads: " << GetThreadNum() << "\n";
+    for (int n = 0; n < 3; ++n) {
+        for (int h = 0; h < 3; ++h) {
+            MemoryPolicy policy;
+            policy.numa = NumaPolicy(n);
+            policy.hugePage = HugePagePolicy(h);
+            double gbs = BenchPolicy(policy, width, height, slice, repeat);
+            std::cout << kNumaNames[n] << "\t" << kHugeNames[h] << "\t"
+                      << gbs << " GB/s\n";
+        }
+    }
+    return 0;
+}
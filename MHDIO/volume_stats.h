@@ -0,0 +1,197 @@
+// Program: DIP
+// FileName:volume_stats.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午7:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_VOLUME_STATS_H
+#define DIP_VOLUME_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.h"
+
+/**
+ * @brief 可合并的均值/方差累加器 (Welford, 两组合并用Chan公式)
+ */
+struct RunningStats {
+    uint64_t n = 0;
+    double mean = 0.0, m2 = 0.0;    // m2为离均差平方和
+
+    void Add(double x) {
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    void Merge(const RunningStats &o) {
+        if (!o.n) return;
+        if (!n) {
+            *this = o;
+            return;
+        }
+        uint64_t total = n + o.n;
+        double delta = o.mean - mean;
+        mean += delta * o.n / total;
+        m2 += o.m2 + delta * delta * double(n) * o.n / total;
+        n = total;
+    }
+
+    double Variance() const { return n ? m2 / n : 0.0; }
+};
+
+/**
+ * @brief 体数据的统计量缓存 由MHDReader在读入时或算子在输出时顺便计算
+ * @note 数据被修改后必须Invalidate; 接受VolumeStats*的算子会在修改数据后自行失效
+ */
+struct VolumeStats {
+    bool valid = false;
+    double min = 0.0, max = 0.0;
+    double mean = 0.0, variance = 0.0;  // 总体方差
+    uint64_t count = 0;
+    std::vector<double> sliceMin, sliceMax;
+    std::vector<double> sliceMean, sliceVariance;
+    std::vector<double> sliceSum;       // 每张切片的灰度和 整数数据时为精确值
+    std::vector<size_t> sliceMaxIndex;  // 每张切片最大值第一次出现的位置(切片内下标)
+    // 8/16位整数数据的直方图 第i个bin为灰度值 numeric_limits<T>::min()+i; 其它类型为空
+    std::vector<uint64_t> histogram;
+
+    void Invalidate() { valid = false; }
+
+    bool HasSlices(size_t slice) const { return valid && sliceMin.size() == slice; }
+};
+
+/**
+ * @brief 分块累计体数据统计量 各分块可并行调用AddSlices 最后Finish合并
+ * @tparam T 图像数据类型
+ */
+template<typename T>
+class VolumeStatsBuilder {
+public:
+    // 8/16位整数数据统计直方图
+    static const bool kHistogram = std::is_integral<T>::value && sizeof(T) <= 2;
+    static const size_t kBins = kHistogram ? size_t(1) << (8 * sizeof(T)) : 0;
+    // 方差按组累计的组大小
+    static const size_t kBlock = 256;
+
+    /**
+     * @param pixels 每张切片的像素数
+     * @param slice 切片数
+     * @param chunks 并行分块数 (ParallelChunkNum) 每个分块一个私有直方图
+     */
+    VolumeStatsBuilder(size_t pixels, size_t slice, size_t chunks)
+            : _pixels(pixels), _slices(slice), _min(slice), _max(slice), _sum(slice), _maxIndex(slice),
+              _hist(kBins * chunks) {}
+
+    // 累计切片[b, e) im指向第b张切片 由第chunk个分块调用
+    void AddSlices(const T *im, size_t b, size_t e, size_t chunk) {
+        uint64_t *his = kHistogram ? &_hist[chunk * kBins] : nullptr;
+        for (size_t k = b; k < e; ++k, im += _pixels)
+            AddSlice(im, k, his);
+    }
+
+    void Finish(VolumeStats &stats) {
+        RunningStats all;
+        for (size_t k = 0; k < _slices.size(); ++k)
+            all.Merge(_slices[k]);
+        stats.count = all.n;
+        stats.mean = all.mean;
+        stats.variance = all.Variance();
+        stats.sliceMean.resize(_slices.size());
+        stats.sliceVariance.resize(_slices.size());
+        for (size_t k = 0; k < _slices.size(); ++k) {
+            stats.sliceMean[k] = _slices[k].mean;
+            stats.sliceVariance[k] = _slices[k].Variance();
+        }
+        stats.sliceSum.swap(_sum);
+        stats.sliceMin.swap(_min);
+        stats.sliceMax.swap(_max);
+        stats.sliceMaxIndex.swap(_maxIndex);
+        stats.min = stats.max = stats.sliceMin.empty() ? 0.0 : stats.sliceMin[0];
+        for (size_t k = 0; k < stats.sliceMin.size(); ++k) {
+            if (stats.sliceMin[k] < stats.min) stats.min = stats.sliceMin[k];
+            if (stats.sliceMax[k] > stats.max) stats.max = stats.sliceMax[k];
+        }
+        stats.histogram.assign(kBins, 0);
+        for (size_t c = 0; kBins && c < _hist.size() / kBins; ++c)
+            for (size_t i = 0; i < kBins; ++i)
+                stats.histogram[i] += _hist[c * kBins + i];
+        stats.valid = true;
+    }
+
+private:
+    void AddSlice(const T *im, size_t k, uint64_t *his) {
+        if (!_pixels) return;
+        T mn = im[0], mx = im[0];
+        size_t mx_index = 0;
+        // 每kBlock个像素为一组: 组内两遍求均值与离均差平方和(数据在L1缓存中), 各组按Chan公式合并到
+        // Welford累加器. 不会像平方和相减那样在均值大、方差小时损失精度, 也不需要逐像素做除法
+        RunningStats acc;
+        // 整数数据的和是精确的
+        double sum = 0.0;
+        for (size_t b = 0; b < _pixels; b += kBlock) {
+            const size_t e = b + kBlock < _pixels ? b + kBlock : _pixels;
+            double block = 0.0;
+            for (size_t i = b; i < e; ++i) {
+                T v = im[i];
+                if (v < mn) mn = v;
+                if (v > mx) {
+                    mx = v;
+                    mx_index = i;
+                }
+                block += double(v);
+                if (his) ++his[size_t(long(v) - long(std::numeric_limits<T>::min()))];
+            }
+            RunningStats group;
+            group.n = e - b;
+            group.mean = block / double(e - b);
+            for (size_t i = b; i < e; ++i) {
+                const double d = double(im[i]) - group.mean;
+                group.m2 += d * d;
+            }
+            acc.Merge(group);
+            sum += block;
+        }
+        _min[k] = mn;
+        _max[k] = mx;
+        _maxIndex[k] = mx_index;
+        _sum[k] = sum;
+        _slices[k] = acc;
+    }
+
+    size_t _pixels;
+    std::vector<RunningStats> _slices;
+    std::vector<double> _min, _max, _sum;
+    std::vector<size_t> _maxIndex;
+    std::vector<uint64_t> _hist;
+};
+
+/**
+ * @brief 并行计算体数据统计量 (按切片分块)
+ * @tparam T 图像数据类型
+ * @param im 图像指针
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param stats 输出的统计量
+ * @return 操作是否成功
+ */
+template<typename T>
+bool ComputeVolumeStats(const T *im, size_t width, size_t height, size_t slice, VolumeStats &stats) {
+    stats.Invalidate();
+    if (!im || !width || !height || !slice) return false;
+    size_t pixels = width * height;
+    VolumeStatsBuilder<T> builder(pixels, slice, ParallelChunkNum(0, slice));
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t c) {
+        builder.AddSlices(im + b * pixels, b, e, c);
+    });
+    builder.Finish(stats);
+    return true;
+}
+
+#endif //DIP_VOLUME_STATS_H
@@ -0,0 +1,459 @@
+// Program: DIP
+// FileName:bit_mask.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午9:30
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_BIT_MASK_H
+#define DIP_BIT_MASK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+
+/**
+ * @brief 按位存储的二值图 每个uint64_t字存一行中连续的64个像素
+ * @note 置位为目标(二值图中的黑色0), 清零为背景(白色最大值). 第x个像素为该行第x/64个字的
+ * 第x%64位(低位在左). 每行占words个字, 行尾超出width的位始终为0, 因此图像外按背景处理.
+ * 与每像素一个T的二值图相比内存为1/(8*sizeof(T)), 邻域与逻辑运算按字进行.
+ */
+struct BitMask {
+    size_t width = 0;
+    size_t height = 0;
+    size_t slice = 0;
+    size_t words = 0;               // 每行的字数
+    std::vector<uint64_t> bits;     // 第k张切片第y行从第(k*height+y)*words个字开始
+
+    /**
+     * @brief 按尺寸分配并清零
+     * @return 是否操作成功
+     */
+    bool Resize(size_t w, size_t h, size_t s) {
+        width = w;
+        height = h;
+        slice = s;
+        words = (w + 63) / 64;
+        try {
+            bits.assign(words * h * s, 0);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool SameSize(const BitMask &other) const {
+        return width == other.width && height == other.height && slice == other.slice;
+    }
+
+    uint64_t *Row(size_t y, size_t k = 0) { return &bits[(k * height + y) * words]; }
+
+    const uint64_t *Row(size_t y, size_t k = 0) const { return &bits[(k * height + y) * words]; }
+
+    bool Get(size_t x, size_t y, size_t k = 0) const { return (Row(y, k)[x / 64] >> (x % 64)) & 1; }
+
+    void Set(size_t x, size_t y, size_t k, bool value) {
+        const uint64_t bit = uint64_t(1) << (x % 64);
+        uint64_t &word = Row(y, k)[x / 64];
+        word = value ? word | bit : word & ~bit;
+    }
+
+    // 每行最后一个字中属于图像的位
+    uint64_t Tail() const { return width % 64 ? (uint64_t(1) << (width % 64)) - 1 : ~uint64_t(0); }
+};
+
+inline size_t BitCount(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return size_t(__builtin_popcountll(v));
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return size_t((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * @brief 目标像素数
+ */
+inline size_t BitMaskCount(const BitMask &mask) {
+    size_t count = 0;
+    for (size_t i = 0; i < mask.bits.size(); ++i)
+        count += BitCount(mask.bits[i]);
+    return count;
+}
+
+/**
+ * @brief 二值图转为按位存储 行间并行
+ * @note 转换时一并检查二值性, 之后按位的运算不再逐像素检查. strict为false时不检查, 非0像素都为背景
+ * (与Contour对非二值图的处理相同).
+ * @tparam T 图像数据类型
+ * @param im 二值图 目标为0 背景为最大值
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param mask 输出
+ * @param strict 是否检查二值性
+ * @return 操作是否成功 strict为true且不是二值图时返回false
+ */
+template<typename T>
+bool ImageToBitMask(const T *im, size_t width, size_t height, size_t slice, BitMask &mask, bool strict = true) {
+    if (!im || !width || !height || !slice) return false;
+    if (!mask.Resize(width, height, slice)) return false;
+    const T vmax = std::numeric_limits<T>::max();
+    const size_t rows = height * slice;
+    std::vector<size_t> bad(ParallelChunkNum(0, rows, 8), 0);
+    ParallelFor(0, rows, [&](size_t b, size_t e, size_t chunk) {
+        size_t count = 0;
+        for (size_t r = b; r < e; ++r) {
+            const T *src = im + r * width;
+            uint64_t *dst = &mask.bits[r * mask.words];
+            for (size_t i = 0; i < mask.words; ++i) {
+                const size_t x0 = i * 64, n = std::min(width - x0, size_t(64));
+                uint64_t word = 0;
+                for (size_t j = 0; j < n; ++j) {
+                    word |= uint64_t(src[x0 + j] == 0) << j;
+                    count += (src[x0 + j] != 0) & (src[x0 + j] != vmax);
+                }
+                dst[i] = word;
+            }
+        }
+        bad[chunk] = count;
+    }, 8);
+    for (size_t c = 0; c < bad.size(); ++c) {
+        if (strict && bad[c]) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 按位存储的二值图写回每像素一个T的二值图 目标为0 背景为最大值 行间并行
+ * @tparam T 图像数据类型
+ * @param mask 按位存储的二值图
+ * @param im 输出 width*height*slice个像素
+ * @return 操作是否成功
+ */
+template<typename T>
+bool BitMaskToImage(const BitMask &mask, T *im) {
+    if (!im || mask.bits.empty()) return false;
+    const T vmax = std::numeric_limits<T>::max();
+    const size_t width = mask.width;
+    ParallelFor(0, mask.height * mask.slice, [&](size_t b, size_t e, size_t) {
+        for (size_t r = b; r < e; ++r) {
+            const uint64_t *src = &mask.bits[r * mask.words];
+            T *dst = im + r * width;
+            for (size_t x = 0; x < width; ++x)
+                dst[x] = (src[x / 64] >> (x % 64)) & 1 ? T(0) : vmax;
+        }
+    }, 8);
+    return true;
+}
+
+/**
+ * @brief 一行移位 out的第x位为in的第x+d位, 越出[0, words*64)的位为0
+ * @param in 源行 words个字
+ * @param words 字数
+ * @param d 位移 为正时像素左移(向x减小方向)
+ * @param out 输出 words个字 不能与in相同
+ */
+inline void BitRowShift(const uint64_t *in, size_t words, long d, uint64_t *out) {
+    // d = 64*q + r, 0 <= r < 64
+    const long q = d >= 0 ? d / 64 : -((-d + 63) / 64);
+    const unsigned r = unsigned(d - q * 64);
+    const long n = long(words);
+    for (long i = 0; i < n; ++i) {
+        const long j = i + q;
+        const uint64_t lo = j >= 0 && j < n ? in[j] : 0;
+        const uint64_t hi = j + 1 >= 0 && j + 1 < n ? in[j + 1] : 0;
+        out[i] = r ? (lo >> r) | (hi << (64 - r)) : lo;
+    }
+}
+
+/**
+ * @brief 逐字合并 腐蚀为与, 膨胀为或
+ */
+inline void BitRowCombine(uint64_t *a, const uint64_t *b, size_t words, bool erode) {
+    if (erode) {
+        for (size_t i = 0; i < words; ++i)
+            a[i] &= b[i];
+    } else {
+        for (size_t i = 0; i < words; ++i)
+            a[i] |= b[i];
+    }
+}
+
+/**
+ * @brief 按位二值图的水平与垂直窗口运算 窗口为中心在原点的(2*rx+1)*(2*ry+1)矩形
+ * @note 窗口长度L的与/或由倍增得到: g覆盖[0, s)时 g |= g右移s 覆盖[0, 2s), 最后再合并一次
+ * 覆盖[0, L), 每行只需log2(L)+2次整字移位, 代价与窗口长度的对数成正比. 水平方向各行并行,
+ * 行两侧各补(rx+63)/64个0字; 垂直方向把(切片, 列带)的各行复制到上下各补ry个0行的缓冲中倍增,
+ * 各单元并行. 图像外按背景(0)处理, 与Erosion/Dilation的常数扩展相同.
+ * @param mask 按位存储的二值图 原地输出
+ * @param rx 水平半径
+ * @param ry 垂直半径
+ * @param erode true为腐蚀(窗口内全为目标时为目标) false为膨胀(窗口内有目标时为目标)
+ * @return 操作是否成功
+ */
+inline bool BitMaskMorphology(BitMask &mask, size_t rx, size_t ry, bool erode) {
+    if (mask.bits.empty()) return false;
+    const size_t words = mask.words, height = mask.height, slice = mask.slice;
+    const uint64_t tail = mask.Tail();
+    bool ok = true;
+    if (rx) {
+        const size_t pad = (rx + 63) / 64, n = words + 2 * pad, len = 2 * rx + 1;
+        ParallelFor(0, height * slice, [&](size_t b, size_t e, size_t) {
+            std::vector<uint64_t> g, t;
+            try {
+                g.resize(n);
+                t.resize(n);
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                ok = false;
+                return;
+            }
+            for (size_t r = b; r < e; ++r) {
+                uint64_t *row = &mask.bits[r * words];
+                std::fill(g.begin(), g.end(), 0);
+                std::copy(row, row + words, g.begin() + pad);
+                size_t s = 1;
+                for (; 2 * s <= len; s *= 2) {
+                    BitRowShift(g.data(), n, long(s), t.data());
+                    BitRowCombine(g.data(), t.data(), n, erode);
+                }
+                if (s < len) {
+                    BitRowShift(g.data(), n, long(len - s), t.data());
+                    BitRowCombine(g.data(), t.data(), n, erode);
+                }
+                // g的第x位覆盖[x, x+len) 输出第x位取g的第x-rx位
+                BitRowShift(g.data(), n, -long(rx), t.data());
+                std::copy(t.begin() + pad, t.begin() + pad + words, row);
+                row[words - 1] &= tail;
+            }
+        }, 8);
+        if (!ok) return false;
+    }
+    if (ry) {
+        const size_t chunks = ParallelChunkNum(0, slice * words);
+        const size_t bands = slice >= chunks ? 1 : std::min(words, (chunks + slice - 1) / slice);
+        const size_t rows = height + 2 * ry, len = 2 * ry + 1;
+        ParallelFor(0, slice * bands, [&](size_t b, size_t e, size_t) {
+            std::vector<uint64_t> g;
+            for (size_t u = b; u < e; ++u) {
+                const size_t k = u / bands, w0 = words * (u % bands) / bands, w1 = words * (u % bands + 1) / bands;
+                const size_t c = w1 - w0;
+                if (!c) continue;
+                try {
+                    g.assign(rows * c, 0);
+                }
+                catch (std::bad_alloc) {
+                    std::cout << "Failed to alloc memory!\n";
+                    ok = false;
+                    return;
+                }
+                // 缓冲第j行为图像第j-ry行
+                for (size_t y = 0; y < height; ++y)
+                    std::copy(mask.Row(y, k) + w0, mask.Row(y, k) + w1, &g[(y + ry) * c]);
+                // 按行递增原地合并 第j行只读取尚未更新的第j+s行
+                auto step = [&](size_t s) {
+                    for (size_t j = 0; j + s < rows; ++j)
+                        BitRowCombine(&g[j * c], &g[(j + s) * c], c, erode);
+                    if (erode)
+                        std::fill(g.begin() + (rows > s ? rows - s : 0) * c, g.end(), 0);
+                };
+                size_t s = 1;
+                for (; 2 * s <= len; s *= 2)
+                    step(s);
+                if (s < len) step(len - s);
+                // 第j行覆盖图像第j-ry ~ j+ry行
+                for (size_t y = 0; y < height; ++y)
+                    std::copy(&g[y * c], &g[y * c] + c, mask.Row(y, k) + w0);
+            }
+        }, 1);
+    }
+    return ok;
+}
+
+/**
+ * @brief 按位二值图的腐蚀 结构元素为中心在原点的(2*rx+1)*(2*ry+1)矩形 ry为0时为水平线, rx为0时为垂直线
+ * @note 窗口内全为目标时为目标, 图像外为背景. rx = 1、ry = 0与Erosion的mode 0在常数扩展时相同,
+ * rx = 0、ry = 1与mode 1相同.
+ * @param mask 按位存储的二值图 原地输出
+ * @param rx 水平半径
+ * @param ry 垂直半径
+ * @return 操作是否成功
+ */
+inline bool BitMaskErosion(BitMask &mask, size_t rx, size_t ry) {
+    return BitMaskMorphology(mask, rx, ry, true);
+}
+
+/**
+ * @brief 按位二值图的膨胀 结构元素为中心在原点的(2*rx+1)*(2*ry+1)矩形 窗口内有目标时为目标
+ * @param mask 按位存储的二值图 原地输出
+ * @param rx 水平半径
+ * @param ry 垂直半径
+ * @return 操作是否成功
+ */
+inline bool BitMaskDilation(BitMask &mask, size_t rx, size_t ry) {
+    return BitMaskMorphology(mask, rx, ry, false);
+}
+
+/**
+ * @brief 按位二值图的十字结构元素腐蚀与膨胀 十字为水平线(半径rx)与垂直线(半径ry)之并
+ * @note 腐蚀为两条线腐蚀结果之交, 膨胀为两条线膨胀结果之并. rx = ry = 1时与Erosion/Dilation的
+ * 3*3十字结构元素在常数扩展时相同.
+ * @param mask 按位存储的二值图 原地输出
+ * @param rx 水平半径
+ * @param ry 垂直半径
+ * @param erode true为腐蚀 false为膨胀
+ * @return 操作是否成功
+ */
+inline bool BitMaskCross(BitMask &mask, size_t rx, size_t ry, bool erode) {
+    BitMask vertical;
+    try {
+        vertical = mask;
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    if (!BitMaskMorphology(mask, rx, 0, erode) || !BitMaskMorphology(vertical, 0, ry, erode)) return false;
+    for (size_t i = 0; i < mask.bits.size(); ++i)
+        mask.bits[i] = erode ? mask.bits[i] & vertical.bits[i] : mask.bits[i] | vertical.bits[i];
+    return true;
+}
+
+/**
+ * @brief 按位二值图的开运算 先腐蚀 后膨胀
+ */
+inline bool BitMaskOpen(BitMask &mask, size_t rx, size_t ry) {
+    return BitMaskErosion(mask, rx, ry) && BitMaskDilation(mask, rx, ry);
+}
+
+/**
+ * @brief 按位二值图的闭运算 先膨胀 后腐蚀
+ */
+inline bool BitMaskClose(BitMask &mask, size_t rx, size_t ry) {
+    return BitMaskDilation(mask, rx, ry) && BitMaskErosion(mask, rx, ry);
+}
+
+/**
+ * @brief 按位二值图的轮廓 目标点的8邻域不全为目标时为轮廓点 行间并行
+ * @note 轮廓 = 目标 & ~(3*3腐蚀). 每个字先把上、中、下三行相与, 再与左右移一位(跨字的位由相邻字补入)
+ * 的结果相与, 一次处理64个像素. 图像外为背景, 与Contour的常数扩展相同.
+ * @param mask 按位存储的二值图
+ * @param contour 输出 可与mask相同
+ * @return 操作是否成功
+ */
+inline bool BitMaskContour(const BitMask &mask, BitMask &contour) {
+    if (mask.bits.empty()) return false;
+    BitMask copy;
+    const BitMask *src = &mask;
+    try {
+        if (&mask == &contour) {
+            copy = mask;
+            src = &copy;
+        } else {
+            contour = mask;
+        }
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    const size_t words = mask.words, height = mask.height;
+    ParallelFor(0, height * mask.slice, [&](size_t b, size_t e, size_t) {
+        for (size_t r = b; r < e; ++r) {
+            const size_t y = r % height;
+            const uint64_t *c = &src->bits[r * words];
+            const uint64_t *u = y ? c - words : nullptr, *d = y + 1 < height ? c + words : nullptr;
+            uint64_t *dst = &contour.bits[r * words];
+            // 三行相与 上下越界时为0
+            auto column = [&](size_t i) { return u && d ? u[i] & c[i] & d[i] : uint64_t(0); };
+            uint64_t prev = 0, cur = column(0);
+            for (size_t i = 0; i < words; ++i) {
+                const uint64_t next = i + 1 < words ? column(i + 1) : 0;
+                const uint64_t inner = cur & (cur << 1 | prev >> 63) & (cur >> 1 | next << 63);
+                dst[i] = c[i] & ~inner;
+                prev = cur;
+                cur = next;
+            }
+        }
+    }, 8);
+    return true;
+}
+
+/**
+ * @brief 按位二值图逐字运算的公共实现 out可与a或b相同
+ */
+template<class F>
+bool BitMaskLogic(const BitMask &a, const BitMask &b, BitMask &out, F op) {
+    if (a.bits.empty() || !a.SameSize(b)) return false;
+    if (&out != &a && &out != &b && !out.SameSize(a) && !out.Resize(a.width, a.height, a.slice))
+        return false;
+    const uint64_t *pa = a.bits.data(), *pb = b.bits.data();
+    uint64_t *po = out.bits.data();
+    ParallelFor(0, a.bits.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            po[i] = op(pa[i], pb[i]);
+    }, 1 << 14);
+    return true;
+}
+
+/**
+ * @brief 交集 a与b都为目标时为目标
+ */
+inline bool BitMaskAnd(const BitMask &a, const BitMask &b, BitMask &out) {
+    return BitMaskLogic(a, b, out, [](uint64_t x, uint64_t y) { return x & y; });
+}
+
+/**
+ * @brief 并集 a或b为目标时为目标
+ */
+inline bool BitMaskOr(const BitMask &a, const BitMask &b, BitMask &out) {
+    return BitMaskLogic(a, b, out, [](uint64_t x, uint64_t y) { return x | y; });
+}
+
+/**
+ * @brief 对称差 a与b只有一个为目标时为目标
+ */
+inline bool BitMaskXor(const BitMask &a, const BitMask &b, BitMask &out) {
+    return BitMaskLogic(a, b, out, [](uint64_t x, uint64_t y) { return x ^ y; });
+}
+
+/**
+ * @brief 差集 a为目标且b为背景时为目标
+ */
+inline bool BitMaskAndNot(const BitMask &a, const BitMask &b, BitMask &out) {
+    return BitMaskLogic(a, b, out, [](uint64_t x, uint64_t y) { return x & ~y; });
+}
+
+/**
+ * @brief 取反 目标与背景互换 行尾超出width的位保持为0
+ * @param mask 按位存储的二值图 原地输出
+ * @return 操作是否成功
+ */
+inline bool BitMaskNot(BitMask &mask) {
+    if (mask.bits.empty()) return false;
+    const size_t words = mask.words;
+    const uint64_t tail = mask.Tail();
+    ParallelFor(0, mask.height * mask.slice, [&](size_t b, size_t e, size_t) {
+        for (size_t r = b; r < e; ++r) {
+            uint64_t *row = &mask.bits[r * words];
+            for (size_t i = 0; i < words; ++i)
+                row[i] = ~row[i];
+            row[words - 1] &= tail;
+        }
+    }, 8);
+    return true;
+}
+
+#endif //DIP_BIT_MASK_H
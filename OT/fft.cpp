@@ -4,59 +4,65 @@
 // Date:    2017/5/20 下午5:43
 // Copyright (c) 2017 Lichun Zhang. All rights reserved.
 
+#include <algorithm>
+#include <cmath>
 #include "ortho_trans.h"
 
-/**!
- * @brief 按频率抽取的FFT
- * @param TD 指向时域数组的指针
- * @param FD 指向频域数组的指针
- * @param r  2的幂 即蝶形流图的级数
-// */
-void FFT(complex<double> *TD, complex<double> *FD, int r) {
-
-    long count = 1 << r;                    //傅里叶变换点数
-    complex<double> *w, *x1, *x2;
-    w = new complex<double>[count / 2];//加权系数
-    x1 = new complex<double>[count];   //蝶形输入
-    x2 = new complex<double>[count];   //蝶形输出
-
-    // 加权系数
-    double angle = 0.0;
-    for (long i = 0; i < count / 2; ++i) {
-        angle = -i * 2 * M_PI / count;
-        w[i] = complex<double>(cos(angle), sin(angle));
+FFTPlan::FFTPlan(int r) : _n(size_t(1) << r), _r(r), _w(_n / 2), _rev(_n, 0) {
+    for (size_t i = 0; i < _n / 2; ++i) {
+        double angle = -double(i) * 2 * M_PI / _n;
+        _w[i] = complex<double>(cos(angle), sin(angle));
     }
-
-    // 将时域点写入x1
-    memcpy(x1, TD, sizeof(complex<double>) * count);
-
-    // 蝶形算法FFT
-    for (int k = 0; k < r; ++k) {               //蝶形的级数
-        int bfsize = 1 << (r - k);              //当级点数大小
-        int bfcount = 1 << k;                   //当级蝶形套数
-        for (int j = 0; j < bfcount; ++j) {
-            int p = j * bfsize;
-            for (int i = 0; i < bfsize / 2; ++i) {
-                x2[i + p] = x1[i + p] + x1[i + p + bfsize / 2];
-                x2[i + p + bfsize / 2] = (x1[i + p] - x1[i + p + bfsize / 2]) * w[i * bfcount];
-            }
+    for (size_t i = 0; i < _n; ++i) {
+        for (int j = 0; j < r; ++j) {
+            if (i & (size_t(1) << j))
+                _rev[i] |= size_t(1) << (r - 1 - j);
         }
-        complex<double> *x = x1;
-        x1 = x2;    //上一级输出作为下一级输入
-        x2 = x;     //下一级的输出，将在下一级循环中覆盖，节省空间。
     }
+}
 
-    // 码位倒置 赋值FD
-    for (int i = 0; i < count; ++i) {
-        long p = 0;
-        for (int j = 0; j < r; ++j) {
-            if (i & (1 << j))
-                p += 1 << (r - 1 - j);
+void FFTPlan::Inverse(complex<double> *data) const {
+    Transform(data, true);
+    const double scale = 1.0 / _n;
+    for (size_t i = 0; i < _n; ++i)
+        data[i] *= scale;
+}
+
+/**
+ * @brief 按时间抽取的基2 FFT 先码位倒置再逐级蝶形运算 原地进行
+ * @param data 数据 长度为Size()
+ * @param inverse 是否逆变换(共轭加权系数 不除以N)
+ */
+void FFTPlan::Transform(complex<double> *data, bool inverse) const {
+    for (size_t i = 0; i < _n; ++i) {
+        if (i < _rev[i])
+            std::swap(data[i], data[_rev[i]]);
+    }
+    for (size_t len = 2; len <= _n; len <<= 1) {
+        const size_t half = len / 2, step = _n / len;
+        for (size_t p = 0; p < _n; p += len) {
+            for (size_t i = 0; i < half; ++i) {
+                // 复数乘法展开 避免std::complex乘法对inf/nan的额外检查
+                const complex<double> &w = _w[i * step], &d = data[p + i + half];
+                double wi = inverse ? -w.imag() : w.imag();
+                complex<double> u = data[p + i];
+                complex<double> v(d.real() * w.real() - d.imag() * wi, d.real() * wi + d.imag() * w.real());
+                data[p + i] = u + v;
+                data[p + i + half] = u - v;
+            }
         }
-        FD[i] = x1[p];
     }
+}
 
-    delete[] w;
-    delete[] x1;
-    delete[] x2;
+/**!
+ * @brief FFT 结果按自然顺序输出
+ * @param TD 指向时域数组的指针
+ * @param FD 指向频域数组的指针
+ * @param r  2的幂 即蝶形流图的级数
+ */
+void FFT(complex<double> *TD, complex<double> *FD, int r) {
+    FFTPlan plan(r);
+    // DCT等原地调用时TD与FD相同
+    if (FD != TD) memcpy(FD, TD, sizeof(complex<double>) * plan.Size());
+    plan.Forward(FD);
 }
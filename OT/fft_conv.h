@@ -0,0 +1,331 @@
+// Program: DIP
+// FileName:fft_conv.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午11:40
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_FFT_CONV_H
+#define DIP_FFT_CONV_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <border.h>
+#include <parallel.h>
+#include <template_trans.h>
+#include "ortho_trans.h"
+
+// 一次蝶形运算(复数乘加)相当于空域乘加的次数 由实测标定
+const double kButterflyCost = 4.5;
+// 分块超过该字节数时不在缓存中 每次蝶形运算的代价加倍
+const size_t kFFTCacheBytes = 256 * 1024;
+// 频域分块边长的上限 2^kMaxTileOrder
+const int kMaxTileOrder = 11;
+
+// 卷积方式 自动根据代价模型选择空域或频域
+enum ConvolutionDomain {
+    CONV_AUTO,
+    CONV_SPATIAL,
+    CONV_FREQUENCY
+};
+
+// N*N矩阵原地转置 按32*32的块交换 减少缓存缺失
+inline void TransposeSquare(complex<double> *data, size_t n) {
+    const size_t block = 32;
+    for (size_t bi = 0; bi < n; bi += block) {
+        for (size_t bj = bi; bj < n; bj += block) {
+            size_t ei = std::min(n, bi + block), ej = std::min(n, bj + block);
+            for (size_t i = bi; i < ei; ++i)
+                for (size_t j = std::max(bj, i + 1); j < ej; ++j)
+                    std::swap(data[i * n + j], data[j * n + i]);
+        }
+    }
+}
+
+/**
+ * @brief N*N复数数组的二维FFT: 逐行变换 转置 再逐行变换
+ * @note 正变换的结果是转置的频谱, 逆变换的输入也应是转置的频谱, 输出恢复为原方向.
+ * 频域逐点相乘与方向无关 因此省去了转置回来的一次.
+ * @param plan N点FFT计划
+ * @param data 数据 行优先 N*N
+ * @param inverse 是否逆变换(结果除以N*N)
+ */
+inline void FFT2D(const FFTPlan &plan, complex<double> *data, bool inverse) {
+    const size_t n = plan.Size();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < n; ++i) {
+            if (inverse) plan.Inverse(data + i * n);
+            else plan.Forward(data + i * n);
+        }
+        if (!pass) TransposeSquare(data, n);
+    }
+}
+
+/**
+ * @brief 空域模版运算每个输出像素的乘加次数
+ * @note 可分离的模版由Template分两次一维滤波
+ */
+inline double SpatialConvolutionCost(size_t filterW, size_t filterH, bool separable) {
+    return separable ? double(filterW + filterH) : double(filterW) * filterH;
+}
+
+/**
+ * @brief 边长2^order分块重叠保留法每个输出像素的代价(折算为乘加次数)
+ * @note 每块正、逆二维FFT各N*N*log2(N)次蝶形运算加N*N次频域乘法, 两个实数块合成一个复数块
+ * 同时变换. 与FFTTemplate相同, 图像先按border扩展出模版大小的边缘, 所有width*height个像素都输出;
+ * 每块有效输出(N-filterW+1)*(N-filterH+1)个像素, 按覆盖图像所需的块数计算, 因此超出图像的部分
+ * 也计入代价. 图像小于模版时扩展后仍可分块.
+ * @return 代价 分块小于模版时返回负数
+ */
+inline double FFTConvolutionCost(int order, size_t width, size_t height, size_t filterW, size_t filterH) {
+    const size_t n = size_t(1) << order;
+    if (n < filterW || n < filterH || !width || !height) return -1.0;
+    const size_t vw = n - filterW + 1, vh = n - filterH + 1;
+    const double tiles = double((width + vw - 1) / vw) * ((height + vh - 1) / vh);
+    const double butterfly = n * n * sizeof(complex<double>) > kFFTCacheBytes ? 2 * kButterflyCost : kButterflyCost;
+    return tiles * (2.0 * n * n * order + n * n) * butterfly / 2.0 / (double(width) * height);
+}
+
+/**
+ * @brief 选择频域分块的边长
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param filterW 模版宽度
+ * @param filterH 模版高度
+ * @param cost 非空时输出每个输出像素的代价
+ * @return 分块边长的阶数order(边长2^order) 没有可用的分块(模版大于2^kMaxTileOrder)时为0
+ */
+inline int SelectFFTTile(size_t width, size_t height, size_t filterW, size_t filterH, double *cost = nullptr) {
+    int best = 0;
+    double best_cost = -1.0;
+    for (int order = 1; order <= kMaxTileOrder; ++order) {
+        double c = FFTConvolutionCost(order, width, height, filterW, filterH);
+        if (c > 0.0 && (best_cost < 0.0 || c < best_cost)) {
+            best = order;
+            best_cost = c;
+        }
+        // 一块已覆盖整张扩展后的图像 更大的分块没有意义
+        if ((size_t(1) << order) >= std::max(width + filterW - 1, height + filterH - 1)) break;
+    }
+    if (cost) *cost = best_cost;
+    return best;
+}
+
+/**
+ * @brief 频域模版运算 预先计算模版频谱 供重叠保留法的各分块共用
+ * @note 模版按Template的约定为相关运算 out(x, y) = sum para[l][m] * in(x - cx + m, y - cy + l),
+ * 频域中即分块频谱乘以模版频谱的共轭. 模版是实数, 两个实数分块分别放在实部和虚部, 一次变换
+ * 同时得到两块的结果. 也可供反卷积等需要模版频谱的模块使用.
+ */
+class FFTConvolver {
+public:
+    FFTConvolver() : _filterW(0), _filterH(0) {}
+
+    /**
+     * @brief 设置模版 计算其2^order*2^order点频谱
+     * @param para_array 模版数组 filterH行filterW列
+     * @param filterW 模版宽度
+     * @param filterH 模版高度
+     * @param order 分块边长的阶数 边长不小于模版
+     * @return 操作是否成功
+     */
+    bool Init(const double *para_array, size_t filterW, size_t filterH, int order) {
+        const size_t n = size_t(1) << order;
+        if (!para_array || !filterW || !filterH || n < filterW || n < filterH) return false;
+        try {
+            _plan = FFTPlan(order);
+            _spectrum.assign(n * n, complex<double>(0.0, 0.0));
+            for (size_t l = 0; l < filterH; ++l)
+                for (size_t m = 0; m < filterW; ++m)
+                    _spectrum[l * n + m] = complex<double>(para_array[l * filterW + m], 0.0);
+            FFT2D(_plan, _spectrum.data(), false);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        for (size_t i = 0; i < n * n; ++i)
+            _spectrum[i] = std::conj(_spectrum[i]);
+        _filterW = filterW;
+        _filterH = filterH;
+        return true;
+    }
+
+    size_t TileSize() const { return _plan.Size(); }
+
+    // 每块在x、y方向的有效输出像素数
+    size_t ValidW() const { return TileSize() - _filterW + 1; }
+
+    size_t ValidH() const { return TileSize() - _filterH + 1; }
+
+    const FFTPlan &Plan() const { return _plan; }
+
+    // 模版频谱的共轭 N*N 转置存放(见FFT2D)
+    const std::vector<complex<double> > &Spectrum() const { return _spectrum; }
+
+    /**
+     * @brief 分块相关运算 原地进行
+     * @note 结果第(y, x)个元素为 sum para[l][m] * tile[y + l][x + m], 只有 y <= N-filterH 且
+     * x <= N-filterW 的元素没有循环卷积的混叠.
+     * @param tile 分块 N*N 实部、虚部各为一个实数分块
+     */
+    void Correlate(complex<double> *tile) const {
+        const size_t n = TileSize();
+        FFT2D(_plan, tile, false);
+        for (size_t i = 0; i < n * n; ++i) {
+            const complex<double> a = tile[i], &k = _spectrum[i];
+            tile[i] = complex<double>(a.real() * k.real() - a.imag() * k.imag(),
+                                      a.real() * k.imag() + a.imag() * k.real());
+        }
+        FFT2D(_plan, tile, true);
+    }
+
+private:
+    FFTPlan _plan;
+    std::vector<complex<double> > _spectrum;
+    size_t _filterW, _filterH;
+};
+
+/**
+ * @brief 频域模版运算 重叠保留法分块 结果与Template一致
+ * @note 与Template相同 每张切片先按border扩展出模版半径的边缘, 所有像素都处理, 输出经TemplateValue取整.
+ * 容差: 频域结果与空域乘加的差约为 1e-12*sum|para|*max|im|, 取整后逐像素相同; 仅当精确值
+ * 恰好落在取整边界(x.5)上时取整结果相差1(无符号类型的负值回绕后表现为0与最大值之差).
+ * 每张切片的分块两两一组并行.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 模版宽度
+ * @param filterH 模版高度
+ * @param filterCX 模版中心元素x坐标
+ * @param filterCY 模版中心元素y坐标
+ * @param para_array 模版数组
+ * @param coeff 模版系数
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @param order 分块边长的阶数 0为按代价模型选择, 没有可用的分块时改用Template
+ * @return 是否操作成功
+ */
+template<typename T>
+bool FFTTemplate(T *im, size_t width, size_t height, size_t slice,
+                 size_t filterW, size_t filterH, size_t filterCX, size_t filterCY,
+                 const double *para_array, double coeff, BorderMode border = BORDER_REPLICATE, int order = 0) {
+    if (!im || !width || !height || !slice || !para_array || !filterW || !filterH ||
+        filterCX >= filterW || filterCY >= filterH)
+        return false;
+    if (order <= 0) order = SelectFFTTile(width, height, filterW, filterH);
+    // 模版大于最大的分块 空域计算
+    if (order <= 0)
+        return Template(im, width, height, slice, filterW, filterH, filterCX, filterCY,
+                        const_cast<double *>(para_array), coeff, border);
+    FFTConvolver conv;
+    if (!conv.Init(para_array, filterW, filterH, order)) return false;
+    const size_t n = conv.TileSize(), pixels = width * height;
+    // 扩展图像中输出像素(x, y)的模版覆盖区左上角为(x, y)
+    const size_t pw = width + filterW - 1, ph = height + filterH - 1;
+    const size_t vw = conv.ValidW(), vh = conv.ValidH();
+    const size_t tx = (width + vw - 1) / vw, ty = (height + vh - 1) / vh;
+    const size_t tiles = tx * ty, pairs = (tiles + 1) / 2;
+    std::vector<T> pad;
+    try {
+        pad.resize(pw * ph);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    bool ok = true;
+    for (size_t k = 0; k < slice && ok; ++k) {
+        T *src = im + k * pixels;
+        PadRows(src, width, height, -long(filterCY), long(height + filterH - 1 - filterCY),
+                filterCX, filterW - 1 - filterCX, border, T(0), pad.data());
+        ParallelFor(0, pairs, [&](size_t b, size_t e, size_t) {
+            std::vector<complex<double> > tile;
+            try {
+                tile.resize(n * n);
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                ok = false;
+                return;
+            }
+            for (size_t p = b; p < e; ++p) {
+                // 第2p块放在实部 第2p+1块放在虚部
+                std::fill(tile.begin(), tile.end(), complex<double>(0.0, 0.0));
+                for (size_t h = 0; h < 2 && 2 * p + h < tiles; ++h) {
+                    size_t t = 2 * p + h;
+                    size_t bx = t % tx * vw, by = t / tx * vh;
+                    size_t cw = std::min(n, pw - bx), ch = std::min(n, ph - by);
+                    for (size_t i = 0; i < ch; ++i) {
+                        const T *row = &pad[(by + i) * pw + bx];
+                        complex<double> *dst = &tile[i * n];
+                        for (size_t j = 0; j < cw; ++j) {
+                            if (h) dst[j].imag(double(row[j]));
+                            else dst[j].real(double(row[j]));
+                        }
+                    }
+                }
+                conv.Correlate(tile.data());
+                for (size_t h = 0; h < 2 && 2 * p + h < tiles; ++h) {
+                    size_t t = 2 * p + h;
+                    size_t ox = t % tx * vw, oy = t / tx * vh;
+                    size_t cw = std::min(vw, width - ox), ch = std::min(vh, height - oy);
+                    for (size_t i = 0; i < ch; ++i) {
+                        const complex<double> *res = &tile[i * n];
+                        T *dst = src + (oy + i) * width + ox;
+                        for (size_t j = 0; j < cw; ++j)
+                            dst[j] = TemplateValue<T>((h ? res[j].imag() : res[j].real()) * coeff);
+                    }
+                }
+            }
+        }, 1);
+    }
+    return ok;
+}
+
+/**
+ * @brief 模版运算 根据代价模型自动选择空域(Template)或频域(FFTTemplate)
+ * @note 空域代价为每像素的乘加次数(可分离模版为filterW+filterH), 频域代价见FFTConvolutionCost.
+ * 小模版(如3*3、5*5)和可分离模版总是空域更快; 大的不可分离模版(大尺度LoG、匹配滤波、PSF)用频域.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 模版宽度
+ * @param filterH 模版高度
+ * @param filterCX 模版中心元素x坐标
+ * @param filterCY 模版中心元素y坐标
+ * @param para_array 模版数组
+ * @param coeff 模版系数
+ * @param domain 卷积方式 默认自动选择
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<typename T>
+bool Convolve(T *im, size_t width, size_t height, size_t slice,
+              size_t filterW, size_t filterH, size_t filterCX, size_t filterCY,
+              double *para_array, double coeff, ConvolutionDomain domain = CONV_AUTO,
+              BorderMode border = BORDER_REPLICATE) {
+    if (domain == CONV_AUTO) {
+        std::vector<double> kx, ky;
+        bool separable = filterW * filterH > filterW + filterH &&
+                         SeparateKernel(para_array, filterW, filterH, kx, ky);
+        double fft_cost = 0.0;
+        SelectFFTTile(width, height, filterW, filterH, &fft_cost);
+        domain = fft_cost > 0.0 && fft_cost < SpatialConvolutionCost(filterW, filterH, separable)
+                 ? CONV_FREQUENCY : CONV_SPATIAL;
+    }
+    if (domain == CONV_FREQUENCY)
+        return FFTTemplate(im, width, height, slice, filterW, filterH, filterCX, filterCY,
+                           para_array, coeff, border);
+    return Template(im, width, height, slice, filterW, filterH, filterCX, filterCY, para_array, coeff, border);
+}
+
+#endif //DIP_FFT_CONV_H
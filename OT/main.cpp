@@ -6,7 +6,10 @@
 
 #include <mhd_reader.h>
 #include <iostream>
+#include <cstdlib>
+#include <vector>
 #include "ortho_trans.h"
+#include "fft_conv.h"
 
 
 int TestOrthogonal(int index, const char *inname, const char *outname) {
@@ -28,6 +31,29 @@ int TestOrthogonal(int index, const char *inname, const char *outname) {
             flag = ::DiscretCosin(reader->GetImData(),
                                   reader->GetImWidth(), reader->GetImHeight(), reader->GetImSlice());
             break;
+        case 2: {
+            // 频域卷积与空域Template对比 随机模版
+            size_t size = 15;
+            std::cout << "Enter the kernel size:\t";
+            std::cin >> size;
+            std::vector<double> kernel(size * size);
+            for (size_t i = 0; i < kernel.size(); ++i)
+                kernel[i] = double(rand()) / RAND_MAX - 0.5;
+            size_t pixels = reader->GetImWidth() * reader->GetImHeight() * reader->GetImSlice();
+            std::vector<unsigned char> spatial(reader->GetImData(), reader->GetImData() + pixels);
+            clock_t t0 = clock();
+            ::Template(spatial.data(), reader->GetImWidth(), reader->GetImHeight(), reader->GetImSlice(),
+                       size, size, size / 2, size / 2, kernel.data(), 1.0);
+            std::cout << "Spatial: " << double(clock() - t0) / 1000 << " ms\n";
+            t_bg = clock();
+            flag = ::FFTTemplate(reader->GetImData(), reader->GetImWidth(), reader->GetImHeight(),
+                                 reader->GetImSlice(), size, size, size / 2, size / 2, kernel.data(), 1.0);
+            size_t diff = 0;
+            for (size_t i = 0; i < pixels; ++i)
+                if (spatial[i] != reader->GetImData()[i]) ++diff;
+            std::cout << "Pixels differing from spatial: " << diff << "\n";
+            break;
+        }
         default:
             break;
     }
@@ -51,7 +77,8 @@ int main(int argc, char *argv[]) {
     }
     std::cout << "Functions:\n"
               << "0: FFT\n"
-              << "1: DCT\n";
+              << "1: DCT\n"
+              << "2: FFT Convolution vs Template\n";
     size_t index = 0;
     std::cin >> index;
     return TestOrthogonal(index, argv[1], argv[2]);
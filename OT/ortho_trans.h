@@ -8,10 +8,39 @@
 #define DIP_OT_INCLUDES_H_H
 
 #include <ccomplex>
+#include <cstring>
+#include <vector>
 
 //using namespace std;
 using std::complex;
 
+/**
+ * @brief 2^r点FFT计划 预先计算旋转因子和码位倒置表 原地变换
+ * @note 同一计划可重复使用(多线程只读共享), 避免每次变换重新分配和计算加权系数.
+ */
+class FFTPlan {
+public:
+    explicit FFTPlan(int r = 0);
+
+    size_t Size() const { return _n; }
+
+    int Order() const { return _r; }
+
+    // 正变换 X[k] = sum x[n] e^(-2πikn/N)
+    void Forward(complex<double> *data) const { Transform(data, false); }
+
+    // 逆变换 结果除以N
+    void Inverse(complex<double> *data) const;
+
+private:
+    void Transform(complex<double> *data, bool inverse) const;
+
+    size_t _n;
+    int _r;
+    std::vector<complex<double> > _w;   // 加权系数 e^(-2πik/N) k < N/2
+    std::vector<size_t> _rev;           // 码位倒置表
+};
+
 void FFT(complex<double> *TD, complex<double> *FD, int r);
 
 template<typename T>
@@ -0,0 +1,334 @@
+// Program: DIP
+// FileName:auto_threshold.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午9:10
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_AUTO_THRESHOLD_H
+#define DIP_AUTO_THRESHOLD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+#include "histogram.h"
+#include "point_trans.h"
+
+// 自动阈值的选取方法
+enum ThresholdMethod {
+    THRESHOLD_OTSU = 0,         // 最大类间方差 可分为2~4类
+    THRESHOLD_TRIANGLE = 1,     // 三角法 适合单峰加长尾的直方图
+    THRESHOLD_MAX_ENTROPY = 2   // 最大熵(Kapur)
+};
+
+// 多类Otsu动态规划为O(类数*灰度级数^2) 灰度范围超过该级数时先合并相邻灰度级
+const size_t kMultiOtsuBins = 1024;
+
+/**
+ * @brief Otsu阈值 O(灰度级数)
+ * @param his 直方图
+ * @param lo 第一个非零bin
+ * @param hi 最后一个非零bin
+ * @return 阈值bin t: bin < t 为背景, bin >= t 为前景
+ */
+inline size_t OtsuThreshold(const uint64_t *his, size_t lo, size_t hi) {
+    double n = 0.0, sum = 0.0;
+    for (size_t i = lo; i <= hi; ++i) {
+        n += double(his[i]);
+        sum += double(his[i]) * (i - lo);
+    }
+    double w0 = 0.0, s0 = 0.0, best = -1.0;
+    size_t t = lo + 1;
+    for (size_t i = lo; i < hi; ++i) {
+        w0 += double(his[i]);
+        s0 += double(his[i]) * (i - lo);
+        double w1 = n - w0;
+        if (w0 <= 0.0 || w1 <= 0.0) continue;
+        // 类间方差 w0*w1*(mu0-mu1)^2 的等价形式
+        double d = sum * w0 - s0 * n;
+        double between = d * d / (w0 * w1);
+        if (between > best) {
+            best = between;
+            t = i + 1;
+        }
+    }
+    return t;
+}
+
+/**
+ * @brief 多类Otsu阈值 动态规划使各类的 (类内灰度和)^2/类内像素数 之和最大 (等价于类间方差最大)
+ * @note O(classes * bins^2) bins = hi-lo+1
+ * @param his 直方图
+ * @param lo 第一个非零bin
+ * @param hi 最后一个非零bin
+ * @param classes 类数
+ * @param th 输出classes-1个递增的阈值bin
+ * @return 操作是否成功
+ */
+inline bool MultiOtsuThresholds(const uint64_t *his, size_t lo, size_t hi, size_t classes,
+                                std::vector<size_t> &th) {
+    const size_t n = hi - lo + 1;
+    if (classes < 2 || classes > n) return false;
+    std::vector<double> p, s, best, prev;
+    std::vector<size_t> from;
+    try {
+        p.assign(n + 1, 0.0);
+        s.assign(n + 1, 0.0);
+        best.assign(n + 1, 0.0);
+        prev.assign(n + 1, 0.0);
+        from.assign(classes * (n + 1), 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        p[i + 1] = p[i] + double(his[lo + i]);
+        s[i + 1] = s[i] + double(his[lo + i]) * i;
+    }
+    // 区间[a, b)作为一类的得分
+    auto score = [&](size_t a, size_t b) {
+        double w = p[b] - p[a], m = s[b] - s[a];
+        return w > 0.0 ? m * m / w : 0.0;
+    };
+    // best[b]: 前b个灰度级分为c+1类的最大得分 每类至少一个灰度级
+    for (size_t b = 1; b <= n; ++b)
+        best[b] = score(0, b);
+    for (size_t c = 1; c < classes; ++c) {
+        best.swap(prev);
+        for (size_t b = c + 1; b <= n; ++b) {
+            // 最后一类只需计算b = n
+            if (c == classes - 1 && b != n) continue;
+            double v = -1.0;
+            for (size_t a = c; a < b; ++a) {
+                double cand = prev[a] + score(a, b);
+                if (cand > v) {
+                    v = cand;
+                    from[c * (n + 1) + b] = a;
+                }
+            }
+            best[b] = v;
+        }
+    }
+    th.assign(classes - 1, 0);
+    for (size_t c = classes - 1, b = n; c > 0; --c) {
+        b = from[c * (n + 1) + b];
+        th[c - 1] = lo + b;
+    }
+    return true;
+}
+
+/**
+ * @brief 三角法阈值 在峰值与较长一侧拖尾端点的连线下方 取离连线最远的灰度级
+ * @param his 直方图
+ * @param lo 第一个非零bin
+ * @param hi 最后一个非零bin
+ * @return 阈值bin t: bin < t 为背景, bin >= t 为前景
+ */
+inline size_t TriangleThreshold(const uint64_t *his, size_t lo, size_t hi) {
+    size_t peak = lo;
+    for (size_t i = lo; i <= hi; ++i)
+        if (his[i] > his[peak]) peak = i;
+    const double hp = double(his[peak]);
+    double best = -1.0;
+    size_t t = peak;
+    if (hi - peak >= peak - lo) {
+        // 连线为(peak, hp)到(hi + 1, 0)
+        const double e = double(hi + 1);
+        for (size_t i = peak; i <= hi; ++i) {
+            double d = hp * (e - i) - (e - peak) * double(his[i]);
+            if (d > best) {
+                best = d;
+                t = i;
+            }
+        }
+    } else {
+        // 连线为(lo - 1, 0)到(peak, hp)
+        const double e = double(lo) - 1.0;
+        for (size_t i = lo; i <= peak; ++i) {
+            double d = hp * (i - e) - (peak - e) * double(his[i]);
+            if (d > best) {
+                best = d;
+                t = i;
+            }
+        }
+    }
+    return t + 1;
+}
+
+/**
+ * @brief 最大熵阈值(Kapur) 使背景与前景的熵之和最大 O(灰度级数)
+ * @param his 直方图
+ * @param lo 第一个非零bin
+ * @param hi 最后一个非零bin
+ * @return 阈值bin t: bin < t 为背景, bin >= t 为前景
+ */
+inline size_t MaxEntropyThreshold(const uint64_t *his, size_t lo, size_t hi) {
+    double n = 0.0, plogp = 0.0;
+    for (size_t i = lo; i <= hi; ++i)
+        n += double(his[i]);
+    for (size_t i = lo; i <= hi; ++i)
+        if (his[i]) plogp += his[i] / n * std::log(his[i] / n);
+    // 一类的熵 H = log(P) - sum(p*log p)/P
+    double p0 = 0.0, a0 = 0.0, best = -std::numeric_limits<double>::max();
+    size_t t = lo + 1;
+    for (size_t i = lo; i < hi; ++i) {
+        if (his[i]) {
+            double p = his[i] / n;
+            p0 += p;
+            a0 += p * std::log(p);
+        }
+        double p1 = 1.0 - p0;
+        if (p0 <= 0.0 || p1 <= 1e-12) continue;
+        double h = std::log(p0) - a0 / p0 + std::log(p1) - (plogp - a0) / p1;
+        if (h > best) {
+            best = h;
+            t = i + 1;
+        }
+    }
+    return t;
+}
+
+/**
+ * @brief 由直方图选取阈值
+ * @tparam T 图像数据类型 8/16位整数
+ * @param his 直方图
+ * @param method 选取方法
+ * @param classes 类数 Otsu可为2~4 其它方法为2
+ * @param th 输出classes-1个递增的阈值灰度 灰度 < th[0] 为第一类
+ * @return 操作是否成功
+ */
+template<typename T>
+bool SelectThresholds(const Histogram<T> &his, ThresholdMethod method, size_t classes,
+                      std::vector<long> &th) {
+    if (!his.total || his.counts.size() != Histogram<T>::kBins) return false;
+    if (classes < 2 || classes > 4 || (classes > 2 && method != THRESHOLD_OTSU)) {
+        std::cout << "Unsupported number of classes: " << classes << "\n";
+        return false;
+    }
+    const uint64_t *counts = his.counts.data();
+    const size_t lo = Histogram<T>::Bin(his.min), hi = Histogram<T>::Bin(his.max);
+    const long base = std::numeric_limits<T>::min();
+    th.assign(classes - 1, long(his.max) + 1);
+    // 只有一个灰度级: 全部归为第一类
+    if (lo == hi) return true;
+    if (classes == 2) {
+        size_t t = method == THRESHOLD_TRIANGLE ? TriangleThreshold(counts, lo, hi)
+                 : method == THRESHOLD_MAX_ENTROPY ? MaxEntropyThreshold(counts, lo, hi)
+                 : OtsuThreshold(counts, lo, hi);
+        th[0] = long(t) + base;
+        return true;
+    }
+    std::vector<size_t> bins;
+    const size_t range = hi - lo + 1;
+    if (range <= kMultiOtsuBins) {
+        if (!MultiOtsuThresholds(counts, lo, hi, classes, bins)) return false;
+        for (size_t c = 0; c < bins.size(); ++c)
+            th[c] = long(bins[c]) + base;
+        return true;
+    }
+    // 合并相邻灰度级: 第i个bin归入第(i-lo)*kMultiOtsuBins/range级
+    std::vector<uint64_t> merged;
+    try {
+        merged.assign(kMultiOtsuBins, 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    for (size_t i = lo; i <= hi; ++i)
+        merged[(i - lo) * kMultiOtsuBins / range] += counts[i];
+    if (!MultiOtsuThresholds(merged.data(), 0, kMultiOtsuBins - 1, classes, bins)) return false;
+    // 第q级的第一个灰度级
+    for (size_t c = 0; c < bins.size(); ++c)
+        th[c] = long(lo + (bins[c] * range + kMultiOtsuBins - 1) / kMultiOtsuBins) + base;
+    return true;
+}
+
+/**
+ * @brief 自动阈值分割 由直方图选取阈值后按阈值变换
+ * @note 全局模式使用体数据统计量缓存中的直方图(无效时并行统计), 不再遍历像素选阈值,
+ * 分割与ThresholdTrans共用一次查表变换. 逐切片模式按切片并行: 每个切片统计直方图、
+ * 选阈值、变换在同一任务内完成, 切片仍在缓存中. 两类时输出0和最大值(与ThresholdTrans相同),
+ * 多类时输出在[0, 最大值]内均匀分布的灰度级.
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像指针
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param method 选取方法
+ * @param classes 类数 Otsu可为2~4 其它方法为2
+ * @param perSlice 是否逐切片选取阈值
+ * @param stats 体数据统计量缓存 分割后失效
+ * @param thresholds 非空时输出选取的阈值 全局模式classes-1个 逐切片模式slice*(classes-1)个
+ * @return 操作是否成功
+ */
+template<typename T>
+bool AutoThresholdTrans(T *im, size_t width, size_t height, size_t slice, ThresholdMethod method,
+                        size_t classes = 2, bool perSlice = false, VolumeStats *stats = nullptr,
+                        std::vector<long> *thresholds = nullptr) {
+    if (!im || !width || !height || !slice || classes < 2) return false;
+    const size_t pixels = width * height, bins = Histogram<T>::kBins;
+    if (!perSlice) {
+        Histogram<T> his;
+        std::vector<long> th;
+        std::vector<T> lut;
+        if (!GetHistogram(im, pixels * slice, stats, his)) return false;
+        if (!SelectThresholds(his, method, classes, th)) return false;
+        if (stats) stats->Invalidate();
+        if (thresholds) *thresholds = th;
+        return ThresholdLUT(th, lut) && ApplyLUT(im, pixels * slice, lut);
+    }
+
+    if (stats) stats->Invalidate();
+    std::vector<long> all;
+    try {
+        all.assign(slice * (classes - 1), 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    std::vector<char> ok(slice, 0);
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        Histogram<T> his;
+        std::vector<long> th;
+        std::vector<T> lut;
+        try {
+            his.counts.resize(bins);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return;
+        }
+        for (size_t k = b; k < e; ++k) {
+            T *p = im + k * pixels;
+            std::fill(his.counts.begin(), his.counts.end(), 0);
+            for (size_t i = 0; i < pixels; ++i)
+                ++his.counts[Histogram<T>::Bin(p[i])];
+            size_t lo = 0, hi = bins - 1;
+            while (!his.counts[lo]) ++lo;
+            while (!his.counts[hi]) --hi;
+            his.min = Histogram<T>::Value(lo);
+            his.max = Histogram<T>::Value(hi);
+            his.total = pixels;
+            if (!SelectThresholds(his, method, classes, th) || !ThresholdLUT(th, lut)) continue;
+            // 已在并行区域内 ApplyLUT串行执行
+            ApplyLUT(p, pixels, lut);
+            std::copy(th.begin(), th.end(), all.begin() + k * (classes - 1));
+            ok[k] = 1;
+        }
+    }, 1);
+    if (thresholds) thresholds->swap(all);
+    for (size_t k = 0; k < slice; ++k)
+        if (!ok[k]) return false;
+    return true;
+}
+
+#endif //DIP_AUTO_THRESHOLD_H
@@ -0,0 +1,264 @@
+// Program: DIP
+// FileName:clahe.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午6:10
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_CLAHE_H
+#define DIP_CLAHE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+#include "histogram.h"
+
+// 限制对比度直方图的最大灰度级数 16位数据量化到该级数(8位数据不量化)
+const size_t kClaheBins = 256;
+
+/**
+ * @brief CLAHE的灰度量化: 把体数据灰度范围[vmin, vmax]均匀量化为bins级
+ */
+struct ClaheRange {
+    long vmin, vmax;
+    size_t bins;
+
+    ClaheRange(long lo, long hi) : vmin(lo), vmax(hi) {
+        long range = hi - lo + 1;
+        bins = range < long(kClaheBins) ? size_t(range) : kClaheBins;
+    }
+
+    size_t Bin(long v) const { return size_t((v - vmin) * long(bins) / (vmax - vmin + 1)); }
+
+    // 累积计数cdf(共n个像素)映射到输出灰度
+    float Map(double cdf, double n) const { return float(vmin + (vmax - vmin) * cdf / n); }
+};
+
+/**
+ * @brief 限制对比度的累积分布 超过限制的计数均匀分配到所有灰度级
+ * @param his 直方图(bins级)
+ * @param bins 灰度级数
+ * @param n 像素总数
+ * @param clipLimit 限制为平均每级计数的倍数
+ * @param cdf 输出 cdf[b]为灰度级不超过b的(重新分配后)计数
+ */
+inline void ClippedCDF(const uint32_t *his, size_t bins, double n, double clipLimit, float *cdf) {
+    double limit = clipLimit * n / bins;
+    if (limit < 1.0) limit = 1.0;
+    double excess = 0.0;
+    for (size_t b = 0; b < bins; ++b)
+        if (his[b] > limit) excess += his[b] - limit;
+    double step = excess / bins, sum = 0.0;
+    for (size_t b = 0; b < bins; ++b) {
+        sum += (his[b] > limit ? limit : double(his[b])) + step;
+        cdf[b] = float(sum);
+    }
+}
+
+/**
+ * @brief 限制对比度自适应直方图均衡化(CLAHE) 逐切片处理
+ * @note 切片划分为tilesX*tilesY个分块, 各分块的直方图和映射表并行计算, 每个像素
+ * 由相邻4个分块中心的映射表双线性插值. 统计和映射都是每像素O(1), 总代价与分块大小无关.
+ * 输出灰度范围与输入体数据的灰度范围相同.
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像指针
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param tilesX 水平方向分块数
+ * @param tilesY 垂直方向分块数
+ * @param clipLimit 对比度限制 直方图每级计数不超过平均值的clipLimit倍
+ * @param stats 体数据统计量缓存 有效时从中取灰度范围 变换后失效
+ * @return 操作是否成功
+ */
+template<typename T>
+bool CLAHE(T *im, size_t width, size_t height, size_t slice,
+           size_t tilesX, size_t tilesY, double clipLimit, VolumeStats *stats = nullptr) {
+    if (!im || !width || !height || !slice || !tilesX || !tilesY) return false;
+    if (tilesX > width) tilesX = width;
+    if (tilesY > height) tilesY = height;
+    Histogram<T> his;
+    if (!GetHistogram(im, width * height * slice, stats, his)) return false;
+    if (stats) stats->Invalidate();
+    const ClaheRange range(his.min, his.max);
+    const size_t bins = range.bins, tiles = tilesX * tilesY;
+
+    std::vector<float> luts;     // 每个切片每个分块的映射表
+    std::vector<size_t> tx0, tx1;
+    std::vector<float> wx;
+    try {
+        luts.resize(slice * tiles * bins);
+        tx0.resize(width);
+        tx1.resize(width);
+        wx.resize(width);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+
+    // 各分块直方图 -> 限制对比度的映射表
+    ParallelFor(0, slice * tiles, [&](size_t b, size_t e, size_t) {
+        std::vector<uint32_t> h(bins);
+        std::vector<float> cdf(bins);
+        for (size_t t = b; t < e; ++t) {
+            size_t k = t / tiles, ty = t % tiles / tilesX, tx = t % tilesX;
+            size_t x0 = tx * width / tilesX, x1 = (tx + 1) * width / tilesX;
+            size_t y0 = ty * height / tilesY, y1 = (ty + 1) * height / tilesY;
+            std::fill(h.begin(), h.end(), 0);
+            for (size_t y = y0; y < y1; ++y) {
+                const T *row = im + k * width * height + y * width;
+                for (size_t x = x0; x < x1; ++x)
+                    ++h[range.Bin(row[x])];
+            }
+            double n = double(x1 - x0) * (y1 - y0);
+            ClippedCDF(h.data(), bins, n, clipLimit, cdf.data());
+            float *lut = &luts[t * bins];
+            for (size_t i = 0; i < bins; ++i)
+                lut[i] = range.Map(cdf[i], n);
+        }
+    });
+
+    // 像素在相邻分块中心之间的位置 边缘外只用最近的分块
+    auto locate = [](size_t pos, size_t size, size_t count, size_t &t0, size_t &t1, float &w) {
+        double f = (pos + 0.5) * count / size - 0.5;
+        if (f <= 0.0) {
+            t0 = t1 = 0;
+            w = 0.0f;
+        } else if (f >= count - 1) {
+            t0 = t1 = count - 1;
+            w = 0.0f;
+        } else {
+            t0 = size_t(f);
+            t1 = t0 + 1;
+            w = float(f - t0);
+        }
+    };
+    for (size_t x = 0; x < width; ++x)
+        locate(x, width, tilesX, tx0[x], tx1[x], wx[x]);
+
+    // 双线性插值映射
+    ParallelFor(0, slice * height, [&](size_t b, size_t e, size_t) {
+        for (size_t r = b; r < e; ++r) {
+            size_t k = r / height, y = r % height, ty0 = 0, ty1 = 0;
+            float wy = 0.0f;
+            locate(y, height, tilesY, ty0, ty1, wy);
+            const float *top = &luts[(k * tiles + ty0 * tilesX) * bins];
+            const float *bottom = &luts[(k * tiles + ty1 * tilesX) * bins];
+            T *row = im + r * width;
+            for (size_t x = 0; x < width; ++x) {
+                size_t v = range.Bin(row[x]);
+                size_t a = tx0[x] * bins + v, c = tx1[x] * bins + v;
+                float up = top[a] + wx[x] * (top[c] - top[a]);
+                float down = bottom[a] + wx[x] * (bottom[c] - bottom[a]);
+                row[x] = T(std::lround(up + wy * (down - up)));
+            }
+        }
+    }, 16);
+    return true;
+}
+
+/**
+ * @brief 精确的逐像素CLAHE 每个像素用以其为中心的(2*radius+1)^2窗口的直方图
+ * @note 滑动直方图: 每列维护纵向窗口内的列直方图(下移一行时每列加一个像素减一个像素),
+ * 窗口右移时加上进入的列直方图、减去离开的列直方图. 每像素代价O(灰度级数) 与窗口大小无关.
+ * 行带并行 每个行带独立初始化列直方图. 窗口在图像边缘处截断.
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像指针
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param radius 窗口半径
+ * @param clipLimit 对比度限制 直方图每级计数不超过平均值的clipLimit倍
+ * @param stats 体数据统计量缓存 有效时从中取灰度范围 变换后失效
+ * @return 操作是否成功
+ */
+template<typename T>
+bool CLAHESliding(T *im, size_t width, size_t height, size_t slice,
+                  size_t radius, double clipLimit, VolumeStats *stats = nullptr) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t size = width * height * slice;
+    Histogram<T> his;
+    if (!GetHistogram(im, size, stats, his)) return false;
+    if (stats) stats->Invalidate();
+    const ClaheRange range(his.min, his.max);
+    const size_t bins = range.bins;
+    const long r = long(radius), w = long(width), h = long(height);
+
+    // 先量化为灰度级索引 原图即可直接写入结果
+    std::vector<uint8_t> idx;
+    try {
+        idx.resize(size);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    ParallelFor(0, size, [&](size_t b, size_t e, size_t) {
+        for (size_t i = b; i < e; ++i)
+            idx[i] = uint8_t(range.Bin(im[i]));
+    }, kHistogramGrain);
+
+    ParallelFor(0, slice * height, [&](size_t b, size_t e, size_t) {
+        std::vector<uint32_t> cols(width * bins), win(bins);
+        for (size_t g = b; g < e;) {
+            size_t k = g / height;
+            long y0 = long(g % height), y1 = std::min(h, y0 + long(e - g));
+            const uint8_t *src = &idx[k * width * height];
+            T *dst = im + k * width * height;
+            // 行带第一行的列直方图
+            std::fill(cols.begin(), cols.end(), 0);
+            for (long y = std::max(0L, y0 - r); y < std::min(h, y0 + r + 1); ++y)
+                for (long x = 0; x < w; ++x)
+                    ++cols[x * bins + src[y * w + x]];
+            for (long y = y0; y < y1; ++y) {
+                if (y > y0) {
+                    long out = y - r - 1, in = y + r;
+                    for (long x = 0; x < w; ++x) {
+                        if (out >= 0) --cols[x * bins + src[out * w + x]];
+                        if (in < h) ++cols[x * bins + src[in * w + x]];
+                    }
+                }
+                long rows = std::min(h - 1, y + r) - std::max(0L, y - r) + 1;
+                std::fill(win.begin(), win.end(), 0);
+                for (long x = 0; x <= std::min(w - 1, r); ++x)
+                    for (size_t i = 0; i < bins; ++i)
+                        win[i] += cols[x * bins + i];
+                for (long x = 0; x < w; ++x) {
+                    if (x > 0) {
+                        if (x + r < w) {
+                            const uint32_t *c = &cols[(x + r) * bins];
+                            for (size_t i = 0; i < bins; ++i) win[i] += c[i];
+                        }
+                        if (x - r - 1 >= 0) {
+                            const uint32_t *c = &cols[(x - r - 1) * bins];
+                            for (size_t i = 0; i < bins; ++i) win[i] -= c[i];
+                        }
+                    }
+                    double n = double(rows) * (std::min(w - 1, x + r) - std::max(0L, x - r) + 1);
+                    double limit = clipLimit * n / bins;
+                    if (limit < 1.0) limit = 1.0;
+                    // 只需要当前灰度级的累积值: 截断后的计数和 加上均匀分配的超出量
+                    size_t v = src[y * w + x];
+                    double excess = 0.0, below = 0.0;
+                    for (size_t i = 0; i < bins; ++i) {
+                        double c = win[i];
+                        excess += c > limit ? c - limit : 0.0;
+                        if (i <= v) below += c > limit ? limit : c;
+                    }
+                    double cdf = below + excess * (v + 1) / bins;
+                    dst[y * w + x] = T(std::lround(range.Map(cdf, n)));
+                }
+            }
+            g += y1 - y0;
+        }
+    }, 16);
+    return true;
+}
+
+#endif //DIP_CLAHE_H
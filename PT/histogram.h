@@ -0,0 +1,224 @@
+// Program: DIP
+// FileName:histogram.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午5:05
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_HISTOGRAM_H
+#define DIP_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <parallel.h>
+#include <volume_stats.h>
+
+// 每个并行分块至少统计的像素数
+const size_t kHistogramGrain = 1 << 16;
+
+/**
+ * @brief 灰度直方图 覆盖类型T的全部灰度级(8位256个 16位65536个)
+ * @note 第i个bin对应灰度值 numeric_limits<T>::min() + i
+ * @tparam T 图像数据类型 不超过16位的整数
+ */
+template<typename T>
+struct Histogram {
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 2,
+                  "Histogram supports 8/16-bit integer images");
+    static const size_t kBins = size_t(1) << (8 * sizeof(T));
+
+    std::vector<uint64_t> counts;
+    T min = 0, max = 0;     // 出现的最小/最大灰度
+    uint64_t total = 0;     // 像素总数
+
+    static size_t Bin(T v) { return size_t(long(v) - long(std::numeric_limits<T>::min())); }
+
+    static T Value(size_t bin) { return T(long(bin) + long(std::numeric_limits<T>::min())); }
+};
+
+/**
+ * @brief 并行统计直方图 同时得到最小/最大灰度
+ * @note 每个分块统计私有直方图后按bin并行归约. 8位图像每个分块用4个子直方图
+ * 轮流计数, 避免相邻像素灰度相同时对同一计数器的连续读改写(store-to-load)相互等待.
+ * 最小/最大灰度由归约后的首末非零bin得到 不需要单独遍历数据.
+ * @tparam T 图像数据类型
+ * @param im 图像指针
+ * @param size 像素个数
+ * @param his 输出的直方图
+ * @return 操作是否成功
+ */
+template<typename T>
+bool ComputeHistogram(const T *im, size_t size, Histogram<T> &his) {
+    if (!im || !size) return false;
+    const size_t bins = Histogram<T>::kBins;
+    // 8位数据用4个子直方图 16位直方图已足够分散
+    const size_t subs = sizeof(T) == 1 ? 4 : 1;
+    size_t chunks = ParallelChunkNum(0, size, kHistogramGrain);
+    std::vector<uint64_t> local;
+    try {
+        local.assign(chunks * subs * bins, 0);
+        his.counts.assign(bins, 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+
+    ParallelFor(0, size, [&](size_t b, size_t e, size_t c) {
+        uint64_t *h = &local[c * subs * bins];
+        size_t i = b;
+        if (subs == 4) {
+            uint64_t *h1 = h + bins, *h2 = h + 2 * bins, *h3 = h + 3 * bins;
+            for (; i + 4 <= e; i += 4) {
+                ++h[Histogram<T>::Bin(im[i])];
+                ++h1[Histogram<T>::Bin(im[i + 1])];
+                ++h2[Histogram<T>::Bin(im[i + 2])];
+                ++h3[Histogram<T>::Bin(im[i + 3])];
+            }
+        }
+        for (; i < e; ++i)
+            ++h[Histogram<T>::Bin(im[i])];
+    }, kHistogramGrain);
+
+    // 归约: 各线程负责一段bin
+    const size_t parts = chunks * subs;
+    ParallelFor(0, bins, [&](size_t b, size_t e, size_t) {
+        for (size_t p = 0; p < parts; ++p) {
+            const uint64_t *h = &local[p * bins];
+            for (size_t i = b; i < e; ++i)
+                his.counts[i] += h[i];
+        }
+    }, 4096);
+
+    size_t lo = 0, hi = bins - 1;
+    while (!his.counts[lo]) ++lo;
+    while (!his.counts[hi]) --hi;
+    his.min = Histogram<T>::Value(lo);
+    his.max = Histogram<T>::Value(hi);
+    his.total = size;
+    return true;
+}
+
+/**
+ * @brief 取直方图 统计量缓存有效时直接使用缓存 否则并行统计
+ * @tparam T 图像数据类型
+ * @param im 图像指针
+ * @param size 像素个数
+ * @param stats 体数据统计量缓存 可为nullptr
+ * @param his 输出的直方图
+ * @return 操作是否成功
+ */
+template<typename T>
+bool GetHistogram(const T *im, size_t size, const VolumeStats *stats, Histogram<T> &his) {
+    if (stats && stats->valid && stats->count == size &&
+        stats->histogram.size() == Histogram<T>::kBins) {
+        his.counts = stats->histogram;
+        his.min = T(stats->min);
+        his.max = T(stats->max);
+        his.total = size;
+        return true;
+    }
+    return ComputeHistogram(im, size, his);
+}
+
+/**
+ * @brief 由直方图的累积分布(CDF)计算均衡化映射表
+ * @note 映射到直方图的灰度范围[min, max]内; lut按Histogram::Bin索引 覆盖全部灰度级
+ * @tparam T 图像数据类型
+ * @param his 直方图
+ * @param lut 输出的灰度映射表
+ * @return 操作是否成功
+ */
+template<typename T>
+bool EqualizeLUT(const Histogram<T> &his, std::vector<T> &lut) {
+    if (!his.total || his.counts.size() != Histogram<T>::kBins) return false;
+    try {
+        lut.assign(Histogram<T>::kBins, 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    const size_t lo = Histogram<T>::Bin(his.min), hi = Histogram<T>::Bin(his.max);
+    const uint64_t range = hi - lo + 1;
+    const double vmax = std::numeric_limits<T>::max();
+    uint64_t count = 0;
+    for (size_t i = lo; i <= hi; ++i) {
+        count += his.counts[i];
+        double value = count * range / his.total + double(his.min) + 0.5;
+        if (value >= vmax) value = vmax;
+        lut[i] = (T) value;
+    }
+    return true;
+}
+
+/**
+ * @brief 逐灰度级计算映射表 lut[Histogram<T>::Bin(v)] = func(v) v取[lo, hi] 其余为0
+ * @tparam T 源图像数据类型
+ * @tparam U 映射后的数据类型
+ * @tparam F 可调用对象 形式为 U func(long v)
+ * @param lut 输出的映射表 大小为Histogram<T>::kBins
+ * @param func 映射函数
+ * @param lo 需要计算的最小灰度
+ * @param hi 需要计算的最大灰度
+ * @return 操作是否成功
+ */
+template<typename T, typename U, typename F>
+bool BuildLUT(std::vector<U> &lut, F func, long lo = std::numeric_limits<T>::min(),
+              long hi = std::numeric_limits<T>::max()) {
+    try {
+        lut.assign(Histogram<T>::kBins, 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    for (long v = lo; v <= hi; ++v)
+        lut[Histogram<T>::Bin(T(v))] = func(v);
+    return true;
+}
+
+/**
+ * @brief 按映射表并行变换图像 lut按Histogram::Bin索引
+ * @tparam T 源图像数据类型
+ * @tparam U 目标图像数据类型
+ * @param src 源图像指针
+ * @param dst 目标图像指针 可与src相同(原地变换)
+ * @param size 像素个数
+ * @param lut 灰度映射表 大小为Histogram<T>::kBins
+ * @param grain 每个并行分块最少的像素数
+ * @return 操作是否成功
+ */
+template<typename T, typename U>
+bool ApplyLUT(const T *src, U *dst, size_t size, const std::vector<U> &lut,
+              size_t grain = kHistogramGrain) {
+    if (!src || !dst || lut.size() != Histogram<T>::kBins) return false;
+    const U *map = lut.data();
+    ParallelFor(0, size, [&](size_t b, size_t e, size_t) {
+        size_t i = b;
+        for (; i + 4 <= e; i += 4) {
+            U v0 = map[Histogram<T>::Bin(src[i])], v1 = map[Histogram<T>::Bin(src[i + 1])];
+            U v2 = map[Histogram<T>::Bin(src[i + 2])], v3 = map[Histogram<T>::Bin(src[i + 3])];
+            dst[i] = v0;
+            dst[i + 1] = v1;
+            dst[i + 2] = v2;
+            dst[i + 3] = v3;
+        }
+        for (; i < e; ++i)
+            dst[i] = map[Histogram<T>::Bin(src[i])];
+    }, grain);
+    return true;
+}
+
+// 原地变换
+template<typename T>
+bool ApplyLUT(T *im, size_t size, const std::vector<T> &lut) {
+    return ApplyLUT(im, im, size, lut);
+}
+
+#endif //DIP_HISTOGRAM_H
@@ -4,52 +4,158 @@
 // Date:    2017/6/17 上午12:31
 // Copyright (c) 2017 Lichun Zhang. All rights reserved.
 
+#include <chrono>
+#include <vector>
 #include <mhd_reader.h>
+#include <utiles.h>
 #include "point_trans.h"
+#include "clahe.h"
+#include "window_level.h"
+#include "auto_threshold.h"
 
 
-int TestPointTrans(int index, const char *inname, const char *outname) {
-    if (!inname || !outname) return 1;
-    MHDReader *reader = new MHDReader(inname);
-    if (!reader->GetImData()) {
-        std::cout << "Read input failed!\n";
-        delete reader;
-        return -1;
-    }
+template<typename T>
+bool RunPointTrans(int index, T *im, size_t width, size_t height, size_t slice,
+                   VolumeStats *stats, clock_t &t_bg) {
     bool flag = false;
-    clock_t t_bg = clock();
     int th1 = 0, th2 = 0;
     switch (index) {
         case 0:
             std::cout << "Enter the threshold:\t";
             std::cin >> th1;
             t_bg = clock();
-            flag = ::ThresholdTrans(reader->GetImData(), reader->GetImWidth(),
-                                    reader->GetImHeight(), reader->GetImSlice(), th1);
+            flag = ::ThresholdTrans(im, width, height, slice, th1);
             break;
         case 1:
             std::cout << "Enter the low threshold and up threshold:\t";
             std::cin >> th1 >> th2;
             t_bg = clock();
-            flag = ::WindowTrans(reader->GetImData(), reader->GetImWidth(),
-                                 reader->GetImHeight(), reader->GetImSlice(), th1, th2);
+            flag = ::WindowTrans(im, width, height, slice, th1, th2);
             break;
         case 2: {
             std::cout << "Enter the x1, y1, x2, y2 (x2 > x1, y2 > y1):\t";
             int x1, y1, x2, y2;
             std::cin >> x1 >> y1 >> x2 >> y2;
             t_bg = clock();
-            flag = ::GrayStretch(reader->GetImData(), reader->GetImWidth(),
-                                 reader->GetImHeight(), reader->GetImSlice(), x1, y1, x2, y2);
+            flag = ::GrayStretch(im, width, height, slice, x1, y1, x2, y2, stats);
             break;
         }
         case 3:
-            flag = ::HisEqualize(reader->GetImData(), reader->GetImWidth(),
-                                 reader->GetImHeight(), reader->GetImSlice());
+            flag = ::HisEqualize(im, width, height, slice, stats);
+            break;
+        case 4: {
+            std::cout << "Enter the tiles in x, y and the clip limit (e.g. 8 8 2.0):\t";
+            double clip = 2.0;
+            std::cin >> th1 >> th2 >> clip;
+            t_bg = clock();
+            flag = ::CLAHE(im, width, height, slice, th1, th2, clip, stats);
             break;
+        }
+        case 5: {
+            std::cout << "Enter the window radius and the clip limit (e.g. 32 2.0):\t";
+            double clip = 2.0;
+            std::cin >> th1 >> clip;
+            t_bg = clock();
+            flag = ::CLAHESliding(im, width, height, slice, th1, clip, stats);
+            break;
+        }
+        case 7: {
+            std::cout << "Enter the method (0: Otsu, 1: triangle, 2: max entropy), "
+                      << "classes (2-4, Otsu only) and per slice (0/1):\t";
+            int method = 0, classes = 2, per_slice = 0;
+            std::cin >> method >> classes >> per_slice;
+            std::vector<long> th;
+            t_bg = clock();
+            flag = ::AutoThresholdTrans(im, width, height, slice, ThresholdMethod(method), classes,
+                                        per_slice != 0, stats, &th);
+            if (flag && !per_slice) {
+                std::cout << "Thresholds:";
+                for (long t : th) std::cout << " " << t;
+                std::cout << "\n";
+            }
+            break;
+        }
         default:
             break;
     }
+    return flag;
+}
+
+// 窗宽窗位显示: 模拟拖动窗口测量每帧延迟 再把每张切片(或以其为中心的厚层MIP)输出为8位图像
+template<typename T>
+int TestWindowLevel(const T *im, size_t width, size_t height, size_t slice,
+                    double *spacing, const char *outname) {
+    std::cout << "Enter the window center, window width and slab thickness (slices):\t";
+    double center = 0.0, ww = 0.0;
+    size_t slab = 1;
+    std::cin >> center >> ww >> slab;
+    if (!slab) slab = 1;
+    std::vector<unsigned char> out;
+    try {
+        out.resize(width * height * slice);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return -1;
+    }
+    WindowLevelRenderer<T> renderer;
+    size_t mid = slice / 2, k0 = mid >= slab / 2 ? mid - slab / 2 : 0;
+    size_t k1 = std::min(slice - 1, k0 + slab - 1);
+    const int frames = 100;
+    auto t_bg = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        renderer.SetWindow(center + i - frames / 2, ww);
+        renderer.RenderMIP(im, width, height, k0, k1, out.data());
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_bg).count();
+    std::cout << "Latency: " << ms / frames << " ms per frame (" << width << "x" << height
+              << ", slab " << k1 - k0 + 1 << ")\n";
+
+    renderer.SetWindow(center, ww);
+    for (size_t k = 0; k < slice; ++k) {
+        size_t b = k >= slab / 2 ? k - slab / 2 : 0;
+        size_t e = std::min(slice - 1, b + slab - 1);
+        renderer.RenderMIP(im, width, height, b, e, &out[k * width * height]);
+    }
+    size_t dims[3] = {width, height, slice};
+    WriteMHD(outname, out.data(), dims, spacing);
+    return 0;
+}
+
+int TestPointTrans(int index, const char *inname, const char *outname) {
+    if (!inname || !outname) return 1;
+    // 读入时统计直方图和灰度范围
+    MHDReader *reader = new MHDReader(inname, true);
+    if (!reader->GetImData()) {
+        std::cout << "Read input failed!\n";
+        delete reader;
+        return -1;
+    }
+    clock_t t_bg = clock();
+    size_t width = reader->GetImWidth(), height = reader->GetImHeight(), slice = reader->GetImSlice();
+    if (index == 6) {
+        double spacing[3] = {reader->GetSpacingX(), reader->GetSpacingY(), reader->GetSpacingZ()};
+        int ret = 0;
+        if (reader->GetDataType() == "MET_USHORT")
+            ret = TestWindowLevel(reader->GetImDataAs<unsigned short>(), width, height, slice, spacing, outname);
+        else if (reader->GetDataType() == "MET_SHORT")
+            ret = TestWindowLevel(reader->GetImDataAs<short>(), width, height, slice, spacing, outname);
+        else
+            ret = TestWindowLevel(reader->GetImData(), width, height, slice, spacing, outname);
+        delete reader;
+        return ret;
+    }
+    bool flag = false;
+    // 16位CT数据
+    if (reader->GetDataType() == "MET_USHORT")
+        flag = RunPointTrans(index, reader->GetImDataAs<unsigned short>(), width, height, slice,
+                             reader->GetStats(), t_bg);
+    else if (reader->GetDataType() == "MET_SHORT")
+        flag = RunPointTrans(index, reader->GetImDataAs<short>(), width, height, slice,
+                             reader->GetStats(), t_bg);
+    else
+        flag = RunPointTrans(index, reader->GetImData(), width, height, slice,
+                             reader->GetStats(), t_bg);
     clock_t t_ed = clock();
     if (flag) {
         std::cout << "Time: " << double(t_ed - t_bg) / 1000 << " ms\n";
@@ -71,7 +177,11 @@ int main(int argc, char *argv[]) {
               << "0: Threshold Trans\n"
               << "1: Window Trans\n"
               << "2: Gray Stretch\n"
-              << "3: Histogram Equalize\n";
+              << "3: Histogram Equalize\n"
+              << "4: CLAHE (tiles)\n"
+              << "5: CLAHE (exact sliding window)\n"
+              << "6: Window/Level display (8-bit output, optional slab MIP)\n"
+              << "7: Auto Threshold (Otsu, multi-Otsu, triangle, max entropy)\n";
     size_t index = 0;
     std::cin >> index;
     return TestPointTrans(index, argv[1], argv[2]);
@@ -8,11 +8,34 @@
 #define DIP_POINT_TRANS_H
 
 #include <cstddef>
+#include <cstring>
 #include <limits>
 #include <iostream>
+#include <vector>
 
+#include "histogram.h"
 //#include <map>
 
+/**
+ * @brief 多阈值的灰度映射表 灰度 < th[0] 映射为0, th[c-1] <= 灰度 < th[c] 映射为第c级
+ * @note 共th.size()+1级 均匀分布在[0, 最大值]内; 单阈值时为0和最大值
+ * @tparam T 图像数据类型
+ * @param th 递增的阈值
+ * @param lut 输出的映射表 按Histogram<T>::Bin索引
+ * @return 操作是否成功
+ */
+template<typename T>
+bool ThresholdLUT(const std::vector<long> &th, std::vector<T> &lut) {
+    if (th.empty()) return false;
+    const long vmax = std::numeric_limits<T>::max();
+    const long levels = long(th.size());
+    return BuildLUT<T>(lut, [&](long v) {
+        long c = 0;
+        while (c < levels && v >= th[c]) ++c;
+        return T(c * vmax / levels);
+    });
+}
+
 /**
  * @brief 阈值变换 低于阈值变为0，高于阈值均为最大值
  * @tparam T 图像数据类型
@@ -26,19 +49,9 @@
 template<typename T>
 bool ThresholdTrans(T *im, size_t width, size_t height, size_t slice, int threshold) {
     if (!im) return false;
-    T vmax = std::numeric_limits<T>::max();
-    for (size_t k = 0; k < slice; ++k) {
-        size_t p = k * width * height;
-        size_t t = 0;
-        for (size_t i = 0; i < height; ++i) {
-            for (size_t j = 0; j < width; ++j) {
-                t = p + i * width + j;
-                if (im[t] < threshold) im[t] = 0;
-                else im[t] = vmax;
-            }
-        }
-    }
-    return true;
+    std::vector<T> map;   //灰度值映射表
+    return ThresholdLUT(std::vector<long>(1, threshold), map) &&
+           ApplyLUT(im, width * height * slice, map);
 }
 
 
@@ -58,20 +71,11 @@ template<typename T>
 bool WindowTrans(T *im, size_t width, size_t height, size_t slice,
                  int lowTh, int upTh) {
     if (!im) return false;
-    size_t p0 = 0, t = 0;
-    T max_val = std::numeric_limits<T>::max();
-    for (int k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j) {
-                t = p0 + i * width + j;
-                if (im[t] < lowTh) im[t] = 0;
-                else if (im[t] > upTh) im[t] = max_val;
-
-            }
-        }
-    }
-    return true;
+    const long max_val = std::numeric_limits<T>::max();
+    std::vector<T> map;   //灰度值映射表
+    if (!BuildLUT<T>(map, [&](long v) { return T(v < lowTh ? 0 : (v > upTh ? max_val : v)); }))
+        return false;
+    return ApplyLUT(im, width * height * slice, map);
 }
 
 /**
@@ -86,106 +90,65 @@ bool WindowTrans(T *im, size_t width, size_t height, size_t slice,
  * @param y1 灰度变换图上第1个点y坐标(变换后的灰度值1)
  * @param x2 灰度变换图上第2个点x坐标(原灰度值2)
  * @param y2 灰度变换图上第2个点y坐标(变换后的灰度值2)
+ * @param stats 体数据统计量缓存 有效时只计算[min, max]内的映射表 变换后失效
  * @return 操作是否成功
  */
 template<typename T>
 bool GrayStretch(T *im, size_t width, size_t height, size_t slice,
-                 int x1, int y1, int x2, int y2) {
+                 int x1, int y1, int x2, int y2, VolumeStats *stats = nullptr) {
     if (!im) return false;
-    T *map = nullptr;   //灰度值映射表
-    T max_val = std::numeric_limits<T>::max();
-    try {
-        map = new T[max_val + 1];
-        memset(map, 0, sizeof(T) * (max_val + 1));
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to allocate memory!\n";
-        return false;
-    }
-
-    size_t p0 = 0;
-    // 分段函数第一段变换
-    for (int i = 0; i <= x1; ++i)
-        map[i] = (x1 > 0) ? (y1 * i) / x1 : 0;  //判断x1是否大于0(防止分母为0)
-
-    // 分段函数第二段变换
-    for (int i = x1 + 1; i <= x2; ++i)
-        map[i] = (x2 != x1) ? (y1 + (y2 - y1) * (i - x1) / (x2 - x1))   //防止分母为0
-                            : y1;
-    // 分段函数第三段变换
-    for (int i = x2 + 1; i < max_val; ++i)
-        map[i] = y2 + (max_val - y2) * (i - x2) / (max_val - x2);
-    map[max_val] = max_val;
+    std::vector<T> map;   //灰度值映射表 按Histogram<T>::Bin索引
+    const long min_val = std::numeric_limits<T>::min();
+    const long max_val = std::numeric_limits<T>::max();
+    auto stretch = [&](long i) {
+        long value = 0;
+        if (i <= x1)    // 分段函数第一段变换 判断x1是否大于0(防止分母为0)
+            value = (x1 > 0) ? (y1 * i) / x1 : 0;
+        else if (i <= x2)   // 分段函数第二段变换 防止分母为0
+            value = (x2 != x1) ? (y1 + (y2 - y1) * (i - x1) / (x2 - x1)) : y1;
+        else if (i < max_val)   // 分段函数第三段变换
+            value = y2 + (max_val - y2) * (i - x2) / (max_val - x2);
+        else
+            value = max_val;
+        if (value < min_val) value = min_val;
+        if (value > max_val) value = max_val;
+        return T(value);
+    };
+    // 有统计量时只计算出现的灰度范围
+    bool ok = (stats && stats->valid)
+              ? BuildLUT<T>(map, stretch, long(stats->min), long(stats->max))
+              : BuildLUT<T>(map, stretch);
+    if (!ok) return false;
 
     // 按照映射表映射
-    for (int k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j)
-                im[p0 + i * height + j] = map[im[p0 + i * height + j]];
-        }
-    }
-    delete[] map;
-    return true;
+    if (stats) stats->Invalidate();
+    return ApplyLUT(im, width * height * slice, map);
 }
 
 /**
  * @brief 直方图均衡化
+ * @note 并行统计直方图(histogram.h) 由CDF得到映射表后并行映射 支持8/16位图像
  * @tparam T 图像数据类型
  * @param im 图像指针
  * @param width  图像宽度
  * @param height 图像高度
  * @param slice  图像切片数
+ * @param stats 体数据统计量缓存 有效时直接使用其中的直方图 变换后失效
  * @return 是否操作成功
  */
 template<class T>
-bool HisEqualize(T *im, size_t width, size_t height, size_t slice) {
+bool HisEqualize(T *im, size_t width, size_t height, size_t slice, VolumeStats *stats = nullptr) {
 
     if (!im || width <= 0 || height <= 0 || slice <= 0)
         return false;
-    long size = width * height * slice;
-
-    //统计灰度级范围
-    T gray_floor = im[0], gray_roof = im[0];
-    for (long i = 1; i < size; ++i) {
-        if (im[i] < gray_floor) gray_floor = im[i];
-        else if (im[i] > gray_roof) gray_roof = im[i];
-    }
-    long range = gray_roof - gray_floor + 1;
-    long *value_count = new long[range];
-    T *value_map = new T[range];
-    auto max = std::numeric_limits<T>::max();
-    for (int i = 0; i < range; ++i) {
-        value_count[i] = 0;
-        value_map[i] = 0;
-    }
-
-    //统计各灰度级的像素个数
-    for (long i = 0; i < size; ++i)
-        ++value_count[im[i] - gray_floor];
-
-    //计算直方图均衡化的灰度映射表
-    long count = 0;
-    for (int i = 0; i < range; ++i) {
-        count += value_count[i];
-        auto value = (count * range / size + gray_floor + 0.5);
-        if (value >= max) value = max;
-        value_map[i] = (T) value;
-    }
+    size_t size = width * height * slice;
 
-    //对图像像素设值（灰度映射表）
-    for (long i = 0; i < size; ++i)
-        im[i] = value_map[im[i] - gray_floor];
-
-//    for (int i = 0; i < range; ++i) {
-//        printf("%d: %d\n", i, value_map[i]);
-//    std::cout << i << ": " << value_map[i] << std::endl;
-//    }
-
-    delete[] value_count;
-    delete[] value_map;
-
-    return true;
+    Histogram<T> his;
+    std::vector<T> value_map;
+    if (!GetHistogram(im, size, stats, his) || !EqualizeLUT(his, value_map))
+        return false;
+    if (stats) stats->Invalidate();
+    return ApplyLUT(im, size, value_map);
 }
 
 #endif //DIP_POINT_TRANS_H
@@ -0,0 +1,115 @@
+// Program: DIP
+// FileName:window_level.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午8:30
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_WINDOW_LEVEL_H
+#define DIP_WINDOW_LEVEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+#include "histogram.h"
+
+// 显示时每个并行分块最少的像素数 512*512的切片分为4块 线程启动开销远小于映射本身
+const size_t kDisplayGrain = 1 << 16;
+
+/**
+ * @brief 窗宽窗位显示 把8/16位体数据的切片或厚层最大密度投影(MIP)映射为8位显示图像
+ * @note 不修改源数据. 映射表(与WindowTrans、GrayStretch相同的BuildLUT/ApplyLUT)按窗宽窗位缓存,
+ * 拖动窗口时只在参数变化时重建一次(16位为65536项). 映射按像素分块并行.
+ * @tparam T 源图像数据类型
+ */
+template<typename T>
+class WindowLevelRenderer {
+public:
+    WindowLevelRenderer() : _center(0.0), _width(0.0) {}
+
+    /**
+     * @brief 设置窗位(窗口中心)和窗宽 参数不变时不重建映射表
+     * @note 灰度 <= center-width/2 显示为0, >= center+width/2 显示为255, 之间线性
+     * @return 操作是否成功
+     */
+    bool SetWindow(double center, double width) {
+        if (width < 1.0) width = 1.0;
+        if (!_lut.empty() && center == _center && width == _width) return true;
+        double low = center - width / 2.0;
+        bool ok = BuildLUT<T>(_lut, [&](long v) {
+            double d = (v - low) * 255.0 / width;
+            return uint8_t(d <= 0.0 ? 0 : (d >= 255.0 ? 255 : int(d + 0.5)));
+        });
+        if (!ok) {
+            _lut.clear();
+            return false;
+        }
+        _center = center;
+        _width = width;
+        return true;
+    }
+
+    double GetCenter() const { return _center; }
+
+    double GetWidth() const { return _width; }
+
+    /**
+     * @brief 显示第k张切片
+     * @param im 源图像指针
+     * @param width  图像宽度
+     * @param height 图像高度
+     * @param k 切片序号
+     * @param out 8位显示图像 width*height
+     * @return 操作是否成功
+     */
+    bool Render(const T *im, size_t width, size_t height, size_t k, uint8_t *out) const {
+        if (!im || !out || _lut.empty()) return false;
+        return ApplyLUT(im + k * width * height, out, width * height, _lut, kDisplayGrain);
+    }
+
+    /**
+     * @brief 显示切片[k0, k1]的最大密度投影
+     * @note 逐行取各切片最大值(可向量化)后查表 中间结果只占一行
+     * @param im 源图像指针
+     * @param width  图像宽度
+     * @param height 图像高度
+     * @param k0 起始切片
+     * @param k1 结束切片(含)
+     * @param out 8位显示图像 width*height
+     * @return 操作是否成功
+     */
+    bool RenderMIP(const T *im, size_t width, size_t height, size_t k0, size_t k1,
+                   uint8_t *out) const {
+        if (!im || !out || _lut.empty() || k1 < k0) return false;
+        if (k0 == k1) return Render(im, width, height, k0, out);
+        const size_t pixels = width * height;
+        const uint8_t *map = _lut.data();
+        ParallelFor(0, height, [&](size_t b, size_t e, size_t) {
+            std::vector<T> row(width);
+            for (size_t y = b; y < e; ++y) {
+                const T *src = im + k0 * pixels + y * width;
+                std::copy(src, src + width, row.begin());
+                for (size_t k = k0 + 1; k <= k1; ++k) {
+                    src += pixels;
+                    T *m = row.data();
+                    for (size_t x = 0; x < width; ++x)
+                        m[x] = src[x] > m[x] ? src[x] : m[x];
+                }
+                uint8_t *dst = out + y * width;
+                for (size_t x = 0; x < width; ++x)
+                    dst[x] = map[Histogram<T>::Bin(row[x])];
+            }
+        }, std::max<size_t>(1, kDisplayGrain / std::max<size_t>(1, width)));
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> _lut;
+    double _center, _width;
+};
+
+#endif //DIP_WINDOW_LEVEL_H
@@ -0,0 +1,287 @@
+// Program: DIP
+// FileName:canny.cpp
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午8:50
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "canny.h"
+
+// sin(22.5°) 分量不小于模长的该倍数时在该方向上偏移
+static const float kCannySin = 0.38268343f;
+
+bool CannyThresholds(const float *magnitude, size_t n, double &low, double &high) {
+    low = high = 0.0;
+    if (!magnitude || !n) return false;
+    const size_t grain = 1 << 16, chunks = ParallelChunkNum(0, n, grain);
+    std::vector<float> top(chunks, 0.0f);
+    std::vector<uint64_t> his;
+    try {
+        his.assign(chunks * kCannyBins, 0);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    ParallelFor(0, n, [&](size_t b, size_t e, size_t chunk) {
+        float m = 0.0f;
+        for (size_t i = b; i < e; ++i) m = std::max(m, magnitude[i]);
+        top[chunk] = m;
+    }, grain);
+    const float max = *std::max_element(top.begin(), top.end());
+    if (max <= 0.0f) return true;
+    const float scale = float(kCannyBins - 1) / max;
+    ParallelFor(0, n, [&](size_t b, size_t e, size_t chunk) {
+        uint64_t *h = &his[chunk * kCannyBins];
+        for (size_t i = b; i < e; ++i) ++h[size_t(magnitude[i] * scale)];
+    }, grain);
+    const uint64_t target = uint64_t(std::ceil(kCannyNonEdge * double(n)));
+    uint64_t count = 0;
+    size_t bin = 0;
+    for (; bin < kCannyBins; ++bin) {
+        for (size_t c = 0; c < chunks; ++c) count += his[c * kCannyBins + bin];
+        if (count >= target) break;
+    }
+    // 取该级的上界
+    high = double(std::min(bin + 1, kCannyBins - 1)) / scale;
+    low = kCannyLowRatio * high;
+    return true;
+}
+
+// 由模长与阈值分类 模长为0的像素不是边缘
+static inline unsigned char CannyClass(float m, double low, double high) {
+    if (m <= 0.0f || m < low) return kCannyNone;
+    return m >= high ? kCannyStrong : kCannyWeak;
+}
+
+void CannySuppress2D(const float *magnitude, const unsigned char *sector, size_t width, size_t height,
+                     double low, double high, unsigned char *cls) {
+    // 各量化方向上后一点的偏移 前一点取相反数
+    static const long dx[4] = {1, 1, 0, 1}, dy[4] = {0, 1, 1, -1};
+    const long w = long(width);
+    const long step[4] = {1, w + 1, w, 1 - w};
+    // 图像边缘的像素 邻点可能在图像外
+    auto border = [&](size_t x, size_t y) {
+        const size_t i = y * width + x;
+        const float m = magnitude[i];
+        const long ox = dx[sector[i] & 3], oy = dy[sector[i] & 3];
+        const long xa = long(x) - ox, ya = long(y) - oy, xb = long(x) + ox, yb = long(y) + oy;
+        const float a = xa >= 0 && xa < w && ya >= 0 && ya < long(height) ? magnitude[ya * w + xa] : 0.0f;
+        const float c = xb >= 0 && xb < w && yb >= 0 && yb < long(height) ? magnitude[yb * w + xb] : 0.0f;
+        cls[i] = m > a && m >= c ? CannyClass(m, low, high) : kCannyNone;
+    };
+    ParallelFor(0, height, [&](size_t b, size_t e, size_t) {
+        for (size_t y = b; y < e; ++y) {
+            if (y == 0 || y + 1 >= height || width < 3) {
+                for (size_t x = 0; x < width; ++x) border(x, y);
+                continue;
+            }
+            border(0, y);
+            // 内部像素的两个邻点都在图像内 按线性偏移读取
+            const float *m = magnitude + y * width;
+            const unsigned char *s = sector + y * width;
+            unsigned char *out = cls + y * width;
+            for (size_t x = 1; x + 1 < width; ++x) {
+                const long o = step[s[x] & 3];
+                const float v = m[x];
+                out[x] = v > m[long(x) - o] && v >= m[long(x) + o] ? CannyClass(v, low, high) : kCannyNone;
+            }
+            border(width - 1, y);
+        }
+    }, 8);
+}
+
+bool CannyGradient3D(const float *data, size_t width, size_t height, size_t slice, const double *spacing,
+                     float *magnitude, unsigned char *code) {
+    if (!data || !width || !height || !slice || !magnitude || !code) return false;
+    const size_t pixels = width * height;
+    const float sy = spacing && spacing[0] > 0.0 && spacing[1] > 0.0 ? float(spacing[0] / spacing[1]) : 1.0f;
+    const float sz = spacing && spacing[0] > 0.0 && spacing[2] > 0.0 ? float(spacing[0] / spacing[2]) : 1.0f;
+    bool ok = true;
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        // z方向平滑、差分后的平面 与一行的y方向组合
+        std::vector<float> smooth, diff, a, d, c;
+        try {
+            smooth.resize(pixels);
+            diff.resize(pixels);
+            a.resize(width);
+            d.resize(width);
+            c.resize(width);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            ok = false;
+            return;
+        }
+        for (size_t k = b; k < e; ++k) {
+            const float *prev = data + (k ? k - 1 : 0) * pixels, *cur = data + k * pixels;
+            const float *next = data + (k + 1 < slice ? k + 1 : k) * pixels;
+            for (size_t p = 0; p < pixels; ++p) {
+                smooth[p] = prev[p] + 2.0f * cur[p] + next[p];
+                diff[p] = next[p] - prev[p];
+            }
+            for (size_t y = 0; y < height; ++y) {
+                const size_t um = (y ? y - 1 : 0) * width, uc = y * width;
+                const size_t up = (y + 1 < height ? y + 1 : y) * width;
+                for (size_t x = 0; x < width; ++x) {
+                    a[x] = smooth[um + x] + 2.0f * smooth[uc + x] + smooth[up + x];
+                    d[x] = smooth[up + x] - smooth[um + x];
+                    c[x] = diff[um + x] + 2.0f * diff[uc + x] + diff[up + x];
+                }
+                const size_t o = k * pixels + uc;
+                for (size_t x = 0; x < width; ++x) {
+                    const size_t xm = x ? x - 1 : 0, xp = x + 1 < width ? x + 1 : x;
+                    const float gx = a[xp] - a[xm];
+                    const float gy = (d[xm] + 2.0f * d[x] + d[xp]) * sy;
+                    const float gz = (c[xm] + 2.0f * c[x] + c[xp]) * sz;
+                    const float m = std::sqrt(gx * gx + gy * gy + gz * gz), t = kCannySin * m;
+                    const int ox = gx > t ? 2 : (gx < -t ? 0 : 1);
+                    const int oy = gy > t ? 2 : (gy < -t ? 0 : 1);
+                    const int oz = gz > t ? 2 : (gz < -t ? 0 : 1);
+                    magnitude[o + x] = m;
+                    code[o + x] = (unsigned char) (ox + 3 * oy + 9 * oz);
+                }
+            }
+        }
+    }, 1);
+    return ok;
+}
+
+void CannySuppress3D(const float *magnitude, const unsigned char *code, size_t width, size_t height,
+                     size_t slice, double low, double high, unsigned char *cls) {
+    const long w = long(width), h = long(height), s = long(slice), pixels = w * h;
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        for (long z = long(b); z < long(e); ++z) {
+            for (long y = 0; y < h; ++y) {
+                for (long x = 0; x < w; ++x) {
+                    const long i = z * pixels + y * w + x;
+                    const float m = magnitude[i];
+                    const long ox = code[i] % 3 - 1, oy = code[i] / 3 % 3 - 1, oz = code[i] / 9 - 1;
+                    float n[2] = {0.0f, 0.0f};
+                    for (long r = 0; r < 2; ++r) {
+                        const long sign = r ? 1 : -1;
+                        const long xx = x + sign * ox, yy = y + sign * oy, zz = z + sign * oz;
+                        if (xx >= 0 && xx < w && yy >= 0 && yy < h && zz >= 0 && zz < s)
+                            n[r] = magnitude[zz * pixels + yy * w + xx];
+                    }
+                    cls[i] = m > n[0] && m >= n[1] ? CannyClass(m, low, high) : kCannyNone;
+                }
+            }
+        }
+    }, 1);
+}
+
+// 路径减半的查找 只在单线程访问的部分上调用
+static inline uint32_t CannyFind(uint32_t *parent, uint32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// 合并两个分量 下标较小的根为新根 强边缘标记随之合并
+static inline void CannyUnion(uint32_t *parent, unsigned char *strong, uint32_t a, uint32_t b) {
+    uint32_t ra = CannyFind(parent, a), rb = CannyFind(parent, b);
+    if (ra == rb) return;
+    if (ra > rb) std::swap(ra, rb);
+    parent[rb] = ra;
+    strong[ra] |= strong[rb];
+}
+
+/**
+ * @brief 把第z层第i个候选像素与之前相邻的候选像素合并
+ * @note 同层为左、左上、上、右上; prev为true时还合并第z-1层的3x3个像素.
+ * 二维图像按nx*1*ny的体数据处理, 同层只有左邻, 前一层为上一行的3个像素.
+ */
+static inline void CannyUnionPrevious(const unsigned char *cls, uint32_t *parent, unsigned char *strong,
+                                      size_t nx, size_t ny, size_t x, size_t y, size_t i, bool prev) {
+    const size_t layer = nx * ny;
+    const size_t x0 = x ? x - 1 : x, x1 = x + 1 < nx ? x + 1 : x;
+    if (x && cls[i - 1]) CannyUnion(parent, strong, uint32_t(i), uint32_t(i - 1));
+    if (y) {
+        for (size_t xx = x0; xx <= x1; ++xx) {
+            const size_t j = i - nx + xx - x;
+            if (cls[j]) CannyUnion(parent, strong, uint32_t(i), uint32_t(j));
+        }
+    }
+    if (!prev) return;
+    const size_t y0 = y ? y - 1 : y, y1 = y + 1 < ny ? y + 1 : y;
+    for (size_t yy = y0; yy <= y1; ++yy) {
+        for (size_t xx = x0; xx <= x1; ++xx) {
+            const size_t j = i - layer + (yy * nx + xx) - (y * nx + x);
+            if (cls[j]) CannyUnion(parent, strong, uint32_t(i), uint32_t(j));
+        }
+    }
+}
+
+bool CannyHysteresis(const unsigned char *cls, unsigned char *edge, size_t width, size_t height, size_t slice) {
+    if (!cls || !edge || !width || !height || !slice) return false;
+    const size_t n = width * height * slice;
+    if (n >= size_t(UINT32_MAX)) {
+        std::cout << "Image too large for hysteresis!\n";
+        return false;
+    }
+    // 二维时把每行当作一层
+    const size_t nx = width, ny = slice > 1 ? height : 1, nz = slice > 1 ? slice : height;
+    const size_t layer = nx * ny, grain = slice > 1 ? 1 : 8;
+    std::vector<uint32_t> parent;
+    std::vector<unsigned char> strong;
+    std::vector<size_t> start(ParallelChunkNum(0, nz, grain), 0);
+    try {
+        parent.resize(n);
+        strong.resize(n);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    // 块内合并 只访问本块的像素
+    ParallelFor(0, nz, [&](size_t b, size_t e, size_t chunk) {
+        start[chunk] = b;
+        for (size_t z = b; z < e; ++z) {
+            for (size_t y = 0; y < ny; ++y) {
+                for (size_t x = 0; x < nx; ++x) {
+                    const size_t i = z * layer + y * nx + x;
+                    if (!cls[i]) continue;
+                    parent[i] = uint32_t(i);
+                    strong[i] = cls[i] == kCannyStrong;
+                    CannyUnionPrevious(cls, parent.data(), strong.data(), nx, ny, x, y, i, z > b);
+                }
+            }
+        }
+    }, grain);
+    // 块交界: 每块第一层与前一层 顺序合并
+    for (size_t c = 1; c < start.size(); ++c) {
+        const size_t z = start[c];
+        if (!z) continue;
+        for (size_t y = 0; y < ny; ++y) {
+            for (size_t x = 0; x < nx; ++x) {
+                const size_t i = z * layer + y * nx + x;
+                if (!cls[i]) continue;
+                const size_t y0 = y ? y - 1 : y, y1 = y + 1 < ny ? y + 1 : y;
+                const size_t x0 = x ? x - 1 : x, x1 = x + 1 < nx ? x + 1 : x;
+                for (size_t yy = y0; yy <= y1; ++yy)
+                    for (size_t xx = x0; xx <= x1; ++xx) {
+                        const size_t j = (z - 1) * layer + yy * nx + xx;
+                        if (cls[j]) CannyUnion(parent.data(), strong.data(), uint32_t(i), uint32_t(j));
+                    }
+            }
+        }
+    }
+    // 查根输出 只读并查集
+    ParallelFor(0, n, [&](size_t b, size_t e, size_t) {
+        for (size_t i = b; i < e; ++i) {
+            if (!cls[i]) {
+                edge[i] = 0;
+                continue;
+            }
+            uint32_t r = uint32_t(i);
+            while (parent[r] != r) r = parent[r];
+            edge[i] = strong[r];
+        }
+    }, 1 << 16);
+    return true;
+}
@@ -0,0 +1,184 @@
+// Program: DIP
+// FileName:canny.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午8:50
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_CANNY_H
+#define DIP_CANNY_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+#include <recursive_gaussian.h>
+#include <gradient.h>
+
+// Canny的像素分类 非极大值抑制后
+const unsigned char kCannyNone = 0;
+const unsigned char kCannyWeak = 1;     // 不小于低阈值
+const unsigned char kCannyStrong = 2;   // 不小于高阈值
+// 自动阈值: 高阈值取梯度模长直方图的kCannyNonEdge分位数, 低阈值为高阈值的kCannyLowRatio倍
+const double kCannyNonEdge = 0.7;
+const double kCannyLowRatio = 0.4;
+const size_t kCannyBins = 1024;
+
+/**
+ * @brief 由梯度模长的直方图选取高、低阈值
+ * @note 在[0, 最大模长]上统计kCannyBins级直方图(各分块并行统计后合并), 高阈值取kCannyNonEdge分位数,
+ * 低阈值为kCannyLowRatio倍高阈值. 全为0时两个阈值都为0(Canny不把模长为0的像素当作边缘).
+ * @param magnitude 梯度模长
+ * @param n 像素数
+ * @param low 输出 低阈值
+ * @param high 输出 高阈值
+ * @return 是否操作成功
+ */
+bool CannyThresholds(const float *magnitude, size_t n, double &low, double &high);
+
+/**
+ * @brief 二维非极大值抑制与双阈值 模长不大于梯度方向上的两个邻点时抑制 行间并行
+ * @note 图像外的邻点模长按0计. 沿梯度方向 m > 前一点 且 m >= 后一点 时保留, 平台上只保留一个像素宽.
+ * @param magnitude 梯度模长 width*height
+ * @param sector 量化的梯度方向(见GradientOutput) width*height
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param low 低阈值
+ * @param high 高阈值
+ * @param cls 输出 每个像素为kCannyNone/kCannyWeak/kCannyStrong
+ */
+void CannySuppress2D(const float *magnitude, const unsigned char *sector, size_t width, size_t height,
+                     double low, double high, unsigned char *cls);
+
+/**
+ * @brief 三维Sobel梯度 输出模长与量化方向 切片间并行
+ * @note 各分量为该方向差分[-1 0 1]与另两方向[1 2 1]平滑的乘积, 边缘按复制扩展; y、z分量乘以
+ * spacing[0]/spacing[a] 换算为每x方向体素间距的灰度变化. 方向量化为26邻域中最接近的方向:
+ * 分量绝对值不小于模长的sin(22.5°)倍时该方向偏移取分量的符号, 否则为0;
+ * 编码为 (ox+1) + 3*(oy+1) + 9*(oz+1).
+ * @param data 平滑后的体数据 width*height*slice
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param spacing x、y、z方向的体素间距 为空时均为1
+ * @param magnitude 输出 梯度模长
+ * @param code 输出 量化的梯度方向
+ * @return 是否操作成功
+ */
+bool CannyGradient3D(const float *data, size_t width, size_t height, size_t slice, const double *spacing,
+                     float *magnitude, unsigned char *code);
+
+/**
+ * @brief 三维非极大值抑制与双阈值 沿CannyGradient3D的量化方向比较两个邻点 切片间并行
+ * @param magnitude 梯度模长 width*height*slice
+ * @param code 量化的梯度方向
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param low 低阈值
+ * @param high 高阈值
+ * @param cls 输出 每个体素为kCannyNone/kCannyWeak/kCannyStrong
+ */
+void CannySuppress3D(const float *magnitude, const unsigned char *code, size_t width, size_t height,
+                     size_t slice, double low, double high, unsigned char *cls);
+
+/**
+ * @brief 滞后阈值 与强边缘连通的弱边缘也是边缘 分块并行的并查集
+ * @note slice为1时为二维8邻域, 否则为三维26邻域. 沿最外层方向(二维为行, 三维为切片)分块:
+ * 各块并行地把块内相邻的候选像素合并(根为分量中下标最小的像素, 路径减半), 并把强边缘标记到块内的根;
+ * 再顺序合并相邻块交界层之间的像素对(只涉及交界的一层); 最后各块并行地查根输出.
+ * 不需要递归或栈式的区域填充, 代价与边缘形状无关. 并查集以uint32_t为下标 每像素4字节.
+ * @param cls CannySuppress2D/3D的分类结果
+ * @param edge 输出 边缘为1 其余为0
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @return 是否操作成功
+ */
+bool CannyHysteresis(const unsigned char *cls, unsigned char *edge, size_t width, size_t height, size_t slice);
+
+/**
+ * @brief Canny边缘检测 高斯平滑 + Sobel梯度 + 非极大值抑制 + 双阈值 + 滞后阈值
+ * @note 平滑用递归高斯(代价与sigma无关), 梯度由Gradient单遍计算模长与量化方向. volume为false时
+ * 逐切片二维检测, 每张切片的各步骤内部并行; 为true时三维平滑、三维梯度与26邻域连通.
+ * 阈值以梯度模长(平滑图像上未归一化的Sobel响应)计, high不大于0时由梯度模长的直方图自动选取
+ * (二维时逐切片选取, 此时low不大于0则同时取CannyThresholds的低阈值), 其余情况low不大于0或大于high时
+ * 为kCannyLowRatio倍high. 输出边缘为最大值, 其余为0.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针 原地输出
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param sigma 高斯标准差(物理单位 spacing为空时为像素) 不大于0时不平滑
+ * @param low 低阈值
+ * @param high 高阈值
+ * @param volume 是否三维检测
+ * @param spacing x、y、z方向的体素间距 可为空
+ * @return 操作是否成功
+ */
+template<typename T>
+bool Canny(T *im, size_t width, size_t height, size_t slice, double sigma = 1.0,
+           double low = 0.0, double high = 0.0, bool volume = false, const double *spacing = nullptr) {
+    if (!im || !width || !height || !slice) return false;
+    const T max = std::numeric_limits<T>::max();
+    const size_t block = volume ? width * height * slice : width * height;
+    std::vector<float> smooth, magnitude;
+    std::vector<unsigned char> code, cls, edge;
+    try {
+        smooth.resize(block);
+        magnitude.resize(block);
+        code.resize(block);
+        cls.resize(block);
+        edge.resize(block);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    const double sigmas[3] = {sigma, sigma, volume ? sigma : 0.0};
+    const int order[3] = {0, 0, 0};
+    for (size_t k = 0; k < (volume ? 1 : slice); ++k) {
+        T *src = im + k * block;
+        const size_t depth = volume ? slice : 1;
+        ParallelFor(0, block, [&](size_t b, size_t e, size_t) {
+            for (size_t i = b; i < e; ++i) smooth[i] = float(src[i]);
+        }, 1 << 16);
+        if (sigma > 0.0 && !RecursiveGaussian(smooth.data(), width, height, depth, sigmas, order, spacing))
+            return false;
+        if (volume) {
+            if (!CannyGradient3D(smooth.data(), width, height, depth, spacing, magnitude.data(), code.data()))
+                return false;
+        } else {
+            GradientOutput out;
+            out.magnitude = magnitude.data();
+            out.sector = code.data();
+            if (!Gradient((const float *) smooth.data(), width, height, 1, out, GRADIENT_SOBEL, GRADIENT_L2))
+                return false;
+        }
+        double lo = low, hi = high;
+        if (hi <= 0.0) {
+            double autoLow = 0.0;
+            if (!CannyThresholds(magnitude.data(), block, autoLow, hi)) return false;
+            if (lo <= 0.0) lo = autoLow;
+        }
+        // 低阈值无效(不大于0或大于高阈值)时取高阈值的比例
+        if (lo <= 0.0 || lo > hi) lo = kCannyLowRatio * hi;
+        if (volume) {
+            CannySuppress3D(magnitude.data(), code.data(), width, height, depth, lo, hi, cls.data());
+            // 三维时体数据较大 并查集之前释放浮点缓冲
+            std::vector<float>().swap(smooth);
+            std::vector<float>().swap(magnitude);
+        } else {
+            CannySuppress2D(magnitude.data(), code.data(), width, height, lo, hi, cls.data());
+        }
+        if (!CannyHysteresis(cls.data(), edge.data(), width, height, depth)) return false;
+        ParallelFor(0, block, [&](size_t b, size_t e, size_t) {
+            for (size_t i = b; i < e; ++i) src[i] = edge[i] ? max : T(0);
+        }, 1 << 16);
+    }
+    return true;
+}
+
+#endif //DIP_CANNY_H
@@ -9,10 +9,19 @@
 #include <iostream>
 #include <mhd_reader.h>
 #include "segmentation.h"
+#include "canny.h"
+
+// 输入负数的阈值时自动选取
+const char *kAutoHint = "-1: Otsu, -2: triangle, -3: max entropy";
+
+ThresholdMethod AutoMethod(int n) {
+    return n == -2 ? THRESHOLD_TRIANGLE : (n == -3 ? THRESHOLD_MAX_ENTROPY : THRESHOLD_OTSU);
+}
 
 bool TestSeg(const char *inname, const char *outname, size_t index) {
     if (!inname || !outname) return 1;
-    MHDReader *reader = new MHDReader(inname);
+    // 读入时统计 供RegionAdaptiveSeg等使用
+    MHDReader *reader = new MHDReader(inname, true);
     if (!reader->GetImData()) {
         std::cout << "Read input failed!\n";
         delete reader;
@@ -22,52 +31,55 @@ bool TestSeg(const char *inname, const char *outname, size_t index) {
     size_t x = 0, y = 0;
     clock_t t_bg = clock();
     int n = 0;
+    unsigned char *im = reader->GetImData();
+    size_t width = reader->GetImWidth(), height = reader->GetImHeight(), slice = reader->GetImSlice();
     switch (index) {
         case 0:
-            std::cout << "Enter the threshold: \t";
+            std::cout << "Enter the threshold (" << kAutoHint << "): \t";
             std::cin >> n;
             t_bg = clock();
 
-            flag = ::RobertsSeg(reader->GetImData(), reader->GetImWidth(),
-                                reader->GetImHeight(), reader->GetImSlice(), n);
+            flag = n < 0 ? ::RobertsSeg(im, width, height, slice, AutoMethod(n))
+                   : ::RobertsSeg(im, width, height, slice, n);
             break;
         case 1:
-            std::cout << "Enter the threshold: \t";
+            std::cout << "Enter the threshold (" << kAutoHint << "): \t";
             std::cin >> n;
             t_bg = clock();
 
-            flag = ::SobelSeg(reader->GetImData(), reader->GetImWidth(),
-                              reader->GetImHeight(), reader->GetImSlice(), n);
+            flag = n < 0 ? ::SobelSeg(im, width, height, slice, AutoMethod(n))
+                   : ::SobelSeg(im, width, height, slice, n);
             break;
         case 2:
-            std::cout << "Enter the threshold: \t";
+            std::cout << "Enter the threshold (" << kAutoHint << "): \t";
             std::cin >> n;
             t_bg = clock();
 
-            flag = ::PrewittSeg(reader->GetImData(), reader->GetImWidth(),
-                                reader->GetImHeight(), reader->GetImSlice(), n);
+            flag = n < 0 ? ::PrewittSeg(im, width, height, slice, AutoMethod(n))
+                   : ::PrewittSeg(im, width, height, slice, n);
             break;
         case 3:
-            std::cout << "Enter the threshold: \t";
+            std::cout << "Enter the threshold (" << kAutoHint << "): \t";
             std::cin >> n;
             t_bg = clock();
 
-            flag = ::LaplacianSeg(reader->GetImData(), reader->GetImWidth(),
-                                  reader->GetImHeight(), reader->GetImSlice(), n);
+            flag = n < 0 ? ::LaplacianSeg(im, width, height, slice, AutoMethod(n))
+                   : ::LaplacianSeg(im, width, height, slice, n);
             break;
         case 4:
             std::cout << "Enter the threshold:\t";
             std::cin >> n;
             t_bg = clock();
             flag = ::EdgeTrack(reader->GetImData(), reader->GetImWidth(),
-                               reader->GetImHeight(), reader->GetImSlice(), n);
+                               reader->GetImHeight(), reader->GetImSlice(), n, reader->GetStats());
             break;
         case 5:
             std::cout << "Enter the number:\t";
             std::cin >> n;
             t_bg = clock();
             flag = ::RegionAdaptiveSeg(reader->GetImData(), reader->GetImWidth(),
-                                       reader->GetImHeight(), reader->GetImSlice(), n);
+                                       reader->GetImHeight(), reader->GetImSlice(), n,
+                                       reader->GetStats());
             break;
         case 6:
             std::cout << "Enter the position:\nX: ";
@@ -81,6 +93,23 @@ bool TestSeg(const char *inname, const char *outname, size_t index) {
                                 reader->GetImHeight(), reader->GetImSlice(),
                                 x, y, n);
             break;
+        case 7: {
+            std::cout << "Enter the window radius and the offset:\t";
+            double offset = 0.0;
+            std::cin >> x >> offset;
+            t_bg = clock();
+            flag = ::AdaptiveThreshold(im, width, height, slice, x, offset, reader->GetStats());
+            break;
+        }
+        case 8: {
+            std::cout << "Enter sigma, low and high thresholds (0 for auto) and 3D (0/1):\t";
+            double sigma = 1.0, low = 0.0, high = 0.0;
+            int volume = 0;
+            std::cin >> sigma >> low >> high >> volume;
+            t_bg = clock();
+            flag = ::Canny(im, width, height, slice, sigma, low, high, volume != 0);
+            break;
+        }
         default:
             break;
     }
@@ -109,7 +138,9 @@ int main(int argc, char *argv[]) {
               << "3: Laplace Seg\n"
               << "4: Track Edge\n"
               << "5: Region Adaptive Seg\n"
-              << "6: Region Grow\n";
+              << "6: Region Grow\n"
+              << "7: Adaptive Threshold (local mean)\n"
+              << "8: Canny\n";
     size_t index = 0;
     std::cin >> index;
     return TestSeg(argv[1], argv[2], index);
@@ -11,8 +11,11 @@
 #include <cstddef>
 #include <limits>
 #include <cstring>
+#include <vector>
 #include <edgecontour_detect.h>
 #include <point_trans.h>
+#include <auto_threshold.h>
+#include <integral_image.h>
 
 /**
  * @brief 并行边界分割 Robert
@@ -31,6 +34,27 @@ bool RobertsSeg(T *im, size_t width, size_t height, size_t slice, int threshold)
     return ThresholdTrans(im, width, height, slice, threshold);
 }
 
+/**
+ * @brief 自动阈值的Robert边界分割
+ * @note Robert算子+自动阈值分割 阈值由梯度图的直方图选取
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param method 阈值选取方法
+ * @param perSlice 是否逐切片选取阈值
+ * @return 操作是否成功
+ */
+template<typename T>
+bool RobertsSeg(T *im, size_t width, size_t height, size_t slice, ThresholdMethod method,
+                bool perSlice = false) {
+    // Robert算子顺便统计梯度图的直方图 选阈值时不再遍历像素
+    VolumeStats grad;
+    if (!RobertOperator(im, width, height, slice, &grad)) return false;
+    return AutoThresholdTrans(im, width, height, slice, method, 2, perSlice, &grad);
+}
+
 /**
  * @brief 并行边界分割 Sobel
  * @note Sobel算子+阈值分割
@@ -48,6 +72,25 @@ bool SobelSeg(T *im, size_t width, size_t height, size_t slice, int threshold) {
     return ThresholdTrans(im, width, height, slice, threshold);
 }
 
+/**
+ * @brief 自动阈值的Sobel算子边界分割
+ * @note Sobel算子+自动阈值分割 阈值由梯度图的直方图选取
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param method 阈值选取方法
+ * @param perSlice 是否逐切片选取阈值
+ * @return 操作是否成功
+ */
+template<typename T>
+bool SobelSeg(T *im, size_t width, size_t height, size_t slice, ThresholdMethod method,
+              bool perSlice = false) {
+    if (!SobelOperator(im, width, height, slice)) return false;
+    return AutoThresholdTrans(im, width, height, slice, method, 2, perSlice);
+}
+
 /**
  * @brief 并行边界分割 Prewitt算子
  * @note Prewitt算子+阈值分割
@@ -65,6 +108,25 @@ bool PrewittSeg(T *im, size_t width, size_t height, size_t slice, int threshold)
     return ThresholdTrans(im, width, height, slice, threshold);
 }
 
+/**
+ * @brief 自动阈值的Prewitt算子边界分割
+ * @note Prewitt算子+自动阈值分割 阈值由梯度图的直方图选取
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param method 阈值选取方法
+ * @param perSlice 是否逐切片选取阈值
+ * @return 操作是否成功
+ */
+template<typename T>
+bool PrewittSeg(T *im, size_t width, size_t height, size_t slice, ThresholdMethod method,
+                bool perSlice = false) {
+    if (!PrewittOperator(im, width, height, slice)) return false;
+    return AutoThresholdTrans(im, width, height, slice, method, 2, perSlice);
+}
+
 /**
  * @brief 并行边界分割 Laplace算子
  * @note Laplace算子+阈值分割
@@ -82,6 +144,25 @@ bool LaplacianSeg(T *im, size_t width, size_t height, size_t slice, int threshol
     return ThresholdTrans(im, width, height, slice, threshold);
 }
 
+/**
+ * @brief 自动阈值的Laplace算子边界分割
+ * @note Laplace算子+自动阈值分割 阈值由梯度图的直方图选取
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param method 阈值选取方法
+ * @param perSlice 是否逐切片选取阈值
+ * @return 操作是否成功
+ */
+template<typename T>
+bool LaplacianSeg(T *im, size_t width, size_t height, size_t slice, ThresholdMethod method,
+                  bool perSlice = false) {
+    if (!LaplaceSharpen(im, width, height, slice)) return false;
+    return AutoThresholdTrans(im, width, height, slice, method, 2, perSlice);
+}
+
 /**
  * @brief 串行边界分割 实现边界跟踪 (起始点 搜索准则 终止条件)
  * @note 将8领域中梯度最大的点作为边界，同时作为下个搜索起始点 当梯度小于某个阈值时搜索停止
@@ -92,10 +173,12 @@ bool LaplacianSeg(T *im, size_t width, size_t height, size_t slice, int threshol
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
  * @param threshold 梯度阈值
+ * @param stats 体数据统计量缓存 分割后失效
  * @return 操作是否成功
  */
 template<typename T>
-bool EdgeTrack(T *im, size_t width, size_t height, size_t slice, int threshold) {
+bool EdgeTrack(T *im, size_t width, size_t height, size_t slice, int threshold,
+               VolumeStats *stats = nullptr) {
     if (!im) return false;
     // 为存储边界图像开辟内存空间
     T *new_im = nullptr;
@@ -113,21 +196,20 @@ bool EdgeTrack(T *im, size_t width, size_t height, size_t slice, int threshold)
     static int dircty[] = {1, 0, -1, 1, -1, 1, 0, -1};
     int p0 = 0, p1 = 0;
     int mx = 0, my = 0;  //最大梯度点所在坐标
-    // Roberts算子求梯度 此时源图数据已变为梯度数值
-    RobertOperator(im, width, height, slice);
+    // Roberts算子求梯度 此时源图数据已变为梯度数值 同时得到每张切片的最大梯度点
+    VolumeStats grad;
+    if (!RobertOperator(im, width, height, slice, &grad)) {
+        delete[] new_im;
+        return false;
+    }
     for (int k = 0; k < slice; ++k) {
         p0 = k * width * height;
         memset(new_im, 0, sizeof(T) * width * height);
-        // 求出最大梯度点和值
-        double max_grad = 0.0;
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j) {
-                if (im[p0 + i * width + j] > max_grad) {
-                    max_grad = im[p0 + i * width + j];
-                    my = i;
-                    mx = j;
-                }
-            }
+        // 最大梯度点和值
+        double max_grad = grad.sliceMax[k];
+        if (max_grad > 0.0) {
+            my = grad.sliceMaxIndex[k] / width;
+            mx = grad.sliceMaxIndex[k] % width;
         }
         int current_x = 0, current_y = 0;   //8领域中标记坐标
         int cmx = 0, cmy = 0;
@@ -161,101 +243,104 @@ bool EdgeTrack(T *im, size_t width, size_t height, size_t slice, int threshold)
     }
 
     delete[] new_im;
+    if (stats) stats->Invalidate();
     return true;
 }
 
 /**
  * @brief 并行区域分割 自适应阈值分割函数 阈值不固定。
- * @note 把图像分成若干子图像 计算每个子图像均值 将其作为阈值应用于对应子图像上
+ * @note 把图像分成count*count个子图像(最后一行/列子图像包含余下的像素) 计算每个子图像均值
+ * 将其作为阈值应用于对应子图像上. 子图像的灰度和由切片的积分图O(1)得到, 切片间并行.
  * @tparam T 源图像数据类型
  * @param im 源图像指针
  * @param width 源图像宽度(像素)
  * @param height 源图像高度(像素)
  * @param slice 源图像切片数
  * @param count 分成的子图像数量
+ * @param stats 体数据统计量缓存 用其中的切片极值跳过灰度不变的切片; count为1时子图像即整张切片,
+ * 整数数据直接用缓存中切片的精确灰度和, 不建积分图. count大于1时子图像随count变化, 不能预先缓存,
+ * 仍由积分图计算. 分割后失效
  */
 template<typename T>
-bool RegionAdaptiveSeg(T *im, size_t width, size_t height, size_t slice, int count) {
-    if (!im) return false;
-    T max = std::numeric_limits<T>::max();
-    size_t w = width / count;
-    size_t h = height / count;
-
-    long threshold = 0;
-    size_t p0 = 0, p1 = 0;
-    for (int k = 0; k < slice; ++k) {
-        p0 = k * width * height;
-        // 中心完整部分子图像阈值处理
-        for (int i = 0; i < count - 1; ++i) {
-            for (int j = 0; j < count - 1; ++j) {
-                threshold = 0;
-                p1 = (i * h) * width + j * w;   //每个子块开始地址
-
-                // 每个子图像中的平均值
-                for (int n = 0; n < h; ++n)
-                    for (int m = 0; m < w; ++m)
-                        threshold += im[p0 + p1 + n * width + m];
-                threshold /= w * h;
-//                std::cout << threshold << "\n";
-                // 根据阈值局部二值化
-                for (int n = 0; n < h; ++n) {
-                    for (int m = 0; m < w; ++m)
-                        im[p0 + p1 + n * width + m] =
-                                (im[p0 + p1 + n * width + m] > threshold) ? max : 0;
-                }
+bool RegionAdaptiveSeg(T *im, size_t width, size_t height, size_t slice, int count,
+                       VolumeStats *stats = nullptr) {
+    if (!im || count < 1) return false;
+    const T max = std::numeric_limits<T>::max();
+    const size_t n = size_t(count), pixels = width * height;
+    // 子图像边界 第n个为图像边缘
+    std::vector<size_t> bx(n + 1), by(n + 1);
+    for (size_t i = 0; i < n; ++i) {
+        bx[i] = i * (width / n);
+        by[i] = i * (height / n);
+    }
+    bx[n] = width;
+    by[n] = height;
+    // 统计量缓存中灰度不变的切片 各子图像均值等于像素值 结果全为0 不必逐块计算
+    const bool extrema = stats && stats->HasSlices(slice);
+    const bool sums = extrema && n == 1 && std::numeric_limits<T>::is_integer && stats->sliceSum.size() == slice;
+    bool ok = true;
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        IntegralImage<T> table;
+        for (size_t k = b; k < e; ++k) {
+            T *p = im + k * pixels;
+            if (extrema && stats->sliceMin[k] == stats->sliceMax[k]) {
+                memset(p, 0, sizeof(T) * pixels);
+                continue;
             }
-
-        }
-
-        // 行边缘
-        for (int i = 0; i < count - 1; ++i) {
-            threshold = 0;
-            p1 = (i * h) * width;
-            for (int n = 0; n < h; ++n)
-                for (int m = (count - 1) * w; m < width; ++m)
-                    threshold += im[p0 + p1 + n * width + m];
-            threshold /= (width - count * w + w) * h;
-//            std::cout << threshold << "\n";
-            for (int n = 0; n < h; ++n) {
-                for (int m = (count - 1) * w; m < width; ++m)
-                    im[p0 + p1 + n * width + m] =
-                            (im[p0 + p1 + n * width + m] > threshold) ? max : 0;
+            if (sums) {
+                // 与积分图相同的整数除法
+                const int64_t threshold = int64_t(stats->sliceSum[k]) / int64_t(pixels);
+                for (size_t i = 0; i < pixels; ++i)
+                    p[i] = p[i] > threshold ? max : 0;
+                continue;
             }
-        }
-
-        // 列边缘
-        for (int j = 0; j < count - 1; ++j) {
-            threshold = 0;
-            p1 = j * w;
-            for (int n = (count - 1) * h; n < height; ++n)
-                for (int m = 0; m < w; ++m)
-                    threshold += im[p0 + n * width + p1 + m];
-
-            threshold /= (height - count * h + h) * w;
-//            std::cout << threshold << "\n";
-            for (int n = (count - 1) * h; n < height; ++n) {
-                for (int m = 0; m < w; ++m)
-                    im[p0 + n * width + p1 + m] =
-                            (im[p0 + n * width + p1 + m] > threshold) ? max : 0;
+            if (!table.Build(p, width, height)) {
+                ok = false;
+                return;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    int64_t area = int64_t(bx[j + 1] - bx[j]) * int64_t(by[i + 1] - by[i]);
+                    if (!area) continue;
+                    // 每个子图像中的平均值
+                    int64_t threshold = table.Sum(bx[j], by[i], bx[j + 1], by[i + 1]) / area;
+                    // 根据阈值局部二值化
+                    for (size_t y = by[i]; y < by[i + 1]; ++y) {
+                        T *row = p + y * width;
+                        for (size_t x = bx[j]; x < bx[j + 1]; ++x)
+                            row[x] = row[x] > threshold ? max : 0;
+                    }
+                }
             }
         }
-
-        // 右下角
-        threshold = 0;
-        for (int n = (count - 1) * h; n < height; ++n)
-            for (int m = (count - 1) * w; m < width; ++m)
-                threshold += im[p0 + n * width + m];
-        threshold /= (height - count * h + h) * (width - count * w + w);
-//        std::cout << threshold << "\n";
-        for (int n = (count - 1) * h; n < height; ++n) {
-            for (int m = (count - 1) * w; m < width; ++m)
-                im[p0 + n * width + m] =
-                        (im[p0 + n * width + m] > threshold) ? max : 0;
-        }
-    }
-    return true;
+    }, 1);
+    if (stats) stats->Invalidate();
+    return ok;
 }
 
+/**
+ * @brief 局部均值自适应阈值分割 灰度大于以该像素为中心的窗口均值减去offset时为最大值 否则为0
+ * @note 窗口为(2radius+1)^2 在图像边缘处截断. 窗口均值由积分图O(1)得到 代价与窗口大小无关.
+ * @tparam T 源图像数据类型
+ * @param im 源图像指针
+ * @param width 源图像宽度(像素)
+ * @param height 源图像高度(像素)
+ * @param slice 源图像切片数
+ * @param radius 窗口半径
+ * @param offset 阈值相对窗口均值的偏移
+ * @param stats 体数据统计量缓存 分割后失效
+ * @return 操作是否成功
+ */
+template<typename T>
+bool AdaptiveThreshold(T *im, size_t width, size_t height, size_t slice, size_t radius,
+                       double offset, VolumeStats *stats = nullptr) {
+    const T max = std::numeric_limits<T>::max();
+    if (stats) stats->Invalidate();
+    return LocalBoxStats(im, width, height, slice, radius, radius, 0, false,
+                         [&](size_t i, double mean, double) {
+                             im[i] = im[i] > mean - offset ? max : 0;
+                         });
+}
 
 /**
  * @brief 串行区域分割 区域生长
@@ -0,0 +1,244 @@
+// Program: DIP
+// FileName:bilateral_filter.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午1:30
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_BILATERAL_FILTER_H
+#define DIP_BILATERAL_FILTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <parallel.h>
+#include "template_trans.h"
+
+// 双边网格在空间和灰度方向各留的空白格数 为模糊模版半径
+const size_t kBilateralPad = 2;
+
+/**
+ * @brief 双边滤波 逐像素直接计算 作为双边网格的参考实现
+ * @note 权重为 exp(-d^2/(2*sigmaS^2)) * exp(-dv^2/(2*sigmaR^2)), 窗口半径ceil(2*sigmaS),
+ * 边缘像素只用落在图像内的邻域. 灰度权重按灰度差查表. 逐切片处理, 切片内按行带并行.
+ * 每像素(4*sigmaS+1)^2次运算, 大sigmaS时应使用BilateralGrid.
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param sigmaS 空间标准差(像素)
+ * @param sigmaR 灰度标准差
+ * @return 是否操作成功
+ */
+template<class T>
+bool BilateralFilter(T *im, size_t width, size_t height, size_t slice, double sigmaS, double sigmaR) {
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 2,
+                  "BilateralFilter supports 8/16-bit integer images");
+    if (!im || !width || !height || !slice || sigmaS <= 0.0 || sigmaR <= 0.0) return false;
+    const size_t pixels = width * height;
+    const long r = long(std::ceil(2.0 * sigmaS));
+    const size_t levels = size_t(std::numeric_limits<T>::max()) - size_t(std::numeric_limits<T>::min()) + 1;
+    std::vector<float> spatial, range;
+    std::vector<T> out;
+    try {
+        spatial.resize((2 * r + 1) * (2 * r + 1));
+        range.resize(levels);
+        out.resize(pixels);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    for (long dy = -r; dy <= r; ++dy)
+        for (long dx = -r; dx <= r; ++dx)
+            spatial[(dy + r) * (2 * r + 1) + dx + r] = float(std::exp(-(dx * dx + dy * dy) / (2.0 * sigmaS * sigmaS)));
+    for (size_t d = 0; d < levels; ++d)
+        range[d] = float(std::exp(-double(d) * double(d) / (2.0 * sigmaR * sigmaR)));
+    for (size_t k = 0; k < slice; ++k) {
+        T *src = im + k * pixels;
+        ParallelFor(0, height, [&](size_t b, size_t e, size_t) {
+            for (size_t y = b; y < e; ++y) {
+                const long l0 = std::max(-r, -long(y)), l1 = std::min(r, long(height) - 1 - long(y));
+                for (size_t x = 0; x < width; ++x) {
+                    const long m0 = std::max(-r, -long(x)), m1 = std::min(r, long(width) - 1 - long(x));
+                    const long c = long(src[y * width + x]);
+                    float sum = 0.0f, wsum = 0.0f;
+                    for (long dy = l0; dy <= l1; ++dy) {
+                        const T *row = src + (y + dy) * width + x;
+                        const float *sw = &spatial[(dy + r) * (2 * r + 1) + r];
+                        for (long dx = m0; dx <= m1; ++dx) {
+                            const long v = long(row[dx]);
+                            const float wt = sw[dx] * range[std::labs(v - c)];
+                            sum += wt * float(v);
+                            wsum += wt;
+                        }
+                    }
+                    out[y * width + x] = RoundValue<T>(sum / wsum);
+                }
+            }
+        }, 8);
+        memcpy(src, out.data(), pixels * sizeof(T));
+    }
+    return true;
+}
+
+/**
+ * @brief 双边网格上沿一个方向用[1 4 6 4 1]/16模糊 每格两个分量(加权灰度和、权重和)
+ * @param grid 网格数据
+ * @param n 该方向的格数
+ * @param step 该方向相邻格的间隔(float个数)
+ * @param lines 需要模糊的线数
+ * @param line 第i条线的起点为 (i / inner) * outer + (i % inner) * 2
+ * @param inner 见line
+ * @param outer 见line
+ * @param buffer 一条线的缓冲 2*n个
+ */
+inline void BilateralGridBlur(float *grid, size_t n, size_t step, size_t lines, size_t inner, size_t outer,
+                              std::vector<float> &buffer) {
+    for (size_t i = 0; i < lines; ++i) {
+        float *p = grid + (i / inner) * outer + (i % inner) * 2;
+        for (size_t j = 0; j < n; ++j) {
+            buffer[2 * j] = p[j * step];
+            buffer[2 * j + 1] = p[j * step + 1];
+        }
+        // 两端的kBilateralPad格为空白 只更新内部
+        for (size_t j = 2; j + 2 < n; ++j) {
+            const float *q = &buffer[2 * (j - 2)];
+            p[j * step] = (q[0] + 4.0f * q[2] + 6.0f * q[4] + 4.0f * q[6] + q[8]) * (1.0f / 16);
+            p[j * step + 1] = (q[1] + 4.0f * q[3] + 6.0f * q[5] + 4.0f * q[7] + q[9]) * (1.0f / 16);
+        }
+    }
+}
+
+/**
+ * @brief 双边网格快速双边滤波 (Chen, Paris, Durand 2007) 代价与sigmaS基本无关
+ * @note 以空间sigmaS、灰度sigmaR为格距建立三维网格(x, y, 灰度), 每个像素按最近格累加
+ * (灰度, 1), 网格沿三个方向各用[1 4 6 4 1]/16模糊(相当于标准差约一格的高斯), 再在
+ * 像素位置三线性插值取加权灰度和与权重和之比. 网格约 (width/sigmaS)*(height/sigmaS)*(灰度范围/sigmaR)格,
+ * 每像素代价为一次累加和一次插值. 灰度方向按切片的最小、最大值建立. 逐切片处理,
+ * 累加按网格行、模糊按线、插值按图像行并行.
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param sigmaS 空间标准差(像素)
+ * @param sigmaR 灰度标准差
+ * @return 是否操作成功
+ */
+template<class T>
+bool BilateralGrid(T *im, size_t width, size_t height, size_t slice, double sigmaS, double sigmaR) {
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 2,
+                  "BilateralGrid supports 8/16-bit integer images");
+    if (!im || !width || !height || !slice || sigmaS <= 0.0 || sigmaR <= 0.0) return false;
+    const size_t pixels = width * height;
+    const float is = float(1.0 / sigmaS), ir = float(1.0 / sigmaR);
+    const size_t gw = size_t((width - 1) * is + 0.5f) + 1 + 2 * kBilateralPad;
+    const size_t gh = size_t((height - 1) * is + 0.5f) + 1 + 2 * kBilateralPad;
+    // 各列的最近格偏移、插值左格偏移与权重(累加和插值时不必逐像素换算坐标)
+    std::vector<size_t> col_near, col_left, val_near, val_left;
+    std::vector<float> grid, col_w, val_w;
+    try {
+        col_near.resize(width);
+        col_left.resize(width);
+        col_w.resize(width);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    for (size_t k = 0; k < slice; ++k) {
+        T *src = im + k * pixels;
+        const T lo = *std::min_element(src, src + pixels), hi = *std::max_element(src, src + pixels);
+        const size_t levels = size_t(long(hi) - long(lo)) + 1;
+        const size_t gr = size_t((levels - 1) * ir + 0.5f) + 1 + 2 * kBilateralPad;
+        // 网格(y, x, 灰度)排列 灰度方向连续 每格(加权灰度和, 权重和)
+        const size_t row = gw * gr * 2;
+        try {
+            grid.assign(gh * row, 0.0f);
+            val_near.resize(levels);
+            val_left.resize(levels);
+            val_w.resize(levels);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        for (size_t x = 0; x < width; ++x) {
+            const float fx = x * is;
+            col_near[x] = (size_t(fx + 0.5f) + kBilateralPad) * gr * 2;
+            col_left[x] = (size_t(fx) + kBilateralPad) * gr * 2;
+            col_w[x] = fx - size_t(fx);
+        }
+        // 灰度表以v-lo为下标
+        for (size_t v = 0; v < levels; ++v) {
+            const float fz = v * ir;
+            val_near[v] = (size_t(fz + 0.5f) + kBilateralPad) * 2;
+            val_left[v] = (size_t(fz) + kBilateralPad) * 2;
+            val_w[v] = fz - size_t(fz);
+        }
+        // 累加: 第gy行网格只接收 round(y/sigmaS)==gy 的图像行 各网格行互不重叠
+        ParallelFor(0, gh - 2 * kBilateralPad, [&](size_t b, size_t e, size_t) {
+            size_t y = size_t(std::max(0.0, std::floor((b - 0.5) * sigmaS) - 1.0));
+            for (; y < height && size_t(y * is + 0.5f) < e; ++y) {
+                const size_t gy = size_t(y * is + 0.5f);
+                if (gy < b) continue;
+                float *g = &grid[(gy + kBilateralPad) * row];
+                const T *p = src + y * width;
+                for (size_t x = 0; x < width; ++x) {
+                    float *c = g + col_near[x] + val_near[size_t(long(p[x]) - long(lo))];
+                    c[0] += float(p[x]);
+                    c[1] += 1.0f;
+                }
+            }
+        }, 1);
+        // 沿灰度、x、y方向模糊
+        ParallelFor(0, gh * gw, [&](size_t b, size_t e, size_t) {
+            std::vector<float> buffer(2 * gr);
+            BilateralGridBlur(&grid[b * gr * 2], gr, 2, e - b, 1, gr * 2, buffer);
+        }, 64);
+        ParallelFor(0, gh, [&](size_t b, size_t e, size_t) {
+            std::vector<float> buffer(2 * gw);
+            BilateralGridBlur(&grid[b * row], gw, gr * 2, (e - b) * gr, gr, row, buffer);
+        }, 1);
+        ParallelFor(0, gw * gr, [&](size_t b, size_t e, size_t) {
+            std::vector<float> buffer(2 * gh);
+            BilateralGridBlur(&grid[b * 2], gh, row, e - b, e - b, 0, buffer);
+        }, 64);
+        // 三线性插值取值
+        ParallelFor(0, height, [&](size_t b, size_t e, size_t) {
+            const size_t ox = gr * 2;
+            for (size_t y = b; y < e; ++y) {
+                const float fy = y * is;
+                const size_t y0 = size_t(fy);
+                const float wy = fy - y0;
+                const float *g0 = &grid[(y0 + kBilateralPad) * row], *g1 = g0 + row;
+                T *p = src + y * width;
+                for (size_t x = 0; x < width; ++x) {
+                    const size_t v = size_t(long(p[x]) - long(lo));
+                    const size_t o = col_left[x] + val_left[v];
+                    const float wx = col_w[x], wz = val_w[v];
+                    float r[2];
+                    for (size_t i = 0; i < 2; ++i) {
+                        const float a = (g0[o + i] * (1 - wz) + g0[o + 2 + i] * wz) * (1 - wx) +
+                                        (g0[o + ox + i] * (1 - wz) + g0[o + ox + 2 + i] * wz) * wx;
+                        const float c = (g1[o + i] * (1 - wz) + g1[o + 2 + i] * wz) * (1 - wx) +
+                                        (g1[o + ox + i] * (1 - wz) + g1[o + ox + 2 + i] * wz) * wx;
+                        r[i] = a * (1 - wy) + c * wy;
+                    }
+                    if (r[1] > 0.0f) p[x] = RoundValue<T>(r[0] / r[1]);
+                }
+            }
+        }, 8);
+    }
+    return true;
+}
+
+#endif //DIP_BILATERAL_FILTER_H
@@ -0,0 +1,470 @@
+// Program: DIP
+// FileName:filter3d.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午12:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_FILTER3D_H
+#define DIP_FILTER3D_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <border.h>
+#include <parallel.h>
+#include "slab_filter.h"
+#include "median_filter.h"
+#include "template_trans.h"
+
+/**
+ * @brief 物理长度换算为体素半径 四舍五入
+ * @param length 物理长度(毫米)
+ * @param spacing 体素间距(毫米) 不大于0时按1处理
+ * @return 体素半径
+ */
+inline size_t PhysicalRadius(double length, double spacing) {
+    if (spacing <= 0.0) spacing = 1.0;
+    return length > 0.0 ? size_t(length / spacing + 0.5) : 0;
+}
+
+/**
+ * @brief 可分离的三维模版项 kz[n] * ky[l] * kx[m]
+ */
+struct SeparableTerm3D {
+    std::vector<double> kx, ky, kz;
+};
+
+/**
+ * @brief 若干可分离模版项的三维滤波 各项的结果经combine合成后输出
+ * @note 各项的模版尺寸、中心相同, 所有体素按border扩展后计算.
+ * 每张扩展后的输入切片先做x、y两次一维滤波(相邻项的kx相同时共用x方向结果), 结果保存在fd张平面的
+ * 环形缓冲中, z方向窗口滑动时每张输入切片只滤波一次, 输出为环形缓冲中fd张平面沿z的加权和.
+ * 每体素每项fw+fh+fd次乘加. 与Template3D的直接计算、二维SeparableTemplate一样按double累加,
+ * 两条路径只有求和顺序不同. 切片分块并行(SlabFilter3D) 原地输出.
+ * combine(v): v为各项在该体素的结果 返回输出值(经TemplateValue取整截断).
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 模版宽度
+ * @param filterH 模版高度
+ * @param filterD 模版深度
+ * @param filterCX 模版中心元素x坐标
+ * @param filterCY 模版中心元素y坐标
+ * @param filterCZ 模版中心元素z坐标
+ * @param terms 模版项 kx、ky、kz的长度分别为filterW、filterH、filterD
+ * @param combine 各项结果的合成函数
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T, class C>
+bool SeparableFilter3D(T *im, size_t width, size_t height, size_t slice,
+                       size_t filterW, size_t filterH, size_t filterD,
+                       size_t filterCX, size_t filterCY, size_t filterCZ,
+                       const std::vector<SeparableTerm3D> &terms, C combine,
+                       BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice || terms.empty() ||
+        filterCX >= filterW || filterCY >= filterH || filterCZ >= filterD)
+        return false;
+    for (size_t t = 0; t < terms.size(); ++t)
+        if (terms[t].kx.size() != filterW || terms[t].ky.size() != filterH || terms[t].kz.size() != filterD)
+            return false;
+    const size_t pixels = width * height;
+    const size_t n = terms.size();
+    const size_t left = filterCX, right = filterW - 1 - filterCX;
+    const size_t top = filterCY, bottom = filterH - 1 - filterCY;
+    const size_t before = filterCZ, after = filterD - 1 - filterCZ;
+    const size_t pw = left + width + right, ph = top + height + bottom;
+    // 每块的工作缓冲: 各项fd张平面的环形缓冲 扩展行的x方向结果 各项一行的z方向累加 下一张应计算的切片
+    struct Work {
+        std::vector<double> planes, tmp, acc;
+        size_t next;
+    };
+    std::vector<Work> works(SlabChunkNum(slice, before, after));
+    return SlabFilter3D(im, width, height, slice, left, right, top, bottom, before, after, border, T(0),
+                        [&](size_t k, const T *const *src, T *dst, size_t chunk) {
+        Work &w = works[chunk];
+        if (w.planes.empty()) {
+            try {
+                w.planes.resize(n * filterD * pixels);
+                w.tmp.resize(ph * width);
+                w.acc.resize(n * width);
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                return false;
+            }
+            w.next = slice;
+        }
+        // 窗口第d张扩展切片的x、y滤波结果 存入环形缓冲的第(k+d)%filterD张
+        auto plane = [&](size_t d) {
+            for (size_t t = 0; t < n; ++t) {
+                const SeparableTerm3D &term = terms[t];
+                if (t == 0 || term.kx != terms[t - 1].kx) {
+                    for (size_t r = 0; r < ph; ++r) {
+                        double *out = &w.tmp[r * width];
+                        const T *row = src[d] + (long(r) - long(top)) * long(pw) - long(left);
+                        for (size_t j = 0; j < width; ++j)
+                            out[j] = 0.0;
+                        for (size_t m = 0; m < filterW; ++m) {
+                            const double c = term.kx[m];
+                            if (c == 0.0) continue;
+                            const T *p = row + m;
+                            for (size_t j = 0; j < width; ++j)
+                                out[j] += c * double(p[j]);
+                        }
+                    }
+                }
+                double *pl = &w.planes[(t * filterD + (k + d) % filterD) * pixels];
+                for (size_t y = 0; y < height; ++y) {
+                    double *out = pl + y * width;
+                    for (size_t j = 0; j < width; ++j)
+                        out[j] = 0.0;
+                    for (size_t l = 0; l < filterH; ++l) {
+                        const double c = term.ky[l];
+                        if (c == 0.0) continue;
+                        const double *p = &w.tmp[(y + l) * width];
+                        for (size_t j = 0; j < width; ++j)
+                            out[j] += c * p[j];
+                    }
+                }
+            }
+        };
+        // 块内连续的切片只需计算新进入窗口的一张
+        if (w.next != k) {
+            for (size_t d = 0; d + 1 < filterD; ++d)
+                plane(d);
+        }
+        plane(filterD - 1);
+        w.next = k + 1;
+        std::vector<double> v(n);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t t = 0; t < n; ++t) {
+                double *acc = &w.acc[t * width];
+                for (size_t j = 0; j < width; ++j)
+                    acc[j] = 0.0;
+                for (size_t d = 0; d < filterD; ++d) {
+                    const double c = terms[t].kz[d];
+                    if (c == 0.0) continue;
+                    const double *p = &w.planes[(t * filterD + (k + d) % filterD) * pixels + y * width];
+                    for (size_t j = 0; j < width; ++j)
+                        acc[j] += c * p[j];
+                }
+            }
+            T *out = dst + y * width;
+            for (size_t j = 0; j < width; ++j) {
+                for (size_t t = 0; t < n; ++t)
+                    v[t] = w.acc[t * width + j];
+                out[j] = TemplateValue<T>(combine(v.data()));
+            }
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief 三维空间滤波模版 同时使用z方向相邻切片
+ * @note 模版数组按para_array[(n * filterH + l) * filterW + m]排列(第n张第l行第m列).
+ * 可分离(秩为1)的模版自动改用SeparableFilter3D, 每体素filterW+filterH+filterD次乘加;
+ * 否则逐行累加模版各行与对应扩展行的乘积, 每体素filterW*filterH*filterD次乘加.
+ * 与Template相同, 所有体素按border扩展后计算. 切片分块并行 原地输出.
+ * 模版按体素下标给出, 不考虑体素间距; 以物理坐标给出的模版用PhysicalTemplate3D按间距采样.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 模版宽度
+ * @param filterH 模版高度
+ * @param filterD 模版深度
+ * @param filterCX 模版中心元素x坐标
+ * @param filterCY 模版中心元素y坐标
+ * @param filterCZ 模版中心元素z坐标
+ * @param para_array 模版数组 filterD*filterH*filterW个
+ * @param coeff 模版系数
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T>
+bool Template3D(T *im, size_t width, size_t height, size_t slice,
+                size_t filterW, size_t filterH, size_t filterD,
+                size_t filterCX, size_t filterCY, size_t filterCZ,
+                const double *para_array, double coeff, BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice || !para_array ||
+        filterCX >= filterW || filterCY >= filterH || filterCZ >= filterD)
+        return false;
+    // 先看作filterD行(filterW*filterH)列分离出z方向, 再分离每张的x、y方向
+    std::vector<double> kxy, kx, ky, kz;
+    if (filterW * filterH * filterD > filterW + filterH + filterD &&
+        SeparateKernel(para_array, filterW * filterH, filterD, kxy, kz) &&
+        SeparateKernel(kxy.data(), filterW, filterH, kx, ky)) {
+        std::vector<SeparableTerm3D> terms(1);
+        terms[0].kx = kx;
+        terms[0].ky = ky;
+        terms[0].kz = kz;
+        return SeparableFilter3D(im, width, height, slice, filterW, filterH, filterD,
+                                 filterCX, filterCY, filterCZ, terms,
+                                 [coeff](const double *v) { return v[0] * coeff; }, border);
+    }
+    const size_t left = filterCX, right = filterW - 1 - filterCX;
+    const size_t top = filterCY, bottom = filterH - 1 - filterCY;
+    const size_t before = filterCZ, after = filterD - 1 - filterCZ;
+    const long pw = long(left + width + right);
+    std::vector<std::vector<double> > accs(SlabChunkNum(slice, before, after));
+    return SlabFilter3D(im, width, height, slice, left, right, top, bottom, before, after, border, T(0),
+                        [&](size_t, const T *const *src, T *dst, size_t chunk) {
+        std::vector<double> &acc = accs[chunk];
+        try {
+            acc.resize(width);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t j = 0; j < width; ++j)
+                acc[j] = 0.0;
+            for (size_t d = 0; d < filterD; ++d) {
+                for (size_t l = 0; l < filterH; ++l) {
+                    const double *c = para_array + (d * filterH + l) * filterW;
+                    const T *row = src[d] + (long(y + l) - long(top)) * pw - long(left);
+                    for (size_t m = 0; m < filterW; ++m) {
+                        if (c[m] == 0.0) continue;
+                        const double cm = c[m];
+                        const T *p = row + m;
+                        for (size_t j = 0; j < width; ++j)
+                            acc[j] += cm * double(p[j]);
+                    }
+                }
+            }
+            T *out = dst + y * width;
+            for (size_t j = 0; j < width; ++j)
+                out[j] = TemplateValue<T>(acc[j] * coeff);
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief 以物理坐标给出模版函数的三维滤波 按体素间距采样模版
+ * @note 各方向的模版半径为radius/spacing四舍五入(PhysicalRadius), 第n张第l行第m列的系数为
+ * func((m-rx)*sx, (l-ry)*sy, (n-rz)*sz), 即模版中心到该体素的物理位移(毫米)处的函数值;
+ * 层厚较大时z方向的模版相应变短, 滤波结果在各方向具有相同的物理尺度. 采样后由Template3D计算,
+ * 可分离的函数(如高斯)自动按三个一维模版滤波.
+ * @tparam T 图像数据类型
+ * @tparam F 模版函数 形式为 double func(dx, dy, dz) 位移以毫米计
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param radius 模版半径(毫米)
+ * @param spacing x、y、z方向的体素间距(毫米) 为空时均为1
+ * @param func 模版函数
+ * @param normalize 是否除以采样系数之和(和为0时不除) 否则模版系数为1
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T, class F>
+bool PhysicalTemplate3D(T *im, size_t width, size_t height, size_t slice, double radius,
+                        const double *spacing, F func, bool normalize = true,
+                        BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice) return false;
+    double sp[3];
+    size_t rad[3];
+    for (size_t a = 0; a < 3; ++a) {
+        sp[a] = spacing && spacing[a] > 0.0 ? spacing[a] : 1.0;
+        rad[a] = PhysicalRadius(radius, sp[a]);
+    }
+    const size_t fw = 2 * rad[0] + 1, fh = 2 * rad[1] + 1, fd = 2 * rad[2] + 1;
+    std::vector<double> kernel;
+    try {
+        kernel.resize(fw * fh * fd);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    double sum = 0.0;
+    for (size_t n = 0; n < fd; ++n)
+        for (size_t l = 0; l < fh; ++l)
+            for (size_t m = 0; m < fw; ++m) {
+                const double v = func((double(m) - double(rad[0])) * sp[0], (double(l) - double(rad[1])) * sp[1],
+                                      (double(n) - double(rad[2])) * sp[2]);
+                kernel[(n * fh + l) * fw + m] = v;
+                sum += v;
+            }
+    const double coeff = normalize && sum != 0.0 ? 1.0 / sum : 1.0;
+    return Template3D(im, width, height, slice, fw, fh, fd, rad[0], rad[1], rad[2], kernel.data(), coeff, border);
+}
+
+/**
+ * @brief 三维滑动直方图中值 8/16位整数图像
+ * @note 每行起点建立窗口直方图, 右移时减去离开的filterH*filterD个体素、加上进入的体素;
+ * 行末逐个减去窗口内的体素复原直方图, 不必清空全部灰度级(16位图像有65536个).
+ */
+template<class T>
+bool SlidingMedian3D(T *im, size_t width, size_t height, size_t slice,
+                     size_t filterW, size_t filterH, size_t filterD,
+                     size_t filterCX, size_t filterCY, size_t filterCZ, BorderMode border, std::true_type) {
+    const size_t left = filterCX, right = filterW - 1 - filterCX;
+    const size_t top = filterCY, bottom = filterH - 1 - filterCY;
+    const size_t before = filterCZ, after = filterD - 1 - filterCZ;
+    const long pw = long(left + width + right);
+    const uint32_t n = uint32_t(filterW * filterH * filterD);
+    std::vector<MedianHistogram<T> *> hists(SlabChunkNum(slice, before, after), nullptr);
+    bool ok = SlabFilter3D(im, width, height, slice, left, right, top, bottom, before, after, border, T(0),
+                           [&](size_t, const T *const *src, T *dst, size_t chunk) {
+        MedianHistogram<T> *&his = hists[chunk];
+        if (!his) {
+            try {
+                his = new MedianHistogram<T>;
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                return false;
+            }
+        }
+        for (size_t y = 0; y < height; ++y) {
+            // 窗口第d张第l行相对于x=0时窗口左上角的偏移
+            const long corner = (long(y) - long(top)) * pw - long(left);
+            for (size_t d = 0; d < filterD; ++d)
+                for (size_t l = 0; l < filterH; ++l)
+                    for (size_t m = 0; m < filterW; ++m)
+                        his->Add(src[d][corner + long(l) * pw + long(m)]);
+            T *out = dst + y * width;
+            for (size_t x = 0; x < width; ++x) {
+                if (x) {
+                    const long leave = corner + long(x) - 1, enter = leave + long(filterW);
+                    for (size_t d = 0; d < filterD; ++d) {
+                        for (size_t l = 0; l < filterH; ++l) {
+                            his->Remove(src[d][leave + long(l) * pw]);
+                            his->Add(src[d][enter + long(l) * pw]);
+                        }
+                    }
+                }
+                if (n % 2) {
+                    out[x] = MedianHistogram<T>::Value(his->Kth(n / 2));
+                } else {
+                    size_t hi = 0, lo = his->Kth(n / 2 - 1, &hi);
+                    out[x] = T((long(MedianHistogram<T>::Value(lo)) + long(MedianHistogram<T>::Value(hi))) / 2);
+                }
+            }
+            const long last = corner + long(width) - 1;
+            for (size_t d = 0; d < filterD; ++d)
+                for (size_t l = 0; l < filterH; ++l)
+                    for (size_t m = 0; m < filterW; ++m)
+                        his->Remove(src[d][last + long(l) * pw + long(m)]);
+        }
+        return true;
+    });
+    for (size_t c = 0; c < hists.size(); ++c)
+        delete hists[c];
+    return ok;
+}
+
+/**
+ * @brief 三维中值 其它数据类型 每体素部分排序窗口内的值
+ */
+template<class T>
+bool SlidingMedian3D(T *im, size_t width, size_t height, size_t slice,
+                     size_t filterW, size_t filterH, size_t filterD,
+                     size_t filterCX, size_t filterCY, size_t filterCZ, BorderMode border, std::false_type) {
+    const size_t left = filterCX, right = filterW - 1 - filterCX;
+    const size_t top = filterCY, bottom = filterH - 1 - filterCY;
+    const size_t before = filterCZ, after = filterD - 1 - filterCZ;
+    const long pw = long(left + width + right);
+    const size_t n = filterW * filterH * filterD;
+    std::vector<std::vector<T> > windows(SlabChunkNum(slice, before, after));
+    return SlabFilter3D(im, width, height, slice, left, right, top, bottom, before, after, border, T(0),
+                        [&](size_t, const T *const *src, T *dst, size_t chunk) {
+        std::vector<T> &v = windows[chunk];
+        try {
+            v.resize(n);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                const long corner = (long(y) - long(top)) * pw + long(x) - long(left);
+                size_t i = 0;
+                for (size_t d = 0; d < filterD; ++d)
+                    for (size_t l = 0; l < filterH; ++l)
+                        for (size_t m = 0; m < filterW; ++m)
+                            v[i++] = src[d][corner + long(l) * pw + long(m)];
+                std::nth_element(v.begin(), v.begin() + n / 2, v.end());
+                T med = v[n / 2];
+                if (n % 2 == 0)
+                    med = T((*std::max_element(v.begin(), v.begin() + n / 2) + med) / 2);
+                dst[y * width + x] = med;
+            }
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief 三维中值滤波 窗口同时覆盖z方向相邻切片
+ * @note 结果为精确中值 偶数个体素时为两个中间值的平均. 居中的3*3*3窗口用排序网络(Median3x3x3),
+ * 其它窗口的8/16位整数图像用滑动直方图, 其余类型逐体素部分排序. 所有体素按border扩展后计算.
+ * 切片分块并行 原地输出.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 窗口宽度
+ * @param filterH 窗口高度
+ * @param filterD 窗口深度
+ * @param filterCX 窗口中心元素x坐标
+ * @param filterCY 窗口中心元素y坐标
+ * @param filterCZ 窗口中心元素z坐标
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T>
+bool FilterMedian3D(T *im, size_t width, size_t height, size_t slice,
+                    size_t filterW, size_t filterH, size_t filterD,
+                    size_t filterCX, size_t filterCY, size_t filterCZ, BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice ||
+        filterCX >= filterW || filterCY >= filterH || filterCZ >= filterD)
+        return false;
+    if (filterW == 3 && filterH == 3 && filterD == 3 && filterCX == 1 && filterCY == 1 && filterCZ == 1)
+        return Median3x3x3(im, width, height, slice, border);
+    return SlidingMedian3D(im, width, height, slice, filterW, filterH, filterD, filterCX, filterCY, filterCZ,
+                           border, std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) <= 2>());
+}
+
+/**
+ * @brief 以物理半径指定窗口的三维中值滤波
+ * @note 各方向的窗口半径为radius/spacing四舍五入, 层厚较大时z方向的窗口相应变小;
+ * z方向半径为0时退化为逐切片的二维中值滤波.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param radius 窗口半径(毫米)
+ * @param spacing x、y、z方向的体素间距(毫米) 为空时均为1
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T>
+bool MedianFilter3D(T *im, size_t width, size_t height, size_t slice, double radius,
+                    const double *spacing = nullptr, BorderMode border = BORDER_REPLICATE) {
+    const size_t rx = PhysicalRadius(radius, spacing ? spacing[0] : 1.0);
+    const size_t ry = PhysicalRadius(radius, spacing ? spacing[1] : 1.0);
+    const size_t rz = PhysicalRadius(radius, spacing ? spacing[2] : 1.0);
+    return FilterMedian3D(im, width, height, slice, 2 * rx + 1, 2 * ry + 1, 2 * rz + 1, rx, ry, rz, border);
+}
+
+#endif //DIP_FILTER3D_H
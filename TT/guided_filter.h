@@ -0,0 +1,146 @@
+// Program: DIP
+// FileName:guided_filter.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午4:10
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_GUIDED_FILTER_H
+#define DIP_GUIDED_FILTER_H
+
+#include <cstddef>
+#include <new>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <parallel.h>
+#include "integral_image.h"
+#include "template_trans.h"
+
+/**
+ * @brief 导向滤波的一块数据(一张切片或整个体数据) 只由LocalBoxStats的均值滤波构成
+ * @note 局部线性模型 q = a*I + b: a = cov(I, p)/(var(I) + eps), b = mean(p) - a*mean(I),
+ * 输出 q = mean(a)*I + mean(b). 自导向(guide为空)时cov(I, p) = var(I), 少两次均值滤波.
+ * 整数输出取floor(q+0.5)并截断到T的范围, 负值不置0.
+ * @param buffer 工作缓冲 3*width*height*slice个
+ * @param corr guide*im的工作缓冲 width*height*slice个 与均值同样按double累加 自导向时可为空
+ */
+template<class T, class G>
+bool GuidedFilterBlock(T *im, const G *guide, size_t width, size_t height, size_t slice,
+                       size_t r, size_t rz, double eps, float *buffer, double *corr) {
+    const size_t n = width * height * slice;
+    float *mean_i = buffer, *a = buffer + n, *b = buffer + 2 * n;
+    bool ok = true;
+    if (!guide) {
+        ok = LocalBoxStats(im, width, height, slice, r, r, rz, true, [&](size_t i, double m, double v) {
+            a[i] = float(v / (v + eps));
+            b[i] = float(m * (1.0 - a[i]));
+        });
+    } else {
+        ok = LocalBoxStats(guide, width, height, slice, r, r, rz, true, [&](size_t i, double m, double v) {
+            mean_i[i] = float(m);
+            a[i] = float(v);
+            corr[i] = double(guide[i]) * double(im[i]);
+        });
+        ok = ok && LocalBoxStats(im, width, height, slice, r, r, rz, false, [&](size_t i, double m, double) {
+            b[i] = float(m);
+        });
+        ok = ok && LocalBoxStats(corr, width, height, slice, r, r, rz, false, [&](size_t i, double m, double) {
+            const double cov = m - double(mean_i[i]) * double(b[i]);
+            a[i] = float(cov / (double(a[i]) + eps));
+            b[i] = float(double(b[i]) - double(a[i]) * double(mean_i[i]));
+        });
+    }
+    // 系数的均值 原地写回
+    ok = ok && LocalBoxStats(a, width, height, slice, r, r, rz, false, [&](size_t i, double m, double) {
+        a[i] = float(m);
+    });
+    ok = ok && LocalBoxStats(b, width, height, slice, r, r, rz, false, [&](size_t i, double m, double) {
+        b[i] = float(m);
+    });
+    if (!ok) return false;
+    // 逐切片处理时已在并行区域内 此处串行执行
+    ParallelFor(0, n, [&](size_t bg, size_t ed, size_t) {
+        for (size_t i = bg; i < ed; ++i) {
+            const double q = double(a[i]) * double(guide ? guide[i] : im[i]) + double(b[i]);
+            im[i] = RoundValue<T>(q);
+        }
+    }, 1 << 16);
+    return true;
+}
+
+/**
+ * @brief 导向滤波 (He, Sun, Tang 2010) 每像素代价与半径无关
+ * @note 全部由积分图均值滤波(LocalBoxStats, 与BoxMean共用)构成, 窗口在边缘处截断.
+ * 导向图为空时为自导向的保边平滑; 给定灰度导向图时输出沿导向图的边缘过渡, 可用于分割掩模的
+ * 边缘细化(输入为掩模, 导向为原图). rz为0时逐切片处理, 切片间并行; 否则为三维窗口,
+ * 整个体数据一起滤波(均值滤波按行、输出按体素块并行). 浮点输出不取整.
+ * @tparam T 输入(输出)图像数据类型
+ * @tparam G 导向图像数据类型
+ * @param im 输入图像 原地输出
+ * @param guide 导向图像 与im同尺寸 为空时自导向
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param r x、y方向窗口半径
+ * @param eps 正则化参数(灰度平方) 越大越平滑
+ * @param rz z方向窗口半径 0为逐切片二维
+ * @return 是否操作成功
+ */
+template<class T, class G>
+bool GuidedFilter(T *im, const G *guide, size_t width, size_t height, size_t slice,
+                  size_t r, double eps, size_t rz = 0) {
+    if (!im || !width || !height || !slice || eps <= 0.0) return false;
+    const size_t pixels = width * height;
+    if (rz) {
+        std::vector<float> buffer;
+        std::vector<double> corr;
+        try {
+            buffer.resize(3 * pixels * slice);
+            if (guide) corr.resize(pixels * slice);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        return GuidedFilterBlock(im, guide, width, height, slice, r, rz, eps, buffer.data(), corr.data());
+    }
+    bool ok = true;
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        std::vector<float> buffer;
+        std::vector<double> corr;
+        try {
+            buffer.resize(3 * pixels);
+            if (guide) corr.resize(pixels);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            ok = false;
+            return;
+        }
+        for (size_t k = b; k < e && ok; ++k)
+            if (!GuidedFilterBlock(im + k * pixels, guide ? guide + k * pixels : (const G *) nullptr,
+                                   width, height, 1, r, 0, eps, buffer.data(), corr.data()))
+                ok = false;
+    }, 1);
+    return ok;
+}
+
+/**
+ * @brief 自导向滤波 保边平滑
+ * @tparam T 图像数据类型
+ * @param im 图像指针 原地输出
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param r x、y方向窗口半径
+ * @param eps 正则化参数(灰度平方)
+ * @param rz z方向窗口半径 0为逐切片二维
+ * @return 是否操作成功
+ */
+template<class T>
+bool GuidedFilter(T *im, size_t width, size_t height, size_t slice, size_t r, double eps, size_t rz = 0) {
+    return GuidedFilter(im, (const T *) nullptr, width, height, slice, r, eps, rz);
+}
+
+#endif //DIP_GUIDED_FILTER_H
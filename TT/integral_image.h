@@ -0,0 +1,290 @@
+// Program: DIP
+// FileName:integral_image.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午10:05
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_INTEGRAL_IMAGE_H
+#define DIP_INTEGRAL_IMAGE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+
+// 积分图按列分块并行时每块最少的列数
+const size_t kIntegralGrain = 1 << 12;
+
+/**
+ * @brief 积分图(summed-area table) 任意长方体窗口的灰度和/平方和 O(1)查询
+ * @note 整数图像64位整数累加 16位数据的平方和在每切片数十亿像素内不会溢出; 浮点图像(如导向滤波
+ * 的中间系数)用double累加. 表的x、y方向在前面补一行/列0,
+ * 大小为(width+1)*(height+1)*slice; z方向第0层(全0)不存储. slice为1时即二维积分图.
+ * 构建分三步前缀和: 各行沿x(行间并行), 各列沿y(按列分块并行), 各层沿z(按平面位置分块并行).
+ * @tparam T 图像数据类型
+ * @tparam S 累加类型
+ */
+template<typename T, typename S = typename std::conditional<std::is_floating_point<T>::value,
+        double, int64_t>::type>
+class IntegralImage {
+public:
+    IntegralImage() : _width(0), _height(0), _slice(0) {}
+
+    /**
+     * @brief 构建积分图
+     * @param im 图像指针
+     * @param width  图像宽度
+     * @param height 图像高度
+     * @param slice  切片数 1为二维积分图 大于1为三维积分图
+     * @param squares 是否同时构建平方和积分图(用于局部方差)
+     * @return 操作是否成功
+     */
+    bool Build(const T *im, size_t width, size_t height, size_t slice = 1, bool squares = false) {
+        if (!im || !width || !height || !slice) return false;
+        const size_t stride = width + 1, plane = stride * (height + 1);
+        try {
+            _sum.assign(plane * slice, 0);
+            if (squares) _sq.assign(plane * slice, 0);
+            else std::vector<S>().swap(_sq);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        _width = width;
+        _height = height;
+        _slice = slice;
+
+        // 沿x的前缀和
+        ParallelFor(0, slice * height, [&](size_t b, size_t e, size_t) {
+            for (size_t r = b; r < e; ++r) {
+                size_t k = r / height, y = r % height;
+                const T *src = im + r * width;
+                S *s = &_sum[k * plane + (y + 1) * stride];
+                S acc = 0, acc2 = 0;
+                for (size_t x = 0; x < width; ++x) {
+                    acc += S(src[x]);
+                    s[x + 1] = acc;
+                }
+                if (!squares) continue;
+                S *q = &_sq[k * plane + (y + 1) * stride];
+                for (size_t x = 0; x < width; ++x) {
+                    acc2 += S(src[x]) * S(src[x]);
+                    q[x + 1] = acc2;
+                }
+            }
+        }, 16);
+        // 沿y: 每个分块负责一个切片内的一段列
+        const size_t blocks = (stride + kIntegralGrain - 1) / kIntegralGrain;
+        ParallelFor(0, slice * blocks, [&](size_t b, size_t e, size_t) {
+            for (size_t t = b; t < e; ++t) {
+                size_t k = t / blocks, x0 = t % blocks * kIntegralGrain;
+                size_t x1 = std::min(stride, x0 + kIntegralGrain);
+                AccumulateY(&_sum[k * plane], stride, height, x0, x1);
+                if (squares) AccumulateY(&_sq[k * plane], stride, height, x0, x1);
+            }
+        }, 1);
+        // 沿z: 逐层累加 层内按平面位置并行
+        if (slice > 1) {
+            ParallelFor(0, plane, [&](size_t b, size_t e, size_t) {
+                for (size_t k = 1; k < slice; ++k) {
+                    S *cur = &_sum[k * plane], *pre = cur - plane;
+                    for (size_t i = b; i < e; ++i) cur[i] += pre[i];
+                    if (!squares) continue;
+                    cur = &_sq[k * plane];
+                    pre = cur - plane;
+                    for (size_t i = b; i < e; ++i) cur[i] += pre[i];
+                }
+            }, kIntegralGrain);
+        }
+        return true;
+    }
+
+    size_t GetWidth() const { return _width; }
+
+    size_t GetHeight() const { return _height; }
+
+    size_t GetSlice() const { return _slice; }
+
+    /**
+     * @brief 窗口[x0, x1)*[y0, y1)*[z0, z1)的灰度和 调用者保证窗口在图像内
+     */
+    S Sum(size_t x0, size_t y0, size_t z0, size_t x1, size_t y1, size_t z1) const {
+        return Box(_sum, x0, y0, z0, x1, y1, z1);
+    }
+
+    // 二维积分图(slice为1)窗口[x0, x1)*[y0, y1)的灰度和
+    S Sum(size_t x0, size_t y0, size_t x1, size_t y1) const {
+        return Rect(&_sum[0], x0, y0, x1, y1);
+    }
+
+    // 窗口的平方和 需要构建时squares为true
+    S SquareSum(size_t x0, size_t y0, size_t z0, size_t x1, size_t y1, size_t z1) const {
+        return Box(_sq, x0, y0, z0, x1, y1, z1);
+    }
+
+    S SquareSum(size_t x0, size_t y0, size_t x1, size_t y1) const {
+        return Rect(&_sq[0], x0, y0, x1, y1);
+    }
+
+    /**
+     * @brief 以(x, y, z)为中心 半径(rx, ry, rz)的窗口(在图像边缘处截断)的均值和方差
+     * @param variance 非空时输出总体方差 需要构建时squares为true
+     * @return 窗口均值
+     */
+    double Mean(size_t x, size_t y, size_t z, size_t rx, size_t ry, size_t rz,
+                double *variance = nullptr) const {
+        size_t x0, y0, z0, x1, y1, z1;
+        Window(x, rx, _width, x0, x1);
+        Window(y, ry, _height, y0, y1);
+        Window(z, rz, _slice, z0, z1);
+        double n = double(x1 - x0) * (y1 - y0) * (z1 - z0);
+        double mean = Sum(x0, y0, z0, x1, y1, z1) / n;
+        if (variance) {
+            double v = SquareSum(x0, y0, z0, x1, y1, z1) / n - mean * mean;
+            *variance = v > 0.0 ? v : 0.0;
+        }
+        return mean;
+    }
+
+    // 中心pos半径r的窗口在[0, size)内截断后的范围[b, e)
+    static void Window(size_t pos, size_t r, size_t size, size_t &b, size_t &e) {
+        b = pos > r ? pos - r : 0;
+        e = std::min(size, pos + r + 1);
+    }
+
+private:
+    // 一层积分图第[x0, x1)列沿y累加 第0行为0 第1行不需要累加
+    static void AccumulateY(S *table, size_t stride, size_t rows, size_t x0, size_t x1) {
+        for (size_t y = 2; y <= rows; ++y) {
+            S *cur = table + y * stride;
+            const S *pre = cur - stride;
+            for (size_t x = x0; x < x1; ++x) cur[x] += pre[x];
+        }
+    }
+
+    // 第z层(z为0时全0)位置(x, y)的值
+    S At(const std::vector<S> &t, size_t x, size_t y, size_t z) const {
+        return z ? t[((z - 1) * (_height + 1) + y) * (_width + 1) + x] : 0;
+    }
+
+    S Rect(const S *t, size_t x0, size_t y0, size_t x1, size_t y1) const {
+        const size_t stride = _width + 1;
+        return t[y1 * stride + x1] - t[y0 * stride + x1] - t[y1 * stride + x0] + t[y0 * stride + x0];
+    }
+
+    S Box(const std::vector<S> &t, size_t x0, size_t y0, size_t z0,
+                size_t x1, size_t y1, size_t z1) const {
+        return At(t, x1, y1, z1) - At(t, x0, y1, z1) - At(t, x1, y0, z1) + At(t, x0, y0, z1)
+               - At(t, x1, y1, z0) + At(t, x0, y1, z0) + At(t, x1, y0, z0) - At(t, x0, y0, z0);
+    }
+
+    size_t _width, _height, _slice;
+    std::vector<S> _sum, _sq;
+};
+
+/**
+ * @brief 逐像素计算窗口均值(和方差)并交给func(下标, 均值, 方差)
+ * @note 输出只在读完积分图后写入 func可以原地修改im
+ */
+template<typename T, typename F>
+bool LocalBoxStats(const T *im, size_t width, size_t height, size_t slice,
+                   size_t rx, size_t ry, size_t rz, bool squares, F func) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pixels = width * height;
+    if (rz) {
+        IntegralImage<T> table;
+        if (!table.Build(im, width, height, slice, squares)) return false;
+        ParallelFor(0, slice * height, [&](size_t b, size_t e, size_t) {
+            for (size_t r = b; r < e; ++r) {
+                size_t k = r / height, y = r % height;
+                for (size_t x = 0; x < width; ++x) {
+                    double v = 0.0, m = table.Mean(x, y, k, rx, ry, rz, squares ? &v : nullptr);
+                    func(r * width + x, m, v);
+                }
+            }
+        }, 16);
+        return true;
+    }
+    bool ok = true;
+    ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+        IntegralImage<T> table;
+        for (size_t k = b; k < e; ++k) {
+            if (!table.Build(im + k * pixels, width, height, 1, squares)) {
+                ok = false;
+                return;
+            }
+            for (size_t y = 0; y < height; ++y) {
+                size_t y0, y1;
+                IntegralImage<T>::Window(y, ry, height, y0, y1);
+                for (size_t x = 0; x < width; ++x) {
+                    size_t x0, x1;
+                    IntegralImage<T>::Window(x, rx, width, x0, x1);
+                    double n = double(x1 - x0) * (y1 - y0);
+                    double m = table.Sum(x0, y0, x1, y1) / n, v = 0.0;
+                    if (squares) {
+                        v = table.SquareSum(x0, y0, x1, y1) / n - m * m;
+                        if (v < 0.0) v = 0.0;
+                    }
+                    func(k * pixels + y * width + x, m, v);
+                }
+            }
+        }
+    }, 1);
+    return ok;
+}
+
+/**
+ * @brief 均值滤波 窗口为(2rx+1)*(2ry+1)*(2rz+1) 在图像边缘处截断 每像素O(1) 与窗口大小无关
+ * @note rz为0时逐切片二维滤波, 各切片并行且各用一张切片大小的积分图; 否则构建整个体数据的
+ * 三维积分图后按行并行输出.
+ * @tparam T 图像数据类型
+ * @param im 图像指针 原地输出
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param rx x方向窗口半径
+ * @param ry y方向窗口半径
+ * @param rz z方向窗口半径
+ * @return 操作是否成功
+ */
+template<typename T>
+bool BoxMean(T *im, size_t width, size_t height, size_t slice, size_t rx, size_t ry, size_t rz = 0) {
+    return LocalBoxStats(im, width, height, slice, rx, ry, rz, false,
+                         [&](size_t i, double mean, double) {
+                             im[i] = T(std::floor(mean + 0.5));
+                         });
+}
+
+/**
+ * @brief 局部方差 窗口同BoxMean
+ * @tparam T 图像数据类型
+ * @param im 图像指针
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param rx x方向窗口半径
+ * @param ry y方向窗口半径
+ * @param rz z方向窗口半径
+ * @param variance 输出的局部方差 width*height*slice
+ * @param mean 非空时输出局部均值 width*height*slice
+ * @return 操作是否成功
+ */
+template<typename T>
+bool LocalVariance(const T *im, size_t width, size_t height, size_t slice,
+                   size_t rx, size_t ry, size_t rz, float *variance, float *mean = nullptr) {
+    if (!variance) return false;
+    return LocalBoxStats(im, width, height, slice, rx, ry, rz, true,
+                         [&](size_t i, double m, double v) {
+                             variance[i] = float(v);
+                             if (mean) mean[i] = float(m);
+                         });
+}
+
+#endif //DIP_INTEGRAL_IMAGE_H
@@ -4,7 +4,14 @@
 // Date:    2017/6/17 上午12:01
 // Copyright (c) 2017 Lichun Zhang. All rights reserved.
 
+#include <vector>
 #include "template_trans.h"
+#include "integral_image.h"
+#include "recursive_gaussian.h"
+#include "filter3d.h"
+#include "bilateral_filter.h"
+#include "nonlocal_means.h"
+#include "guided_filter.h"
 #include "../MHDIO/mhd_reader.h"
 
 
@@ -58,6 +65,114 @@ int TestTemplateTrans(int index, const char *inname, const char *outname) {
                                reader->GetImHeight(), reader->GetImSlice(), threshold);
             break;
         }
+        case 5: {
+            // 大尺寸高斯平滑 模版可分离 自动分两次一维滤波
+            size_t size = 7;
+            double sigma = 0.0;
+            std::cout << "Enter the kernel size and sigma (0: from size):\t";
+            std::cin >> size >> sigma;
+            std::vector<double> kernel;
+            GaussianKernel(size, sigma, kernel);
+            t_bg = clock();
+            flag = ::SeparableTemplate(reader->GetImData(), reader->GetImWidth(),
+                                       reader->GetImHeight(), reader->GetImSlice(),
+                                       size, size, size / 2, size / 2,
+                                       kernel.data(), kernel.data(), 1.0);
+            break;
+        }
+        case 6: {
+            // 积分图均值滤波 代价与窗口大小无关
+            size_t rx = 1, ry = 1, rz = 0;
+            std::cout << "Enter the window radius in x, y and z (0: per slice):\t";
+            std::cin >> rx >> ry >> rz;
+            t_bg = clock();
+            flag = ::BoxMean(reader->GetImData(), reader->GetImWidth(),
+                             reader->GetImHeight(), reader->GetImSlice(), rx, ry, rz);
+            break;
+        }
+        case 7: {
+            size_t radius = 3;
+            std::cout << "Enter the window radius:\t";
+            std::cin >> radius;
+            t_bg = clock();
+            flag = ::MedianFilter(reader->GetImData(), reader->GetImWidth(),
+                                  reader->GetImHeight(), reader->GetImSlice(), radius);
+            break;
+        }
+        case 8:
+            // 3*3*3排序网络中值
+            flag = ::Median3x3x3(reader->GetImData(), reader->GetImWidth(),
+                                 reader->GetImHeight(), reader->GetImSlice());
+            break;
+        case 9: {
+            // 递归高斯平滑 代价与sigma无关 sigma以毫米计
+            double sigma = 2.0;
+            std::cout << "Enter the sigma (mm):\t";
+            std::cin >> sigma;
+            double spacing[3] = {reader->GetSpacingX(), reader->GetSpacingY(), reader->GetSpacingZ()};
+            t_bg = clock();
+            flag = ::RecursiveGaussianSmooth(reader->GetImData(), reader->GetImWidth(),
+                                             reader->GetImHeight(), reader->GetImSlice(), sigma, spacing);
+            break;
+        }
+        case 10: {
+            // 三维中值 窗口半径以毫米计
+            double radius = 1.0;
+            std::cout << "Enter the window radius (mm):\t";
+            std::cin >> radius;
+            double spacing[3] = {reader->GetSpacingX(), reader->GetSpacingY(), reader->GetSpacingZ()};
+            t_bg = clock();
+            flag = ::MedianFilter3D(reader->GetImData(), reader->GetImWidth(),
+                                    reader->GetImHeight(), reader->GetImSlice(), radius, spacing);
+            break;
+        }
+        case 11: {
+            // 3*3*3均值 可分离模版 三次一维滤波
+            std::vector<double> para(27, 1.0);
+            flag = ::Template3D(reader->GetImData(), reader->GetImWidth(),
+                                reader->GetImHeight(), reader->GetImSlice(),
+                                3, 3, 3, 1, 1, 1, para.data(), 1.0 / 27);
+            break;
+        }
+        case 12: {
+            // 双边滤波 0: 逐像素直接计算 1: 双边网格
+            double sigmaS = 8.0, sigmaR = 20.0;
+            int fast = 1;
+            std::cout << "Enter the spatial sigma, range sigma and method (0: brute force, 1: grid):\t";
+            std::cin >> sigmaS >> sigmaR >> fast;
+            t_bg = clock();
+            if (fast)
+                flag = ::BilateralGrid(reader->GetImData(), reader->GetImWidth(),
+                                       reader->GetImHeight(), reader->GetImSlice(), sigmaS, sigmaR);
+            else
+                flag = ::BilateralFilter(reader->GetImData(), reader->GetImWidth(),
+                                         reader->GetImHeight(), reader->GetImSlice(), sigmaS, sigmaR);
+            break;
+        }
+        case 13: {
+            // 非局部均值 积分图计算块距离
+            double h = 10.0;
+            size_t patch = 1, search = 5;
+            int volume = 0;
+            std::cout << "Enter h, patch radius, search radius and 3D (0/1):\t";
+            std::cin >> h >> patch >> search >> volume;
+            double spacing[3] = {reader->GetSpacingX(), reader->GetSpacingY(), reader->GetSpacingZ()};
+            t_bg = clock();
+            flag = ::NonLocalMeans(reader->GetImData(), reader->GetImWidth(), reader->GetImHeight(),
+                                   reader->GetImSlice(), h, patch, search, volume != 0, spacing);
+            break;
+        }
+        case 14: {
+            // 自导向滤波 代价与半径无关
+            size_t r = 4, rz = 0;
+            double eps = 100.0;
+            std::cout << "Enter the radius, eps and z radius (0: per slice):\t";
+            std::cin >> r >> eps >> rz;
+            t_bg = clock();
+            flag = ::GuidedFilter(reader->GetImData(), reader->GetImWidth(), reader->GetImHeight(),
+                                  reader->GetImSlice(), r, eps, rz);
+            break;
+        }
         default:
             break;
     }
@@ -84,7 +199,17 @@ int main(int argc, char *argv[]) {
               << "1: Average Smooth\n"
               << "2: Gaussian Smooth\n"
               << "3: GradSharp Sharp\n"
-              << "4: LaplaceSharp Sharp\n";
+              << "4: LaplaceSharp Sharp\n"
+              << "5: Gaussian Smooth (separable, any size)\n"
+              << "6: Box Mean (integral image, any size)\n"
+              << "7: Median Smooth (sliding histogram, any radius)\n"
+              << "8: Median Smooth 3x3x3 (sorting network)\n"
+              << "9: Gaussian Smooth 3D (recursive, any sigma)\n"
+              << "10: Median Smooth 3D (radius in mm)\n"
+              << "11: Average Smooth 3x3x3\n"
+              << "12: Bilateral Smooth (brute force or bilateral grid)\n"
+              << "13: Non-local Means (integral image patch distances, 2D/3D)\n"
+              << "14: Guided Filter (self-guided, any radius)\n";
     size_t index = 0;
     std::cin >> index;
     return TestTemplateTrans(index, argv[1], argv[2]);
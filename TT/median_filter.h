@@ -0,0 +1,502 @@
+// Program: DIP
+// FileName:median_filter.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午10:50
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_MEDIAN_FILTER_H
+#define DIP_MEDIAN_FILTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <line_buffer.h>
+#include <parallel.h>
+#include "slab_filter.h"
+
+/**
+ * @brief 中值滤波用的两级滑动直方图 (Huang滑动窗口 + 粗/细两级计数)
+ * @note 细直方图覆盖类型T的全部灰度级, 粗直方图每2^kShift个灰度级一个计数
+ * (8位为16组 16位为256组). 记录当前中值所在的粗分组cm及比它小的像素数below, 以及细直方图
+ * 游标fm及比它小的像素数fbelow. 窗口滑动后中值通常只移动很少的灰度级, 查找时先移动cm, 中值仍在
+ * 游标所在的组时从fm移动, 换组时从组内靠近原游标的一端开始, 不必每次从组首扫描2^kShift个灰度级.
+ * @tparam T 图像数据类型 8/16位整数
+ */
+template<typename T>
+class MedianHistogram {
+public:
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 2,
+                  "MedianHistogram supports 8/16-bit integer images");
+    static const size_t kBins = size_t(1) << (8 * sizeof(T));
+    static const size_t kShift = sizeof(T) == 1 ? 4 : 8;
+
+    MedianHistogram() : _fine(kBins, 0), _coarse(kBins >> kShift, 0), _cm(0), _below(0), _fm(0), _fbelow(0) {}
+
+    static size_t Bin(T v) { return size_t(long(v) - long(std::numeric_limits<T>::min())); }
+
+    static T Value(size_t bin) { return T(long(bin) + long(std::numeric_limits<T>::min())); }
+
+    void Clear() {
+        std::fill(_fine.begin(), _fine.end(), 0);
+        std::fill(_coarse.begin(), _coarse.end(), 0);
+        _cm = 0;
+        _below = 0;
+        _fm = 0;
+        _fbelow = 0;
+    }
+
+    void Add(T v) {
+        size_t b = Bin(v);
+        ++_fine[b];
+        ++_coarse[b >> kShift];
+        if ((b >> kShift) < _cm) ++_below;
+        if (b < _fm) ++_fbelow;
+    }
+
+    void Remove(T v) {
+        size_t b = Bin(v);
+        --_fine[b];
+        --_coarse[b >> kShift];
+        if ((b >> kShift) < _cm) --_below;
+        if (b < _fm) --_fbelow;
+    }
+
+    /**
+     * @brief 第rank小(从0计)的灰度级
+     * @param rank 秩 小于窗口内像素数
+     * @param next 非空时输出第rank+1小的灰度级(偶数个像素取两个中间值时用)
+     */
+    size_t Kth(uint32_t rank, size_t *next = nullptr) {
+        while (_below > rank) {
+            --_cm;
+            _below -= _coarse[_cm];
+        }
+        while (_below + _coarse[_cm] <= rank) {
+            _below += _coarse[_cm];
+            ++_cm;
+        }
+        // 游标不在中值所在的组时 移到该组靠近原游标的一端
+        if ((_fm >> kShift) < _cm) {
+            _fm = _cm << kShift;
+            _fbelow = _below;
+        } else if ((_fm >> kShift) > _cm) {
+            _fm = ((_cm + 1) << kShift) - 1;
+            _fbelow = _below + _coarse[_cm] - _fine[_fm];
+        }
+        while (_fbelow > rank) {
+            --_fm;
+            _fbelow -= _fine[_fm];
+        }
+        while (_fbelow + _fine[_fm] <= rank) {
+            _fbelow += _fine[_fm];
+            ++_fm;
+        }
+        const size_t b = _fm;
+        if (next) {
+            size_t n = b;
+            if (_fbelow + _fine[b] <= rank + 1) {
+                // 先在组内找 再跳过空的粗分组
+                ++n;
+                while ((n & ((size_t(1) << kShift) - 1)) && !_fine[n]) ++n;
+                if (!(n & ((size_t(1) << kShift) - 1))) {
+                    size_t g = n >> kShift;
+                    while (!_coarse[g]) ++g;
+                    n = g << kShift;
+                    while (!_fine[n]) ++n;
+                }
+            }
+            *next = n;
+        }
+        return b;
+    }
+
+private:
+    std::vector<uint32_t> _fine, _coarse;
+    size_t _cm;         // 当前中值所在的粗分组
+    uint32_t _below;    // 粗分组cm之前的像素数
+    size_t _fm;         // 细直方图游标 为上次查找的结果
+    uint32_t _fbelow;   // 灰度级fm之前的像素数
+};
+
+/**
+ * @brief 滑动直方图中值滤波 结果为精确中值 偶数个像素时为两个中间值的平均
+ * @note 每行起点建立窗口直方图, 右移时减去离开的列、加上进入的列, 每像素O(filterH)次计数更新,
+ * 中值查找利用上一位置的结果. 行末逐个减去窗口内的像素复原直方图, 不必清空全部灰度级.
+ * 由LineBufferFilter按行原地处理, 每个分块只保存filterH个扩展行和一个直方图,
+ * 边缘像素按border扩展后同样处理.
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 滤波器宽度
+ * @param filterH 滤波器高度
+ * @param filterCX 滤波器中心元素x坐标
+ * @param filterCY 滤波器中心元素y坐标
+ * @param border 边缘扩展方式
+ * @return 是否操作成功
+ */
+template<class T>
+bool HistogramMedian(T *im, size_t width, size_t height, size_t slice,
+                     size_t filterW, size_t filterH, size_t filterCX, size_t filterCY,
+                     BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice || !filterW || !filterH ||
+        filterCX >= filterW || filterCY >= filterH)
+        return false;
+    const uint32_t n = uint32_t(filterW * filterH);
+    // 各分块的直方图 每行结束时复原为空
+    std::vector<MedianHistogram<T> > hists;
+    try {
+        hists.resize(LineBufferChunkNum(height, slice));
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferFilter(im, width, height, slice, filterCX, filterW - 1 - filterCX,
+                            filterCY, filterH - 1 - filterCY, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        // 移入局部对象(只交换缓冲指针): 计数游标不逃逸 可保持在寄存器中
+        MedianHistogram<T> h(std::move(hists[chunk]));
+        for (size_t l = 0; l < filterH; ++l)
+            for (size_t m = 0; m < filterW; ++m)
+                h.Add(rows[l][long(m) - long(filterCX)]);
+        for (size_t x = 0; x < width; ++x) {
+            if (x) {
+                const long leave = long(x) - long(filterCX) - 1, enter = leave + long(filterW);
+                for (size_t l = 0; l < filterH; ++l) {
+                    h.Remove(rows[l][leave]);
+                    h.Add(rows[l][enter]);
+                }
+            }
+            if (n % 2) {
+                dst[x] = MedianHistogram<T>::Value(h.Kth(n / 2));
+            } else {
+                size_t hi = 0, lo = h.Kth(n / 2 - 1, &hi);
+                dst[x] = T((long(MedianHistogram<T>::Value(lo)) +
+                            long(MedianHistogram<T>::Value(hi))) / 2);
+            }
+        }
+        const long last = long(width) - 1 - long(filterCX);
+        for (size_t l = 0; l < filterH; ++l)
+            for (size_t m = 0; m < filterW; ++m)
+                h.Remove(rows[l][last + long(m)]);
+        hists[chunk] = std::move(h);
+    });
+}
+
+// 比较交换 a取较小值 b取较大值 无分支
+template<class T>
+inline void SortPair(T &a, T &b) {
+    T t = std::min(a, b);
+    b = std::max(a, b);
+    a = t;
+}
+
+template<class T>
+inline T Median3(T a, T b, T c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+// 5个元素的排序网络(9次比较交换) 只用到部分输出时编译器会删去无用的min/max
+template<class T>
+inline void Sort5(T *v) {
+    SortPair(v[0], v[1]);
+    SortPair(v[3], v[4]);
+    SortPair(v[2], v[4]);
+    SortPair(v[2], v[3]);
+    SortPair(v[1], v[4]);
+    SortPair(v[0], v[3]);
+    SortPair(v[0], v[2]);
+    SortPair(v[1], v[3]);
+    SortPair(v[1], v[2]);
+}
+
+// 9个元素的排序网络(25次比较交换): 三个一组排序 按列排序 再修正
+template<class T>
+inline void Sort9(T *v) {
+    SortPair(v[0], v[1]);
+    SortPair(v[3], v[4]);
+    SortPair(v[6], v[7]);
+    SortPair(v[1], v[2]);
+    SortPair(v[4], v[5]);
+    SortPair(v[7], v[8]);
+    SortPair(v[0], v[1]);
+    SortPair(v[3], v[4]);
+    SortPair(v[6], v[7]);
+    SortPair(v[0], v[3]);
+    SortPair(v[3], v[6]);
+    SortPair(v[0], v[3]);
+    SortPair(v[1], v[4]);
+    SortPair(v[4], v[7]);
+    SortPair(v[1], v[4]);
+    SortPair(v[2], v[5]);
+    SortPair(v[5], v[8]);
+    SortPair(v[2], v[5]);
+    SortPair(v[1], v[3]);
+    SortPair(v[5], v[7]);
+    SortPair(v[2], v[6]);
+    SortPair(v[4], v[6]);
+    SortPair(v[2], v[4]);
+    SortPair(v[2], v[3]);
+    SortPair(v[5], v[6]);
+}
+
+// 把v[0, n)的最小值换到v[0] 最大值换到v[n-1]
+template<size_t n, class T>
+inline void MinMaxToEnds(T *v) {
+#pragma GCC unroll 8
+    for (size_t i = 1; i < n; ++i)
+        SortPair(v[0], v[i]);
+#pragma GCC unroll 8
+    for (size_t i = 1; i + 1 < n; ++i)
+        SortPair(v[i], v[n - 1]);
+}
+
+/**
+ * @brief 13个元素的中值 遗忘选择(forgetful selection) v会被改写
+ * @note 先取8个元素 其中的最小值和最大值都不可能是中值, 去掉后加入下一个元素, 重复直到剩3个.
+ * 每步元素个数固定, 展开后是一串无分支的min/max.
+ */
+template<class T>
+inline T Median13(T *v) {
+    MinMaxToEnds<8>(v);
+    v[7] = v[8];
+    MinMaxToEnds<7>(v + 1);
+    v[7] = v[9];
+    MinMaxToEnds<6>(v + 2);
+    v[7] = v[10];
+    MinMaxToEnds<5>(v + 3);
+    v[7] = v[11];
+    MinMaxToEnds<4>(v + 4);
+    v[7] = v[12];
+    return Median3(v[5], v[6], v[7]);
+}
+
+// 把每列的3个值(r0、r1、r2行)排序 分别写入lo、mid、hi
+template<class T>
+void SortColumns3(const T *r0, const T *r1, const T *r2, size_t width,
+                  T *__restrict lo, T *__restrict mid, T *__restrict hi) {
+    for (size_t x = 0; x < width; ++x) {
+        T a = r0[x], b = r1[x], c = r2[x];
+        SortPair(a, b);
+        SortPair(b, c);
+        SortPair(a, b);
+        lo[x] = a;
+        mid[x] = b;
+        hi[x] = c;
+    }
+}
+
+/**
+ * @brief 一行的3*3中值 dst[x]为第x、x+1、x+2列的窗口中值
+ * @note 各列已排序, 中值为 Median3(最小值的最大值, 中间值的中值, 最大值的最小值)
+ */
+template<class T>
+void MedianRow3(const T *lo, const T *mid, const T *hi, size_t width, T *dst) {
+    for (size_t x = 0; x + 2 < width; ++x) {
+        T l = std::max(std::max(lo[x], lo[x + 1]), lo[x + 2]);
+        T m = Median3(mid[x], mid[x + 1], mid[x + 2]);
+        T h = std::min(std::min(hi[x], hi[x + 1]), hi[x + 2]);
+        dst[x] = Median3(l, m, h);
+    }
+}
+
+// 把每列的5个值(rows[0] ~ rows[4]行)排序 ci为各列第i小的值
+template<class T>
+void SortColumns5(const T *const *rows, size_t width, T *__restrict c0, T *__restrict c1,
+                  T *__restrict c2, T *__restrict c3, T *__restrict c4) {
+    const T *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4];
+    for (size_t x = 0; x < width; ++x) {
+        T v[5] = {r0[x], r1[x], r2[x], r3[x], r4[x]};
+        Sort5(v);
+        c0[x] = v[0];
+        c1[x] = v[1];
+        c2[x] = v[2];
+        c3[x] = v[3];
+        c4[x] = v[4];
+    }
+}
+
+/**
+ * @brief 一行的5*5中值 dst[x]为第x~x+4列的窗口中值
+ * @note 各列已排序, 再对每行排序后矩阵按行、按列都有序, 第i行第j列的元素不小于(i+1)(j+1)-1个元素、
+ * 不大于(5-i)(5-j)-1个元素, 可能为中值(第13小)的只有13个: 第0行最大的2个, 第1行最大的3个,
+ * 第2行中间3个, 第3行最小的3个, 第4行最小的2个. 比它们都小的有6个, 中值即这13个的中值.
+ * 行排序只用到部分输出 编译器会删去无用的min/max.
+ */
+template<class T>
+void MedianRow5(const T *c0, const T *c1, const T *c2, const T *c3, const T *c4,
+                size_t width, T *dst) {
+    const T *col[5] = {c0, c1, c2, c3, c4};
+    for (size_t x = 0; x + 4 < width; ++x) {
+        T r[5][5], c[13];
+#pragma GCC unroll 5
+        for (size_t i = 0; i < 5; ++i) {
+            const T *row = col[i] + x;
+            T *v = r[i];
+            v[0] = row[0], v[1] = row[1], v[2] = row[2], v[3] = row[3], v[4] = row[4];
+            Sort5(v);
+        }
+        c[0] = r[0][3], c[1] = r[0][4];
+        c[2] = r[1][2], c[3] = r[1][3], c[4] = r[1][4];
+        c[5] = r[2][1], c[6] = r[2][2], c[7] = r[2][3];
+        c[8] = r[3][0], c[9] = r[3][1], c[10] = r[3][2];
+        c[11] = r[4][0], c[12] = r[4][1];
+        dst[x] = Median13(c);
+    }
+}
+
+/**
+ * @brief 3*3或5*5中值滤波 排序网络实现 结果与排序取中值相同
+ * @note 每行先把窗口的每一列排序(比较交换网络 无分支), 各列的排序结果被水平相邻的3或5个窗口共用.
+ * 内层循环只有连续数组上的min/max, 开启-O3时编译器将其向量化(每条指令处理多个像素).
+ * 由LineBufferFilter按行原地处理, 每个线程只保存size个扩展行, 边缘像素按border扩展后同样处理.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param size 窗口边长 3或5
+ * @param border 边缘扩展方式
+ * @return 是否操作成功
+ */
+template<class T>
+bool NetworkMedian(T *im, size_t width, size_t height, size_t slice, size_t size,
+                   BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice || (size != 3 && size != 5)) return false;
+    const size_t r = size / 2, pw = width + 2 * r;
+    std::vector<std::vector<T> > sorted(LineBufferChunkNum(height, slice));
+    try {
+        for (size_t c = 0; c < sorted.size(); ++c)
+            sorted[c].resize(size * pw);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferFilter(im, width, height, slice, r, r, r, r, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        T *col[5];
+        const T *top[5];
+        for (size_t i = 0; i < size; ++i) {
+            col[i] = &sorted[chunk][i * pw];
+            top[i] = rows[i] - r;
+        }
+        if (size == 3) {
+            SortColumns3(top[0], top[1], top[2], pw, col[0], col[1], col[2]);
+            MedianRow3<T>(col[0], col[1], col[2], pw, dst);
+        } else {
+            SortColumns5(top, pw, col[0], col[1], col[2], col[3], col[4]);
+            MedianRow5<T>(col[0], col[1], col[2], col[3], col[4], pw, dst);
+        }
+    });
+}
+
+/**
+ * @brief 以像素为中心、边长2*radius+1的正方形窗口中值滤波
+ * @note 半径1、2用排序网络 其它用滑动直方图
+ * @tparam T 图像数据类型 8/16位整数
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param radius 窗口半径
+ * @param border 边缘扩展方式
+ * @return 是否操作成功
+ */
+template<class T>
+bool MedianFilter(T *im, size_t width, size_t height, size_t slice, size_t radius,
+                  BorderMode border = BORDER_REPLICATE) {
+    if (radius == 1 || radius == 2)
+        return NetworkMedian(im, width, height, slice, 2 * radius + 1, border);
+    return HistogramMedian(im, width, height, slice, 2 * radius + 1, 2 * radius + 1, radius, radius, border);
+}
+
+/**
+ * @brief 3*3*3窗口一行的中值 dst[x]为第x~x+2列的窗口中值
+ * @note 每个体素已沿z排序3个值, 窗口内9组的最小值、中间值、最大值分别构成3行. 各行排序后3*9矩阵
+ * 按行、按列有序, 可能为中值(第14小)的只有第0行最大的4个、第1行第3~7小的5个和第2行最小的4个,
+ * 比它们都小的有7个, 中值即这13个的中值.
+ * @param r0 上一行沿z排序的结果 依次为width个最小值、中间值、最大值
+ * @param r1 当前行
+ * @param r2 下一行
+ */
+template<class T>
+void MedianRow3x3x3(const T *r0, const T *r1, const T *r2, size_t width, T *dst) {
+    const T *rows[3] = {r0, r1, r2};
+    for (size_t x = 0; x + 2 < width; ++x) {
+        T lo[9], mid[9], hi[9], c[13];
+#pragma GCC unroll 3
+        for (size_t dy = 0; dy < 3; ++dy) {
+            const T *p = rows[dy] + x;
+            lo[dy * 3] = p[0], lo[dy * 3 + 1] = p[1], lo[dy * 3 + 2] = p[2];
+            p += width;
+            mid[dy * 3] = p[0], mid[dy * 3 + 1] = p[1], mid[dy * 3 + 2] = p[2];
+            p += width;
+            hi[dy * 3] = p[0], hi[dy * 3 + 1] = p[1], hi[dy * 3 + 2] = p[2];
+        }
+        Sort9(lo);
+        Sort9(mid);
+        Sort9(hi);
+        c[0] = lo[5], c[1] = lo[6], c[2] = lo[7], c[3] = lo[8];
+        c[4] = mid[2], c[5] = mid[3], c[6] = mid[4], c[7] = mid[5], c[8] = mid[6];
+        c[9] = hi[0], c[10] = hi[1], c[11] = hi[2], c[12] = hi[3];
+        dst[x] = Median13(c);
+    }
+}
+
+/**
+ * @brief 3*3*3三维中值滤波 排序网络实现
+ * @note 每个体素先沿z排序3个值(被x、y方向相邻的窗口共用), 再由MedianRow3x3x3逐行求中值.
+ * 所有体素按border扩展后计算. 切片分块并行(SlabFilter3D), 不需要复制整个体数据.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T>
+bool Median3x3x3(T *im, size_t width, size_t height, size_t slice, BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pw = width + 2;
+    // 各块三个扩展行沿z排序的结果(最小、中间、最大) 按y循环使用
+    std::vector<std::vector<T> > zs(SlabChunkNum(slice, 1, 1));
+    return SlabFilter3D(im, width, height, slice, 1, 1, 1, 1, 1, 1, border, T(0),
+                        [&](size_t, const T *const *src, T *dst, size_t chunk) {
+        std::vector<T> &rows = zs[chunk];
+        try {
+            rows.resize(9 * pw);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            return false;
+        }
+        // 扩展后的第y行(-1 ~ height)沿z排序 写入环形缓冲的第(y+1)%3组
+        auto zsort = [&](long y) {
+            T *row = &rows[size_t(y + 1) % 3 * 3 * pw];
+            const long o = y * long(pw) - 1;
+            SortColumns3(src[0] + o, src[1] + o, src[2] + o, pw, row, row + pw, row + 2 * pw);
+        };
+        zsort(-1);
+        zsort(0);
+        for (size_t y = 0; y < height; ++y) {
+            zsort(long(y) + 1);
+            MedianRow3x3x3<T>(&rows[(y % 3) * 3 * pw], &rows[((y + 1) % 3) * 3 * pw],
+                              &rows[((y + 2) % 3) * 3 * pw], pw, dst + y * width);
+        }
+        return true;
+    });
+}
+
+#endif //DIP_MEDIAN_FILTER_H
@@ -0,0 +1,208 @@
+// Program: DIP
+// FileName:nonlocal_means.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午2:40
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_NONLOCAL_MEANS_H
+#define DIP_NONLOCAL_MEANS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+#include "template_trans.h"
+
+// 非局部均值的分块: 每块kNLMTileRows行 三维时每块kNLMTileSlices张切片
+const size_t kNLMTileRows = 32;
+const size_t kNLMTileSlices = 4;
+// 权重exp(-t)查表(线性插值) t在[0, kNLMRange)内分kNLMTable级 超出为0
+const size_t kNLMTable = 1 << 12;
+const double kNLMRange = 64.0;
+
+/**
+ * @brief 非局部均值去噪 以积分图计算块距离 (Darbon et al. 2008)
+ * @note 对搜索窗口内的每个偏移d, 先求差值平方图 D(x) = (u(x) - u(x+d))^2 的积分图,
+ * 每个体素的块距离为积分图上一次长方体窗口查询, 与块大小无关; 权重 exp(-距离/h^2),
+ * 体素自身取所有偏移中的最大权重. 每体素代价O(搜索窗口体素数), 而直接计算为O(搜索*块).
+ * 图像按边缘复制扩展, 所有体素都处理. 体数据按(切片块, 行带)分块并行, 每块对所有偏移
+ * 在块及其块半径的扩展范围上建立积分图(小于缓存), 累加权重与加权和后输出.
+ * volume为true时块和搜索窗口为三维; spacing非空时z方向半径按spacing[0]/spacing[2]缩放,
+ * 使窗口的物理尺寸在各方向相近.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param h 滤波强度(灰度) 越大越平滑 约为噪声标准差
+ * @param patch 块半径
+ * @param search 搜索窗口半径
+ * @param volume 是否为三维块和搜索窗口 否则逐切片处理
+ * @param spacing x、y、z方向的体素间距 可为空
+ * @return 是否操作成功
+ */
+template<class T>
+bool NonLocalMeans(T *im, size_t width, size_t height, size_t slice, double h,
+                   size_t patch = 1, size_t search = 5, bool volume = false, const double *spacing = nullptr) {
+    if (!im || !width || !height || !slice || h <= 0.0) return false;
+    const long rpx = long(patch), rsx = long(search);
+    long rpz = 0, rsz = 0;
+    if (volume && slice > 1) {
+        const double scale = spacing && spacing[0] > 0.0 && spacing[2] > 0.0 ? spacing[0] / spacing[2] : 1.0;
+        rpz = long(patch * scale + 0.5);
+        rsz = long(search * scale + 0.5);
+    }
+    // 边缘复制扩展后的体数据
+    const long rx = rsx + rpx, rz = rsz + rpz;
+    const size_t pw = width + 2 * rx, ph = height + 2 * rx, pd = slice + 2 * rz;
+    const size_t pplane = pw * ph;
+    std::vector<T> pad;
+    std::vector<float> table;
+    try {
+        pad.resize(pplane * pd);
+        table.resize(kNLMTable + 1);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    ParallelFor(0, pd, [&](size_t b, size_t e, size_t) {
+        for (size_t pz = b; pz < e; ++pz) {
+            const long z = std::min(std::max(long(pz) - rz, 0L), long(slice) - 1);
+            for (size_t py = 0; py < ph; ++py) {
+                const long y = std::min(std::max(long(py) - rx, 0L), long(height) - 1);
+                const T *src = im + (z * height + y) * width;
+                T *dst = &pad[pz * pplane + py * pw];
+                for (long x = 0; x < rx; ++x)
+                    dst[x] = src[0], dst[pw - 1 - x] = src[width - 1];
+                memcpy(dst + rx, src, width * sizeof(T));
+            }
+        }
+    }, 1);
+    for (size_t i = 0; i <= kNLMTable; ++i)
+        table[i] = float(std::exp(-kNLMRange * i / kNLMTable));
+    table[kNLMTable] = 0.0f;
+    const double tscale = kNLMTable / (kNLMRange * h * h *
+                                       double((2 * rpx + 1) * (2 * rpx + 1) * (2 * rpz + 1)));
+
+    const size_t tile_d = rpz ? kNLMTileSlices : 1;
+    const size_t bands = (height + kNLMTileRows - 1) / kNLMTileRows;
+    const size_t slabs = (slice + tile_d - 1) / tile_d;
+    // 扩展范围内的积分图 前面补一层/行/列0
+    const size_t ex = width + 2 * rpx, ey = kNLMTileRows + 2 * rpx, ez = tile_d + 2 * rpz;
+    const size_t istride = ex + 1, iplane = istride * (ey + 1);
+    std::vector<T> out;
+    try {
+        out.resize(width * height * slice);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    bool ok = true;
+    ParallelFor(0, bands * slabs, [&](size_t b, size_t e, size_t) {
+        std::vector<double> integral;
+        std::vector<float> wsum, vsum, wmax;
+        try {
+            integral.assign(iplane * (ez + 1), 0.0);
+            wsum.resize(width * kNLMTileRows * tile_d);
+            vsum.resize(wsum.size());
+            wmax.resize(wsum.size());
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            ok = false;
+            return;
+        }
+        for (size_t tile = b; tile < e; ++tile) {
+            const size_t z0 = (tile / bands) * tile_d, z1 = std::min(z0 + tile_d, slice);
+            const size_t y0 = (tile % bands) * kNLMTileRows, y1 = std::min(y0 + kNLMTileRows, height);
+            const size_t tz = z1 - z0, ty = y1 - y0, tplane = width * ty;
+            std::fill(wsum.begin(), wsum.end(), 0.0f);
+            std::fill(vsum.begin(), vsum.end(), 0.0f);
+            std::fill(wmax.begin(), wmax.end(), 0.0f);
+            for (long dz = -rsz; dz <= rsz; ++dz) {
+                for (long dy = -rsx; dy <= rsx; ++dy) {
+                    for (long dx = -rsx; dx <= rsx; ++dx) {
+                        if (!dx && !dy && !dz) continue;
+                        // 差值平方的积分图 覆盖块内体素的块半径扩展范围
+                        const size_t nz = tz + 2 * rpz, ny = ty + 2 * rpx;
+                        for (size_t k = 0; k < nz; ++k) {
+                            double *cur = &integral[(k + 1) * iplane], *prev = cur - iplane;
+                            const T *row = &pad[(z0 + k + rz - rpz) * pplane + (y0 + rx - rpx) * pw + rx - rpx];
+                            const T *nb = row + (dz * long(ph) + dy) * long(pw) + dx;
+                            for (size_t r = 0; r < ny; ++r) {
+                                double *ic = cur + (r + 1) * istride + 1, *iu = ic - istride;
+                                const double *pc = prev + (r + 1) * istride + 1, *pu = pc - istride;
+                                const T *p = row + r * pw, *q = nb + r * pw;
+                                double acc = 0.0;
+                                if (rpz) {
+                                    for (size_t c = 0; c < ex; ++c) {
+                                        const double diff = double(p[c]) - double(q[c]);
+                                        acc += diff * diff;
+                                        ic[c] = acc + iu[c] + pc[c] - pu[c];
+                                    }
+                                } else {
+                                    // 二维时前一层全为0
+                                    for (size_t c = 0; c < ex; ++c) {
+                                        const double diff = double(p[c]) - double(q[c]);
+                                        acc += diff * diff;
+                                        ic[c] = acc + iu[c];
+                                    }
+                                }
+                            }
+                        }
+                        // 各体素的块距离 -> 权重
+                        const size_t bx = 2 * rpx + 1, by = (2 * rpx + 1) * istride, bz = (2 * rpz + 1) * iplane;
+                        for (size_t k = 0; k < tz; ++k) {
+                            const T *nbs = &pad[(z0 + k + rz + dz) * pplane + (y0 + rx + dy) * pw + rx + dx];
+                            for (size_t r = 0; r < ty; ++r) {
+                                const double *i0 = &integral[k * iplane + r * istride];
+                                const T *q = nbs + r * pw;
+                                const size_t o = k * tplane + r * width;
+                                float *ws = &wsum[o], *vs = &vsum[o], *wm = &wmax[o];
+                                for (size_t c = 0; c < width; ++c) {
+                                    const double *a = i0 + c;
+                                    double dist = a[bz + by + bx] - a[bz + by] - a[bz + bx] + a[bz];
+                                    // 二维时第0层全为0
+                                    if (rpz) dist -= a[by + bx] - a[by] - a[bx] + a[0];
+                                    const double t = dist * tscale;
+                                    float w = 0.0f;
+                                    if (t < double(kNLMTable)) {
+                                        const size_t i = size_t(t);
+                                        w = table[i] + float(t - double(i)) * (table[i + 1] - table[i]);
+                                    }
+                                    ws[c] += w;
+                                    vs[c] += w * float(q[c]);
+                                    wm[c] = std::max(wm[c], w);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            // 体素自身取最大权重
+            for (size_t k = 0; k < tz; ++k) {
+                for (size_t r = 0; r < ty; ++r) {
+                    const size_t o = k * tplane + r * width, p = ((z0 + k) * height + y0 + r) * width;
+                    const T *src = im + p;
+                    T *dst = &out[p];
+                    for (size_t c = 0; c < width; ++c) {
+                        const float w = wmax[o + c] > 0.0f ? wmax[o + c] : 1.0f;
+                        dst[c] = RoundValue<T>((vsum[o + c] + w * float(src[c])) / (wsum[o + c] + w));
+                    }
+                }
+            }
+        }
+    }, 1);
+    if (!ok) return false;
+    memcpy(im, out.data(), out.size() * sizeof(T));
+    return true;
+}
+
+#endif //DIP_NONLOCAL_MEANS_H
@@ -0,0 +1,284 @@
+// Program: DIP
+// FileName:recursive_gaussian.h
+// Author:  Lichun Zhang
+// Date:    2026/10/19 上午12:20
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_RECURSIVE_GAUSSIAN_H
+#define DIP_RECURSIVE_GAUSSIAN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <parallel.h>
+
+// x方向滤波时同时处理的行数 转置到缓冲区后每个位置的这些行连续存放
+const size_t kRecursiveRows = 16;
+// z方向滤波时每块的平面像素数
+const size_t kRecursiveLanes = 1 << 12;
+
+/**
+ * @brief Young-van Vliet三阶递归高斯滤波系数
+ * @note I.T. Young, L.J. van Vliet, Recursive implementation of the Gaussian filter, 1995.
+ * w[n] = B*x[n] + a1*w[n-1] + a2*w[n-2] + a3*w[n-3] 先正向再反向各一次, 每像素代价与sigma无关.
+ * 脉冲响应与归一化采样高斯在±4sigma内的均方根误差: sigma为1、3、10像素时分别约为峰值的5%、2%、1%
+ * (响应比目标略宽 标准差约大10%). sigma小于0.5像素时近似失效 此时不滤波(valid为false).
+ */
+struct RecursiveGaussianCoeff {
+    explicit RecursiveGaussianCoeff(double sigma) : B(1.0), a1(0.0), a2(0.0), a3(0.0), valid(sigma >= 0.5) {
+        if (!valid) return;
+        double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                                : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+        double q2 = q * q, q3 = q2 * q;
+        double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+        double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+        double b2 = -(1.4281 * q2 + 1.26661 * q3);
+        double b3 = 0.422205 * q3;
+        a1 = b1 / b0;
+        a2 = b2 / b0;
+        a3 = b3 / b0;
+        B = 1.0 - (a1 + a2 + a3);
+    }
+
+    double B, a1, a2, a3;
+    bool valid;
+};
+
+/**
+ * @brief 沿一个方向的递归高斯滤波 同时处理lanes条线 原地进行
+ * @note 第i个位置的lanes个值为p[i*step, i*step+lanes), 内层循环沿lanes 可由编译器向量化.
+ * 边界按常数延拓: 正向初值取首元素, 反向初值取正向结果的末元素(常数输入的稳态).
+ * @param p 数据指针
+ * @param n 每条线的长度
+ * @param step 相邻位置的间隔(元素数)
+ * @param lanes 同时处理的线数
+ * @param c 滤波系数
+ */
+inline void RecursiveGaussianLines(float *p, size_t n, size_t step, size_t lanes,
+                                   const RecursiveGaussianCoeff &c) {
+    if (!c.valid || n < 2) return;
+    const float B = float(c.B), a1 = float(c.a1), a2 = float(c.a2), a3 = float(c.a3);
+    // 正向 首元素的稳态输出就是它自己
+    for (size_t i = 1; i < n; ++i) {
+        float *cur = p + i * step;
+        const float *w1 = cur - step;
+        const float *w2 = p + (i >= 2 ? i - 2 : 0) * step;
+        const float *w3 = p + (i >= 3 ? i - 3 : 0) * step;
+        for (size_t j = 0; j < lanes; ++j)
+            cur[j] = B * cur[j] + a1 * w1[j] + a2 * w2[j] + a3 * w3[j];
+    }
+    // 反向 末元素保持正向结果
+    for (size_t i = n - 1; i-- > 0;) {
+        float *cur = p + i * step;
+        const float *w1 = p + std::min(n - 1, i + 1) * step;
+        const float *w2 = p + std::min(n - 1, i + 2) * step;
+        const float *w3 = p + std::min(n - 1, i + 3) * step;
+        for (size_t j = 0; j < lanes; ++j)
+            cur[j] = B * cur[j] + a1 * w1[j] + a2 * w2[j] + a3 * w3[j];
+    }
+}
+
+/**
+ * @brief 沿一个方向的中心差分 同时处理lanes条线 原地进行 边界按常数延拓
+ * @param order 1: (x[i+1]-x[i-1])/2  2: x[i+1]-2x[i]+x[i-1]
+ * @param scale 结果乘的系数(体素间距的-order次方)
+ * @param buffer 至少2*lanes个元素的缓冲区
+ */
+inline void DifferenceLines(float *p, size_t n, size_t step, size_t lanes, int order, float scale,
+                            float *buffer) {
+    if (order <= 0) return;
+    float *prev = buffer, *cur = buffer + lanes;
+    std::copy(p, p + lanes, prev);
+    for (size_t i = 0; i < n; ++i) {
+        float *x = p + i * step;
+        const float *next = p + std::min(n - 1, i + 1) * step;
+        std::copy(x, x + lanes, cur);
+        if (order == 1) {
+            for (size_t j = 0; j < lanes; ++j)
+                x[j] = 0.5f * scale * (next[j] - prev[j]);
+        } else {
+            for (size_t j = 0; j < lanes; ++j)
+                x[j] = scale * (next[j] - 2.0f * cur[j] + prev[j]);
+        }
+        std::swap(prev, cur);
+    }
+}
+
+/**
+ * @brief 三维递归高斯滤波及导数 浮点体数据原地进行 每体素代价与sigma无关
+ * @note 各方向依次: 递归高斯平滑(sigma/spacing像素), 再按阶数做中心差分并除以spacing^order,
+ * 因此sigma和导数都以物理单位计. x方向每次转置kRecursiveRows行到缓冲区同时滤波;
+ * y方向每张切片所有列同时滤波; z方向按平面分块同时滤波. 各方向内部并行.
+ * @param data 数据指针 width*height*slice
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param sigma 各方向的高斯标准差(物理单位) 小于等于0时该方向不平滑
+ * @param order 各方向的导数阶数 0~2
+ * @param spacing 各方向的体素间距 为空时都为1
+ * @return 操作是否成功
+ */
+inline bool RecursiveGaussian(float *data, size_t width, size_t height, size_t slice,
+                              const double sigma[3], const int order[3], const double *spacing = nullptr) {
+    if (!data || !width || !height || !slice || !sigma || !order) return false;
+    double sp[3] = {1.0, 1.0, 1.0};
+    for (int a = 0; a < 3; ++a) {
+        if (spacing && spacing[a] > 0.0) sp[a] = spacing[a];
+        if (order[a] < 0 || order[a] > 2) return false;
+    }
+    const size_t pixels = width * height;
+    bool ok = true;
+    // x方向
+    RecursiveGaussianCoeff cx(sigma[0] / sp[0]);
+    if ((cx.valid || order[0]) && width > 1) {
+        const size_t rows = slice * height, blocks = (rows + kRecursiveRows - 1) / kRecursiveRows;
+        const float scale = float(std::pow(sp[0], -order[0]));
+        ParallelFor(0, blocks, [&](size_t b, size_t e, size_t) {
+            std::vector<float> buf, diff;
+            try {
+                buf.resize(width * kRecursiveRows);
+                diff.resize(2 * kRecursiveRows);
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                ok = false;
+                return;
+            }
+            for (size_t t = b; t < e; ++t) {
+                size_t r0 = t * kRecursiveRows, n = std::min(kRecursiveRows, rows - r0);
+                for (size_t r = 0; r < n; ++r) {
+                    const float *row = data + (r0 + r) * width;
+                    for (size_t x = 0; x < width; ++x)
+                        buf[x * kRecursiveRows + r] = row[x];
+                }
+                RecursiveGaussianLines(buf.data(), width, kRecursiveRows, kRecursiveRows, cx);
+                DifferenceLines(buf.data(), width, kRecursiveRows, kRecursiveRows, order[0], scale, diff.data());
+                for (size_t r = 0; r < n; ++r) {
+                    float *row = data + (r0 + r) * width;
+                    for (size_t x = 0; x < width; ++x)
+                        row[x] = buf[x * kRecursiveRows + r];
+                }
+            }
+        }, 4);
+    }
+    // y方向
+    RecursiveGaussianCoeff cy(sigma[1] / sp[1]);
+    if (ok && (cy.valid || order[1]) && height > 1) {
+        const float scale = float(std::pow(sp[1], -order[1]));
+        ParallelFor(0, slice, [&](size_t b, size_t e, size_t) {
+            std::vector<float> diff;
+            try {
+                diff.resize(2 * width);
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                ok = false;
+                return;
+            }
+            for (size_t k = b; k < e; ++k) {
+                RecursiveGaussianLines(data + k * pixels, height, width, width, cy);
+                DifferenceLines(data + k * pixels, height, width, width, order[1], scale, diff.data());
+            }
+        }, 1);
+    }
+    // z方向
+    RecursiveGaussianCoeff cz(sigma[2] / sp[2]);
+    if (ok && (cz.valid || order[2]) && slice > 1) {
+        const size_t blocks = (pixels + kRecursiveLanes - 1) / kRecursiveLanes;
+        const float scale = float(std::pow(sp[2], -order[2]));
+        ParallelFor(0, blocks, [&](size_t b, size_t e, size_t) {
+            std::vector<float> diff;
+            try {
+                diff.resize(2 * kRecursiveLanes);
+            }
+            catch (std::bad_alloc) {
+                std::cout << "Failed to alloc memory!\n";
+                ok = false;
+                return;
+            }
+            for (size_t t = b; t < e; ++t) {
+                size_t p0 = t * kRecursiveLanes, n = std::min(kRecursiveLanes, pixels - p0);
+                RecursiveGaussianLines(data + p0, slice, pixels, n, cz);
+                DifferenceLines(data + p0, slice, pixels, n, order[2], scale, diff.data());
+            }
+        }, 1);
+    }
+    return ok;
+}
+
+/**
+ * @brief 递归高斯平滑 代价与sigma无关 结果四舍五入并截断到T的范围
+ * @tparam T 图像数据类型
+ * @param im 图像指针 原地输出
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param sigma 高斯标准差(物理单位 spacing为空时为像素)
+ * @param spacing x、y、z方向的体素间距 可取MHD_IO::GetSpacingX/Y/Z 为空时都为1
+ * @param volume 是否也沿z方向平滑 否则逐切片二维平滑
+ * @return 操作是否成功
+ */
+template<typename T>
+bool RecursiveGaussianSmooth(T *im, size_t width, size_t height, size_t slice, double sigma,
+                             const double *spacing = nullptr, bool volume = true) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t total = width * height * slice;
+    std::vector<float> buf;
+    try {
+        buf.assign(im, im + total);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    double sigmas[3] = {sigma, sigma, volume ? sigma : 0.0};
+    int order[3] = {0, 0, 0};
+    if (!RecursiveGaussian(buf.data(), width, height, slice, sigmas, order, spacing)) return false;
+    const double lo = double(std::numeric_limits<T>::lowest()), hi = double(std::numeric_limits<T>::max());
+    const bool integral = std::numeric_limits<T>::is_integer;
+    ParallelFor(0, total, [&](size_t b, size_t e, size_t) {
+        for (size_t i = b; i < e; ++i) {
+            double v = integral ? std::floor(buf[i] + 0.5) : buf[i];
+            im[i] = T(std::min(hi, std::max(lo, v)));
+        }
+    }, 1 << 16);
+    return true;
+}
+
+/**
+ * @brief 高斯导数 先递归高斯平滑再中心差分 代价与sigma无关
+ * @note 例如 (1,0,0) 为x方向一阶导数, (0,2,0) 为y方向二阶导数, (1,1,0) 为混合导数;
+ * 多尺度分析(血管增强、尺度空间边缘)对每个sigma调用一次, 每次代价相同.
+ * @tparam T 图像数据类型
+ * @param im 图像指针
+ * @param width  图像宽度
+ * @param height 图像高度
+ * @param slice  图像切片数
+ * @param out 输出 width*height*slice 以物理单位计的导数
+ * @param sigma 高斯标准差(物理单位)
+ * @param orderX x方向导数阶数 0~2
+ * @param orderY y方向导数阶数 0~2
+ * @param orderZ z方向导数阶数 0~2
+ * @param spacing x、y、z方向的体素间距 为空时都为1
+ * @param volume 是否沿z方向平滑 否则逐切片二维(orderZ须为0)
+ * @return 操作是否成功
+ */
+template<typename T>
+bool GaussianDerivative(const T *im, size_t width, size_t height, size_t slice, float *out, double sigma,
+                        int orderX, int orderY, int orderZ, const double *spacing = nullptr, bool volume = true) {
+    if (!im || !out || (!volume && orderZ)) return false;
+    const size_t total = width * height * slice;
+    ParallelFor(0, total, [&](size_t b, size_t e, size_t) {
+        for (size_t i = b; i < e; ++i) out[i] = float(im[i]);
+    }, 1 << 16);
+    double sigmas[3] = {sigma, sigma, volume ? sigma : 0.0};
+    int order[3] = {orderX, orderY, orderZ};
+    return RecursiveGaussian(out, width, height, slice, sigmas, order, spacing);
+}
+
+#endif //DIP_RECURSIVE_GAUSSIAN_H
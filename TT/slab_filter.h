@@ -0,0 +1,144 @@
+// Program: DIP
+// FileName:slab_filter.h
+// Author:  Lichun Zhang
+// Date:    2026/10/18 下午11:40
+// Copyright (c) 2017 Lichun Zhang. All rights reserved.
+
+#ifndef DIP_SLAB_FILTER_H
+#define DIP_SLAB_FILTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <vector>
+
+#include <border.h>
+#include <parallel.h>
+
+/**
+ * @brief SlabFilter3D的切片分块(slab)数 每块至少grain张切片
+ */
+inline size_t SlabNum(size_t slice, size_t grain) {
+    return std::max(size_t(1), std::min(slice, ParallelChunkNum(0, slice, grain)));
+}
+
+/**
+ * @brief SlabFilter3D的并行分块数 用于预先分配各分块私有的工作缓冲
+ */
+inline size_t SlabChunkNum(size_t slice, size_t before, size_t after) {
+    return ParallelChunkNum(0, SlabNum(slice, before + after + 1));
+}
+
+/**
+ * @brief 三维邻域滤波的切片分块(slab)框架 原地输出 所有体素都处理 不复制整个体数据
+ * @note 输出第k张切片需要扩展后的第k-before ~ k+after张切片. 体数据沿z分为若干slab, 各slab并行,
+ * 每个slab按k递增处理, 只在环形缓冲中保存before+after+1张按mode扩展(x方向left/right列, y方向
+ * top/bottom行)的平面, 输出直接写回原图第k张(此后只从缓冲读取该张原值). 各slab上下的halo平面
+ * 和越出体数据的平面(复制、镜像、周期扩展可能映射到已写回的切片)在任何slab写回之前先统一保存,
+ * 因此各种扩展方式的结果都与先复制整个体数据再计算相同. 常数扩展时越界的平面全为value.
+ * func(k, planes, dst, chunk): 计算第k张切片写入dst(width*height个体素). planes[d]为扩展后的
+ * 第k-before+d张平面, 指向图像(0, 0), 行长pw = left+width+right, 可访问第-top ~ height+bottom-1行
+ * 的第-left ~ width+right-1列; func只能从planes读取原值. 同一分块内k连续递增时可在调用之间保留
+ * 沿z滑动的中间结果(slab之间k不连续). chunk为分块序号(0 ~ SlabChunkNum(slice, before, after)-1),
+ * 可用于索引各分块的工作缓冲; func返回false表示失败.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param left 左侧扩展像素数
+ * @param right 右侧扩展像素数
+ * @param top 上方扩展行数
+ * @param bottom 下方扩展行数
+ * @param before z方向窗口在当前切片之前的切片数
+ * @param after z方向窗口在当前切片之后的切片数
+ * @param mode 边缘扩展方式
+ * @param value 常数扩展的值
+ * @param func 单张切片的计算函数
+ * @return 是否操作成功
+ */
+template<class T, class F>
+bool SlabFilter3D(T *im, size_t width, size_t height, size_t slice,
+                  size_t left, size_t right, size_t top, size_t bottom, size_t before, size_t after,
+                  BorderMode mode, T value, F func) {
+    if (!im || !width || !height || !slice) return false;
+    const size_t pixels = width * height, pw = left + width + right, ph = top + height + bottom;
+    const size_t plane = pw * ph, depth = before + after + 1, halo = before + after;
+    const size_t slabs = SlabNum(slice, depth);
+    auto range = [&](size_t u, size_t &z0, size_t &z1) {
+        z0 = slice * u / slabs;
+        z1 = slice * (u + 1) / slabs;
+    };
+    // 扩展第z张平面(z可越出体数据)
+    auto pad = [&](long z, T *dst) {
+        const long i = BorderIndex(z, long(slice), mode);
+        if (i < 0) std::fill(dst, dst + plane, value);
+        else PadRows(im + size_t(i) * pixels, width, height, -long(top), long(height + bottom), left, right,
+                     mode, value, dst);
+    };
+    // 各slab的halo平面: 前before张为z0-before ~ z0-1, 后after张为z1 ~ z1+after-1
+    std::vector<T> saved;
+    try {
+        saved.resize(slabs * halo * plane);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    if (halo) {
+        ParallelFor(0, slabs, [&](size_t b, size_t e, size_t) {
+            for (size_t u = b; u < e; ++u) {
+                size_t z0, z1;
+                range(u, z0, z1);
+                T *h = saved.data() + u * halo * plane;
+                for (size_t i = 0; i < halo; ++i)
+                    pad(i < before ? long(z0) - long(before - i) : long(z1 + i - before), h + i * plane);
+            }
+        }, 1);
+    }
+    bool ok = true;
+    ParallelFor(0, slabs, [&](size_t b, size_t e, size_t chunk) {
+        std::vector<T> ring;
+        std::vector<const T *> ptr;
+        try {
+            ring.resize(depth * plane);
+            ptr.resize(depth);
+        }
+        catch (std::bad_alloc) {
+            std::cout << "Failed to alloc memory!\n";
+            ok = false;
+            return;
+        }
+        for (size_t u = b; u < e && ok; ++u) {
+            size_t z0, z1;
+            range(u, z0, z1);
+            const T *h = saved.data() + u * halo * plane;
+            // 扩展后的第z张平面放入环形缓冲第(z-z0+before)%depth张
+            auto load = [&](long z) {
+                T *dst = &ring[size_t(z - long(z0) + long(before)) % depth * plane];
+                if (z < long(z0))
+                    memcpy(dst, h + size_t(z - long(z0) + long(before)) * plane, plane * sizeof(T));
+                else if (z >= long(z1))
+                    memcpy(dst, h + (before + size_t(z - long(z1))) * plane, plane * sizeof(T));
+                else
+                    pad(z, dst);
+            };
+            for (long z = long(z0) - long(before); z < long(z0 + after); ++z)
+                load(z);
+            for (size_t k = z0; k < z1; ++k) {
+                load(long(k + after));
+                for (size_t d = 0; d < depth; ++d)
+                    ptr[d] = &ring[(k - z0 + d) % depth * plane + top * pw + left];
+                if (!func(k, ptr.data(), im + k * pixels, chunk)) {
+                    ok = false;
+                    return;
+                }
+            }
+        }
+    }, 1);
+    return ok;
+}
+
+#endif //DIP_SLAB_FILTER_H
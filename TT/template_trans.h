@@ -7,10 +7,21 @@
 #ifndef DIP_TEMPLATE_TRANS_H
 #define DIP_TEMPLATE_TRANS_H
 
+#include <cmath>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <new>
 #include <iostream>
 #include <climits>
+#include <type_traits>
+#include <vector>
+
+#include <border.h>
+#include <line_buffer.h>
+#include <parallel.h>
+#include "median_filter.h"
 
 template<class T>
 void Exchange(T *a, int i, int j) {
@@ -27,13 +38,155 @@ T GetMedian(T *a, int num) {
         }
     }
     if (num % 2)
-        return (a[num / 2 - 1] + a[num / 2]) / 2;
-    else
         return a[num / 2];
+    else
+        return (a[num / 2 - 1] + a[num / 2]) / 2;
+}
+
+// 模版运算结果转换为像素值 超过最大值时为最大值
+template<class T>
+T TemplateValue(double result) {
+    return result > std::numeric_limits<T>::max()
+           ? std::numeric_limits<T>::max()
+           : T(int(result + 0.5));
+}
+
+/**
+ * @brief 加权平均等结果就近取整为像素值 floor(v+0.5)并截断到T的范围
+ * @note 负数不向0截断, 有符号图像(如CT)的暗区不偏亮; 浮点类型不取整.
+ */
+template<class T>
+T RoundValue(double v) {
+    if (!std::is_integral<T>::value) return T(v);
+    v = std::floor(v + 0.5);
+    if (v <= double(std::numeric_limits<T>::lowest())) return std::numeric_limits<T>::lowest();
+    if (v >= double(std::numeric_limits<T>::max())) return std::numeric_limits<T>::max();
+    return T(v);
+}
+
+/**
+ * @brief 判断模版是否可分离(秩为1) 即 para[l][m] = kernelY[l] * kernelX[m]
+ * @note 以绝对值最大的元素为主元取出一行和一列, 再逐元素检验乘积, 误差不超过tol倍最大元素
+ * @param para_array 模版数组 filterH行filterW列
+ * @param filterW 模版宽度
+ * @param filterH 模版高度
+ * @param kernelX 输出的水平一维模版 filterW个
+ * @param kernelY 输出的垂直一维模版 filterH个
+ * @param tol 相对误差
+ * @return 是否可分离
+ */
+inline bool SeparateKernel(const double *para_array, size_t filterW, size_t filterH,
+                           std::vector<double> &kernelX, std::vector<double> &kernelY,
+                           double tol = 1e-9) {
+    if (!para_array || !filterW || !filterH) return false;
+    size_t pivot = 0;
+    for (size_t i = 1; i < filterW * filterH; ++i)
+        if (std::fabs(para_array[i]) > std::fabs(para_array[pivot])) pivot = i;
+    const double amax = std::fabs(para_array[pivot]);
+    if (amax == 0.0) return false;
+    const size_t pl = pivot / filterW, pm = pivot % filterW;
+    kernelX.resize(filterW);
+    kernelY.resize(filterH);
+    for (size_t l = 0; l < filterH; ++l)
+        kernelY[l] = para_array[l * filterW + pm];
+    for (size_t m = 0; m < filterW; ++m)
+        kernelX[m] = para_array[pl * filterW + m] / para_array[pivot];
+    for (size_t l = 0; l < filterH; ++l)
+        for (size_t m = 0; m < filterW; ++m)
+            if (std::fabs(para_array[l * filterW + m] - kernelY[l] * kernelX[m]) > tol * amax)
+                return false;
+    return true;
+}
+
+/**
+ * @brief 可分离模版滤波 先垂直后水平两次一维卷积 每像素约filterW+filterH次乘加
+ * @note 模版为 kernelY[l] * kernelX[m] * coeff. 由LineBufferFilter按行原地处理: 环形缓冲中保存
+ * filterH个按border扩展的行, 输出每行时先对扩展行的每一列做垂直滤波, 再对这一行做水平滤波,
+ * 直接写回原图. 每个线程的工作集只有几行, 所有像素(包括边缘)都用同一个无分支的内层循环计算.
+ * @tparam T 图像数据类型
+ * @param im 图像数据指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param slice 图像切片数
+ * @param filterW 水平模版长度
+ * @param filterH 垂直模版长度
+ * @param filterCX 模版中心元素x坐标
+ * @param filterCY 模版中心元素y坐标
+ * @param kernelX 水平一维模版
+ * @param kernelY 垂直一维模版
+ * @param coeff 模版系数
+ * @param border 边缘扩展方式 常数扩展时补0
+ * @return 是否操作成功
+ */
+template<class T>
+bool SeparableTemplate(T *im, size_t width, size_t height, size_t slice,
+                       size_t filterW, size_t filterH,
+                       size_t filterCX, size_t filterCY,
+                       const double *kernelX, const double *kernelY, double coeff,
+                       BorderMode border = BORDER_REPLICATE) {
+    if (!im || !width || !height || !slice || !kernelX || !kernelY ||
+        filterCX >= filterW || filterCY >= filterH)
+        return false;
+    const size_t pw = width + filterW - 1;
+    // 各分块的工作缓冲: 扩展行的垂直滤波结果(pw个)和输出行(width个)
+    std::vector<std::vector<double> > work(LineBufferChunkNum(height, slice));
+    try {
+        for (size_t c = 0; c < work.size(); ++c)
+            work[c].resize(pw + width);
+    }
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferFilter(im, width, height, slice, filterCX, filterW - 1 - filterCX,
+                            filterCY, filterH - 1 - filterCY, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        double *v = work[chunk].data(), *acc = v + pw;
+        for (size_t j = 0; j < pw; ++j)
+            v[j] = 0.0;
+        for (size_t l = 0; l < filterH; ++l) {
+            const double w = kernelY[l];
+            const T *p = rows[l] - filterCX;
+            for (size_t j = 0; j < pw; ++j)
+                v[j] += w * double(p[j]);
+        }
+        for (size_t j = 0; j < width; ++j)
+            acc[j] = 0.0;
+        for (size_t m = 0; m < filterW; ++m) {
+            const double w = kernelX[m];
+            const double *p = v + m;
+            for (size_t j = 0; j < width; ++j)
+                acc[j] += w * p[j];
+        }
+        for (size_t j = 0; j < width; ++j)
+            dst[j] = TemplateValue<T>(acc[j] * coeff);
+    });
+}
+
+/**
+ * @brief 一维高斯模版 归一化使系数和为1
+ * @param size 模版长度(奇数)
+ * @param sigma 标准差(像素) 不大于0时取 0.3*((size-1)*0.5-1)+0.8
+ * @param kernel 输出的模版
+ */
+inline void GaussianKernel(size_t size, double sigma, std::vector<double> &kernel) {
+    if (!size) size = 1;
+    if (sigma <= 0.0) sigma = 0.3 * ((size - 1) * 0.5 - 1) + 0.8;
+    kernel.resize(size);
+    double sum = 0.0, c = (size - 1) * 0.5;
+    for (size_t i = 0; i < size; ++i) {
+        kernel[i] = std::exp(-(i - c) * (i - c) / (2.0 * sigma * sigma));
+        sum += kernel[i];
+    }
+    for (size_t i = 0; i < size; ++i)
+        kernel[i] /= sum;
 }
 
 /**
  * @brief       时域空间滤波模版-平均、高斯、拉普拉斯
+ * @note        可分离(秩为1)的模版自动改用SeparableTemplate. 由LineBufferFilter按行原地处理,
+ * 环形缓冲中保存filterH个按border扩展的行; 对每个模版系数, 把扩展行右移后乘系数累加到输出行,
+ * 内层循环无分支、可向量化, 所有像素(包括边缘)都处理.
  * @tparam T    图像数据类型
  * @param im    图像数据指针
  * @param width 图像宽度
@@ -45,50 +198,51 @@ T GetMedian(T *a, int num) {
  * @param filterCY  滤波器中心元素y坐标
  * @param para_array    指向模版数组的指针
  * @param coeff 模版系数
+ * @param border    边缘扩展方式 常数扩展时补0
  * @return  是否操作成功
  */
 template<class T>
 bool Template(T *im, size_t width, size_t height, size_t slice,
               size_t filterW, size_t filterH,
               size_t filterCX, size_t filterCY,
-              double *para_array, double coeff) {
-    if (!im || width <= 0 || height <= 0 || slice <= 0)
+              double *para_array, double coeff, BorderMode border = BORDER_REPLICATE) {
+    if (!im || !para_array || width <= 0 || height <= 0 || slice <= 0 ||
+        filterCX >= filterW || filterCY >= filterH)
         return false;
-    T *new_im = nullptr;
+    // 可分离的模版(均值、高斯、Sobel/Prewitt分量等)分两次一维滤波
+    std::vector<double> kx, ky;
+    if (filterW * filterH > filterW + filterH &&
+        SeparateKernel(para_array, filterW, filterH, kx, ky))
+        return SeparableTemplate(im, width, height, slice, filterW, filterH,
+                                 filterCX, filterCY, kx.data(), ky.data(), coeff, border);
+    std::vector<std::vector<double> > work(LineBufferChunkNum(height, slice));
     try {
-        new_im = new T[width * height];
+        for (size_t c = 0; c < work.size(); ++c)
+            work[c].resize(width);
     }
     catch (std::bad_alloc) {
         std::cout << "Failed to alloc memory!\n";
         return false;
     }
-
-    T *lp_src = nullptr;
-    for (int k = 0; k < slice; ++k) {
-        memcpy(new_im, im + k * width * height, width * height * sizeof(T));
-        for (int i = filterCY; i < height - filterH + filterCY + 1; ++i) {
-            for (int j = filterCX; j < width - filterW + filterCX + 1; ++j) {
-                // 指向原图像滤波模版开始处
-                double result = 0.0;
-                lp_src = im + k * height * width + (i - filterCY) * width +
-                         j - filterCX;
-                // 模版覆盖区计算
-                for (int l = 0; l < filterH; ++l) {
-                    for (int m = 0; m < filterW; ++m) {
-                        result += (double) (*(lp_src + l * width + m)) * para_array[l * filterW + m];
-                    }
-                }
-                result *= coeff;
-                result = result > std::numeric_limits<T>::max()
-                         ? std::numeric_limits<T>::max()
-                         : int(result + 0.5);
-                new_im[i * width + j] = result;
+    return LineBufferFilter(im, width, height, slice, filterCX, filterW - 1 - filterCX,
+                            filterCY, filterH - 1 - filterCY, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        double *acc = work[chunk].data();
+        for (size_t j = 0; j < width; ++j)
+            acc[j] = 0.0;
+        // 模版覆盖区计算 扩展行l右移m-filterCX列即为各输出像素的(l, m)邻点
+        for (size_t l = 0; l < filterH; ++l) {
+            for (size_t m = 0; m < filterW; ++m) {
+                const double w = para_array[l * filterW + m];
+                if (w == 0.0) continue;
+                const T *p = rows[l] + long(m) - long(filterCX);
+                for (size_t j = 0; j < width; ++j)
+                    acc[j] += w * double(p[j]);
             }
         }
-        memcpy(im + k * width * height, new_im, width * height * sizeof(T));
-    }
-    delete[] new_im;
-    return true;
+        for (size_t j = 0; j < width; ++j)
+            dst[j] = TemplateValue<T>(acc[j] * coeff);
+    });
 }
 
 /*!
@@ -111,39 +265,75 @@ bool LaplaceSharpen(T *im, size_t width, size_t height, size_t slice) {
 /**
  * @brief 梯度锐化 高于阈值为阈值，低于阈值为原图 若高于数据类型范围 为最大值
  * 函数为 G[f(i,j)] = |f(i,j)-f(i+1,j)|+|f(i,j)-f(i,j+1)|
+ * @note 由LineBufferFilter按行原地处理, 向右、向下按border扩展一个像素, 最后一行和最后一列也不越界.
  * @tparam T 图像数据类型
  * @param im 图像指针
  * @param width  图像宽度(像素)
  * @param height 图像高度(像素)
  * @param slice  图像切片数
  * @param threshold 阈值
+ * @param border 边缘扩展方式 常数扩展时补0
  * @return 是否操作成功
  */
 template<typename T>
-bool GradSharp(T *im, size_t width, size_t height, size_t slice, int threshold) {
-    T temp = 0;
-    for (size_t k = 0; k < slice; ++k) {
-        size_t p0 = k * width * height;
-        for (size_t i = 0; i < height; ++i) {
-            for (size_t j = 0; j < width; ++j) {
-                // 当前数据点位置
-                size_t p = p0 + i * width + j;
-                // G[f(i,j)] = |f(i,j)-f(i+1,j)|+|f(i,j)-f(i,j+1)|
-                temp = abs(im[p] - im[p + width]) + abs(im[p] - im[p + 1]);
-                if (temp <= std::numeric_limits<T>::max()) {
-                    if (temp >= threshold)
-                        im[p] = threshold;
-                } else {
-                    im[p] = std::numeric_limits<T>::max();
-                }
-            }
+bool GradSharp(T *im, size_t width, size_t height, size_t slice, int threshold,
+               BorderMode border = BORDER_REPLICATE) {
+    const double vmax = double(std::numeric_limits<T>::max());
+    return LineBufferFilter(im, width, height, slice, 0, 1, 0, 1, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t) {
+        const T *p = rows[0], *q = rows[1];
+        for (size_t j = 0; j < width; ++j) {
+            // G[f(i,j)] = |f(i,j)-f(i+1,j)|+|f(i,j)-f(i,j+1)|
+            const double g = std::fabs(double(p[j]) - double(q[j])) + std::fabs(double(p[j]) - double(p[j + 1]));
+            dst[j] = g > vmax ? std::numeric_limits<T>::max() : (g >= threshold ? T(threshold) : p[j]);
         }
+    });
+}
+
+// 中值滤波的实现 8/16位整数数据用滑动直方图
+template<class T>
+bool FilterMedian(T *im, size_t width, size_t height, size_t slice,
+                  size_t filterW, size_t filterH,
+                  size_t filterCX, size_t filterCY, BorderMode border, std::true_type) {
+    return HistogramMedian(im, width, height, slice, filterW, filterH, filterCX, filterCY, border);
+}
+
+// 其它类型逐窗口排序
+template<class T>
+bool FilterMedian(T *im, size_t width, size_t height, size_t slice,
+                  size_t filterW, size_t filterH,
+                  size_t filterCX, size_t filterCY, BorderMode border, std::false_type) {
+    if (!im || !filterW || !filterH || filterCX >= filterW || filterCY >= filterH)
+        return false;
+    std::vector<std::vector<T> > hvalue(LineBufferChunkNum(height, slice));
+    try {
+        for (size_t c = 0; c < hvalue.size(); ++c)
+            hvalue[c].resize(filterW * filterH);
     }
-    return true;
+    catch (std::bad_alloc) {
+        std::cout << "Failed to alloc memory!\n";
+        return false;
+    }
+    return LineBufferFilter(im, width, height, slice, filterCX, filterW - 1 - filterCX,
+                            filterCY, filterH - 1 - filterCY, border, T(0),
+                            [&](size_t, size_t, const T *const *rows, T *dst, size_t chunk) {
+        T *v = hvalue[chunk].data();
+        for (size_t j = 0; j < width; ++j) {
+            for (size_t l = 0; l < filterH; ++l) {
+                const T *p = rows[l] + long(j) - long(filterCX);
+                for (size_t m = 0; m < filterW; ++m)
+                    v[l * filterW + m] = p[m];
+            }
+            dst[j] = GetMedian<T>(v, int(filterW * filterH));
+        }
+    });
 }
 
 /*!
  * @brief   中值滤波
+ * @note    3*3、5*5居中窗口用NetworkMedian(排序网络 各列排序结果在相邻窗口间共用),
+ *          其它窗口的8/16位整数数据用HistogramMedian(滑动直方图) 与窗口大小近似无关.
+ *          均由LineBufferFilter按行原地处理, 边缘像素按border扩展后同样处理
  * @tparam T    图像数据类型
  * @param im    图像数据指针
  * @param width 图像宽度
@@ -153,42 +343,19 @@ bool GradSharp(T *im, size_t width, size_t height, size_t slice, int threshold)
  * @param filterH   滤波器高度
  * @param filterCX  滤波器中心元素x坐标
  * @param filterCY  滤波器中心元素y坐标
+ * @param border    边缘扩展方式
  * @return 是否操作成功
  */
 template<class T>
 bool FilterMedian(T *im, size_t width, size_t height, size_t slice,
                   size_t filterW, size_t filterH,
-                  size_t filterCX, size_t filterCY) {
-    T *new_im = nullptr;
-    try {
-        new_im = new T[width * height];
-    }
-    catch (std::bad_alloc) {
-        std::cout << "Failed to alloc memory!\n";
-        return false;
-    }
-
-    T *lp_src = nullptr;
-    for (int k = 0; k < slice; ++k) {
-        memcpy(new_im, im + k * width * height, width * height * sizeof(T));
-        T *hvalue = new T[filterW * filterH];
-        for (int j = filterCY; j < height - filterH + filterCY + 1; ++j) {
-            for (int i = filterCX; i < width - filterW + filterCX + 1; ++i) {
-                lp_src = im + k * height * width + (j - filterCY) * width +
-                         i - filterCX;
-                for (int l = 0; l < filterH; ++l) {
-                    for (int m = 0; m < filterW; ++m) {
-                        hvalue[l * filterW + m] = *(lp_src + l * width + m);
-                    }
-                }
-                new_im[j * width + i] =
-                        GetMedian<T>(hvalue, filterW * filterH);
-            }
-        }
-        memcpy(im + k * width * height, new_im, width * height * sizeof(T));
-    }
-    delete[] new_im;
-    return true;
+                  size_t filterCX, size_t filterCY, BorderMode border = BORDER_REPLICATE) {
+    if (filterW == filterH && (filterW == 3 || filterW == 5) &&
+        filterCX == filterW / 2 && filterCY == filterH / 2)
+        return NetworkMedian(im, width, height, slice, filterW, border);
+    // 8/16位整数数据用滑动直方图 其它类型逐窗口排序
+    return FilterMedian(im, width, height, slice, filterW, filterH, filterCX, filterCY, border,
+                        std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) <= 2>());
 }
 
 #endif //DIP_TEMPLATE_TRANS_H